@@ -1,3 +1,6 @@
+#if defined(__linux__)
+#define _GNU_SOURCE  // sched_getaffinity
+#endif
 #include<stdio.h>
 #include<stdlib.h>
 #include<string.h>
@@ -5,9 +8,16 @@
 #include<stdint.h>
 #include<ctype.h>  
 #include<stdbool.h>
+#include<dirent.h>
+#include<stdarg.h>
+#include<time.h>
+#include<math.h>
 
 #if defined(__linux__)
     #define PLATFORM_LINUX 1
+#include <sched.h>
+#include <sys/syscall.h>
+#include <sys/inotify.h>
 #endif
 
 #if defined(_WIN32) || defined(_WIN64)
@@ -17,15 +27,30 @@
 #include <sys/stat.h>
 #define MKDIR(path) _mkdir(path)
 #define CHDIR(path) _chdir(path)
+#define RMDIR(path) _rmdir(path)
 #define PATH_SEP '\\'
 #define EXE_EXT ".exe"
 #define STATIC_LIB_EXT ".lib"
 #define SHARED_LIB_EXT ".dll"
 #else
 #include <sys/stat.h>
+#include <sys/wait.h>
 #include <unistd.h>
+#include <signal.h>
+#include <spawn.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/ioctl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#if !defined(MSG_NOSIGNAL)
+#define MSG_NOSIGNAL 0
+#endif
+extern char** environ;
 #define MKDIR(path) mkdir(path, 0755)
 #define CHDIR(path) chdir(path)
+#define RMDIR(path) rmdir(path)
 #define PATH_SEP '/'
 #define EXE_EXT ""
 #if defined(__APPLE__)
@@ -40,7 +65,6 @@
 
 #define MAX_PATH_LEN 1024
 #define BUFFER_SIZE 1024
-#define MAX_DEPS 20  // 最大依赖数
 
 // 显示平台信息
 void print_platform_info() {
@@ -65,19 +89,47 @@ void print_usage(const char* program_name) {
     printf("    -e, --executable         创建可执行项目（默认）\n");
     printf("    -s, --static             创建静态库项目\n");
     printf("    -d, --shared             创建动态库项目\n");
-    printf("    -D, --dep <依赖>         添加项目依赖\n");
+    printf("    -D, --dep <依赖>         添加项目依赖,可带版本约束,例如 fmt>=9.1\n");
     printf("    -h, --help               显示此帮助信息\n");
     printf("    -p, --precompile-headers 创建预编译头文件\n");
     printf("  build                      构建项目\n");
     printf("    -d, --debug              使用Debug模式构建\n");
     printf("    -r, --release            使用Release模式构建\n");
+    printf("    -t, --build-type <类型>  指定构建类型(Debug/Release/RelWithDebInfo/MinSizeRel)\n");
+    printf("    -L, --layout <布局>      构建目录布局(single/per-type/multi-config)\n");
     printf("    -p, --prefix             指定安装目录\n");
     printf("    -c, --configure-only     选择是否构建\n");
     printf("    -b, --build-dir          设置构建目录\n");
-    printf("    -C, --clean-cache        构建前清理cmake缓存\n");
+    printf("    -C, --clean-cache        构建前清理cmake缓存(旧内容在后台删除)\n");
+    printf("    -j, --jobs <数量>        并行任务数(默认根据CPU配额和可用内存计算)\n");
+    printf("    --pgo-generate           构建插桩程序并运行[pgo]训练命令\n");
+    printf("    --pgo-use                使用收集到的profile构建优化程序\n");
+    printf("    --trace                  记录各阶段和每个翻译单元的耗时,输出Chrome trace和耗时汇总\n");
+    printf("    --timestamps             在CMake和编译器的每行输出前加上耗时\n");
+    printf("    --locked                 依赖项的解析结果必须与CMake.lock一致,不更新CMake.lock\n");
+    printf("    --no-daemon              不转发给守护进程,直接构建\n");
+    printf("  watch                      文件修改后自动重新构建, 其他选项传给build\n");
+    printf("    --run <命令>             每次构建成功后运行的命令\n");
+    printf("    --debounce <毫秒>        文件停止修改多久后开始构建(默认200)\n");
+    printf("  daemon [start|stop|status] 在当前目录运行常驻的构建守护进程, build自动转发给它\n");
+    printf("  clean [构建目录]           并行删除构建目录中的全部内容(默认build)\n");
+    printf("    -a, --async              移入回收目录后立即返回,在后台删除\n");
+    printf("    --configure              只删除CMakeCache.txt和配置结果,保留目标文件\n");
+    printf("    --objects <目标>         只删除指定目标的目标文件\n");
+    printf("    --pch                    只删除预编译头\n");
+    printf("  cache [stats|zero]         查看或清零编译器缓存(ccache/sccache)统计\n");
+    printf("  deps resolve               并行解析依赖项,更新CMake.lock和构建目录中的解析缓存\n");
+    printf("    -b, --build-dir          设置构建目录(默认build)\n");
+    printf("    --locked                 解析结果必须与CMake.lock一致\n");
+    printf("  pch-check [构建目录]       检查每个翻译单元是否使用了预编译头\n");
     printf("  init                       根据CMake.toml创建新项目\n");
     printf("  install <path>             安装生成的文件,如果不设置path则选择默认路径\n");
-    printf("  uninstall                  卸载安装的库\n");
+    printf("    -i, --incremental        只复制内容有变化的文件\n");
+    printf("    -t, --build-type <类型>  per-type/multi-config布局下安装的构建类型(默认Debug)\n");
+    printf("  uninstall [构建目录]       卸载安装的库\n");
+    printf("    -t, --build-type <类型>  per-type/multi-config布局下的构建类型\n");
+    printf("    -n, --dry-run            只列出将要删除的文件\n");
+    printf("    --json                   以JSON格式输出卸载结果\n");
     printf("示例:\n");
     printf("  %s new myapp -e -D fmt -D sdl2\n", program_name);
     printf("  %s new mylib -s -D boost\n\n\n", program_name);
@@ -88,19 +140,47 @@ void print_usage(const char* program_name) {
     printf("    -e, --executable             Create executable project (default)\n");
     printf("    -s, --static                 Create static library project\n");
     printf("    -d, --shared                 Create shared library project\n");
-    printf("    -D, --dep <dependency>       Add project dependency\n");
+    printf("    -D, --dep <dependency>       Add project dependency, optionally with a version constraint (e.g. fmt>=9.1)\n");
     printf("    -h, --help                   Display this help message\n");
     printf("    -p, --precompile-headers     Create precompiled headers\n");
     printf("  build                          Build project\n");
     printf("    -d, --debug                  Build using Debug mode\n");
     printf("    -r, --release                Build using Release mode\n");
+    printf("    -t, --build-type <type>      Set build type (Debug/Release/RelWithDebInfo/MinSizeRel)\n");
+    printf("    -L, --layout <layout>        Build directory layout (single/per-type/multi-config)\n");
     printf("    -p, --prefix                 Specify installation directory\n");
     printf("    -c, --configure-only         Configure without building\n");
     printf("    -b, --build-dir              Set build directory\n");
-    printf("    -C, --clean-cache            Clean cmake cache before building\n");
+    printf("    -C, --clean-cache            Clean cmake cache before building (old files are deleted in the background)\n");
+    printf("    -j, --jobs <count>           Parallel jobs (default: from CPU quota and available memory)\n");
+    printf("    --pgo-generate               Build instrumented binaries and run the [pgo] training command\n");
+    printf("    --pgo-use                    Rebuild with the collected profile\n");
+    printf("    --trace                      Time each phase and translation unit, write a Chrome trace and a summary\n");
+    printf("    --timestamps                 Prefix each line of CMake/compiler output with the elapsed time\n");
+    printf("    --locked                     Fail if resolved dependencies differ from CMake.lock instead of updating it\n");
+    printf("    --no-daemon                  Build directly instead of forwarding to a running daemon\n");
+    printf("  watch                          Rebuild when files change; other options are passed to build\n");
+    printf("    --run <command>              Command to run after each successful build\n");
+    printf("    --debounce <ms>              Wait until files stop changing for this long (default: 200)\n");
+    printf("  daemon [start|stop|status]     Run a resident build daemon in this directory; build forwards to it\n");
+    printf("  clean [build-dir]              Delete everything in the build directory in parallel (default: build)\n");
+    printf("    -a, --async                  Move the contents to a trash directory and delete them in the background\n");
+    printf("    --configure                  Only remove CMakeCache.txt and configure results, keep object files\n");
+    printf("    --objects <target>           Only remove the object files of one target\n");
+    printf("    --pch                        Only remove precompiled headers\n");
+    printf("  cache [stats|zero]             Show or reset compiler cache (ccache/sccache) statistics\n");
+    printf("  deps resolve                   Resolve dependencies in parallel, update CMake.lock and the resolution cache in the build directory\n");
+    printf("    -b, --build-dir              Set build directory (default: build)\n");
+    printf("    --locked                     Fail if the result differs from CMake.lock\n");
+    printf("  pch-check [build-dir]          Report whether each translation unit used the precompiled header\n");
     printf("  init                           Create new project based on CMake.toml\n");
     printf("  install <path>                 Install built files (uses default path if omitted)\n");
-    printf("  uninstall                      Uninstall installed library\n");
+    printf("    -i, --incremental            Only copy files whose contents changed\n");
+    printf("    -t, --build-type <type>      Build type to install with per-type/multi-config layouts (default: Debug)\n");
+    printf("  uninstall [build-dir]          Uninstall installed library\n");
+    printf("    -t, --build-type <type>      Build type with per-type/multi-config layouts\n");
+    printf("    -n, --dry-run                Only list the files that would be removed\n");
+    printf("    --json                       Print the result as JSON\n");
     printf("Examples:\n");
     printf("  %s new myapp -e -D fmt -D sdl2\n", program_name);
     printf("  %s new mylib -s -D boost\n", program_name);
@@ -117,49 +197,365 @@ void print_usage(const char* program_name) {
 #endif
 }
 
+// 内存池: 按块分配,一次性释放,用于解析结果等生命周期相同的小对象
+struct arena_block {
+    struct arena_block* next;
+    size_t used;
+    size_t size;
+    _Alignas(16) char data[];
+};
+
+struct arena {
+    struct arena_block* head;
+};
+
+void* arena_alloc(struct arena* arena, size_t size) {
+    size = (size + 15) & ~(size_t)15;
+    struct arena_block* block = arena->head;
+    if (!block || block->size - block->used < size) {
+        size_t block_size = size > 16 * 1024 ? size : 16 * 1024;
+        block = malloc(sizeof(*block) + block_size);
+        if (!block) return NULL;
+        block->next = arena->head;
+        block->used = 0;
+        block->size = block_size;
+        arena->head = block;
+    }
+    void* ptr = block->data + block->used;
+    block->used += size;
+    return ptr;
+}
+
+char* arena_strndup(struct arena* arena, const char* str, size_t len) {
+    char* copy = arena_alloc(arena, len + 1);
+    if (!copy) return NULL;
+    memcpy(copy, str, len);
+    copy[len] = '\0';
+    return copy;
+}
+
+char* arena_strdup(struct arena* arena, const char* str) {
+    return arena_strndup(arena, str, strlen(str));
+}
+
+void arena_free(struct arena* arena) {
+    struct arena_block* block = arena->head;
+    while (block) {
+        struct arena_block* next = block->next;
+        free(block);
+        block = next;
+    }
+    arena->head = NULL;
+}
+
+// 可增长的字符串缓冲区, data始终以'\0'结尾
+struct string_buffer {
+    char* data;
+    size_t length;
+    size_t capacity;
+};
+
+// 确保还能追加length个字符(以及结尾的'\0')
+bool string_buffer_reserve(struct string_buffer* buffer, size_t length) {
+    if (buffer->length + length + 1 <= buffer->capacity) return true;
+    size_t capacity = buffer->capacity ? buffer->capacity * 2 : 64;
+    while (capacity < buffer->length + length + 1) capacity *= 2;
+    char* grown = realloc(buffer->data, capacity);
+    if (!grown) return false;
+    buffer->data = grown;
+    buffer->capacity = capacity;
+    return true;
+}
+
+bool string_buffer_append(struct string_buffer* buffer, const char* data, size_t length) {
+    if (!string_buffer_reserve(buffer, length)) return false;
+    memcpy(buffer->data + buffer->length, data, length);
+    buffer->length += length;
+    buffer->data[buffer->length] = '\0';
+    return true;
+}
+
+bool string_buffer_appendf(struct string_buffer* buffer, const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(NULL, 0, format, args);
+    va_end(args);
+    if (length < 0 || !string_buffer_reserve(buffer, (size_t)length)) return false;
+    va_start(args, format);
+    vsnprintf(buffer->data + buffer->length, (size_t)length + 1, format, args);
+    va_end(args);
+    buffer->length += (size_t)length;
+    return true;
+}
+
+void string_buffer_free(struct string_buffer* buffer) {
+    free(buffer->data);
+    memset(buffer, 0, sizeof(*buffer));
+}
+
+// 字符串列表: 字符串存放在列表自己的内存池中, items以NULL结尾,可以直接作为argv使用
+struct string_list {
+    char** items;
+    size_t count;
+    size_t capacity;
+    struct arena arena;
+};
+
+// 追加一个已分配在列表内存池中的字符串
+int string_list_append(struct string_list* list, char* value) {
+    if (!value) return 0;
+    if (list->count + 2 > list->capacity) {
+        size_t capacity = list->capacity ? list->capacity * 2 : 16;
+        char** items = realloc(list->items, capacity * sizeof(*items));
+        if (!items) return 0;
+        list->items = items;
+        list->capacity = capacity;
+    }
+    list->items[list->count] = value;
+    list->items[++list->count] = NULL;
+    return 1;
+}
+
+int string_list_push(struct string_list* list, const char* value) {
+    return string_list_append(list, arena_strdup(&list->arena, value));
+}
+
+// 格式化后追加,按实际长度分配,不会截断
+int string_list_pushf(struct string_list* list, const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(NULL, 0, format, args);
+    va_end(args);
+    if (length < 0) return 0;
+    char* value = arena_alloc(&list->arena, (size_t)length + 1);
+    if (!value) return 0;
+    va_start(args, format);
+    vsnprintf(value, (size_t)length + 1, format, args);
+    va_end(args);
+    return string_list_append(list, value);
+}
+
+bool string_list_contains(const struct string_list* list, const char* value) {
+    for (size_t i = 0; i < list->count; i++) {
+        if (!strcmp(list->items[i], value)) return true;
+    }
+    return false;
+}
+
+void string_list_free(struct string_list* list) {
+    free(list->items);
+    arena_free(&list->arena);
+    memset(list, 0, sizeof(*list));
+}
+
+// 按分隔符拆分列表,空项忽略
+void split_list(const char* value, char list_sep, struct string_list* out) {
+    while (value && *value) {
+        const char* end = strchr(value, list_sep);
+        size_t length = end ? (size_t)(end - value) : strlen(value);
+        if (length > 0) string_list_append(out, arena_strndup(&out->arena, value, length));
+        if (!end) break;
+        value = end + 1;
+    }
+}
+
+// 拆分路径列表(PATH、PKG_CONFIG_PATH等)
+void split_path_list(const char* value, struct string_list* out) {
+#if defined(PLATFORM_WINDOWS)
+    split_list(value, ';', out);
+#else
+    split_list(value, ':', out);
+#endif
+}
+
+// FNV-1a 64位哈希
+#define FNV1A_OFFSET 14695981039346656037ULL
+#define FNV1A_PRIME  1099511628211ULL
+
+uint64_t hash_bytes(uint64_t hash, const void* data, size_t len) {
+    const unsigned char* p = (const unsigned char*)data;
+    for (size_t i = 0; i < len; i++) {
+        hash ^= p[i];
+        hash *= FNV1A_PRIME;
+    }
+    return hash;
+}
+
+// 连同结尾的'\0'一起计算,避免相邻字符串拼接后产生相同哈希
+uint64_t hash_string(uint64_t hash, const char* str) {
+    return hash_bytes(hash, str, strlen(str) + 1);
+}
+
+// 对文件内容计算哈希,文件不存在时使用固定标记
+uint64_t hash_stream(uint64_t hash, FILE* file) {
+    char buffer[BUFFER_SIZE * 8];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        hash = hash_bytes(hash, buffer, n);
+    }
+    return hash;
+}
+
+uint64_t hash_file(uint64_t hash, const char* path) {
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        return hash_string(hash, "<missing>");
+    }
+    hash = hash_stream(hash, file);
+    fclose(file);
+    return hash_string(hash, path);
+}
+
+// 只对文件内容计算哈希(不包含路径),用于比较两个文件; 文件无法读取时返回0
+uint64_t hash_file_contents(const char* path) {
+    FILE* file = fopen(path, "rb");
+    if (!file) return 0;
+    uint64_t hash = hash_stream(FNV1A_OFFSET, file);
+    fclose(file);
+    return hash;
+}
+
+// 文件修改时间(微秒),文件不存在时返回0
+int64_t file_mtime_us(const char* path) {
+    struct stat st;
+    if (stat(path, &st) != 0) return 0;
+#if defined(PLATFORM_LINUX)
+    return (int64_t)st.st_mtim.tv_sec * 1000000 + st.st_mtim.tv_nsec / 1000;
+#else
+    return (int64_t)st.st_mtime * 1000000;
+#endif
+}
+
+// 路径本身是否为符号链接(Windows下为重解析点), 不跟随链接
+bool is_symlink(const char* path) {
+#if defined(PLATFORM_WINDOWS)
+    DWORD attributes = GetFileAttributesA(path);
+    return attributes != INVALID_FILE_ATTRIBUTES && (attributes & FILE_ATTRIBUTE_REPARSE_POINT);
+#else
+    struct stat st;
+    return lstat(path, &st) == 0 && S_ISLNK(st.st_mode);
+#endif
+}
+
+// 读取整个文件到内存并以'\0'结尾,调用方负责free
+char* read_file_contents(const char* path, size_t* out_len) {
+    FILE* file = fopen(path, "rb");
+    if (!file) return NULL;
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    if (size < 0) {
+        fclose(file);
+        return NULL;
+    }
+    char* data = malloc((size_t)size + 1);
+    if (!data) {
+        fclose(file);
+        return NULL;
+    }
+    size_t n = fread(data, 1, (size_t)size, file);
+    fclose(file);
+    data[n] = '\0';
+    if (out_len) *out_len = n;
+    return data;
+}
+
+// 内容与现有文件相同时不写入,保留修改时间,避免触发CMake重新配置;
+// 内容不同时先写入同一目录中的临时文件再重命名替换,中断时不会留下写了一半的文件
+int write_file_if_changed(const char* path, const char* data, size_t length) {
+    size_t old_length = 0;
+    char* old_data = read_file_contents(path, &old_length);
+    bool same = old_data && old_length == length && !memcmp(old_data, data, length);
+    free(old_data);
+    if (same) return 1;
+    char temp_path[MAX_PATH_LEN];
+    snprintf(temp_path, sizeof(temp_path), "%s.cbuild-tmp", path);
+    FILE* file = fopen(temp_path, "wb");
+    bool ok = file && fwrite(data, 1, length, file) == length;
+    if (file && fclose(file) != 0) ok = false;
+#if defined(PLATFORM_WINDOWS)
+    ok = ok && MoveFileExA(temp_path, path, MOVEFILE_REPLACE_EXISTING);
+#else
+    ok = ok && rename(temp_path, path) == 0;
+#endif
+    if (!ok) {
+        fprintf(stderr, "写入%s失败: %s\n", path, strerror(errno));
+        remove(temp_path);
+        return 0;
+    }
+    return 1;
+}
+
+// 生成的文件先写入内存, 完成后与现有文件比较, 内容不变时保留原文件
+struct generated_file {
+    FILE* stream;
+    char* data;
+    size_t length;
+};
+
+FILE* open_generated_file(struct generated_file* file) {
+    memset(file, 0, sizeof(*file));
+#if defined(PLATFORM_WINDOWS)
+    // Windows没有open_memstream, 先写入临时文件, 关闭时读回内存
+    file->stream = tmpfile();
+#else
+    file->stream = open_memstream(&file->data, &file->length);
+#endif
+    if (!file->stream) perror("创建内存缓冲区失败");
+    return file->stream;
+}
+
+// 关闭内存流并写入path, 返回1成功
+int close_generated_file(struct generated_file* file, const char* path) {
+#if defined(PLATFORM_WINDOWS)
+    long size = fflush(file->stream) == 0 ? ftell(file->stream) : -1;
+    file->data = size >= 0 ? malloc((size_t)size + 1) : NULL;
+    if (file->data) {
+        rewind(file->stream);
+        file->length = fread(file->data, 1, (size_t)size, file->stream);
+    }
+    bool ok = file->data != NULL;
+    fclose(file->stream);
+#else
+    bool ok = fclose(file->stream) == 0;
+#endif
+    ok = ok && write_file_if_changed(path, file->data, file->length);
+    free(file->data);
+    memset(file, 0, sizeof(*file));
+    return ok;
+}
+
 bool create_precompile_headers(bool add_precompile_headers) {
     if (!add_precompile_headers) {
         return true;
     }
-    
-    // 保存当前工作目录
-    char cwd[1024];
-    if (getcwd(cwd, sizeof(cwd)) == NULL) {
-        perror("打开当前文件失败");
-        return false;
-    }
 
-    FILE* PCH_H = fopen("include/pch.h","w");
+    struct generated_file generated;
+    FILE* PCH_H = open_generated_file(&generated);
     if(!PCH_H){
         perror("打开pch.h失败");
+        return false;
     }
-    else{
-        printf("创建预编译头文件pch.h\n");
-        fprintf(PCH_H,"#ifndef PCH_H\n");
-        fprintf(PCH_H,"#define PCH_H\n\n");
-        fprintf(PCH_H,"#include <string>\n");
-        fprintf(PCH_H,"#include <iostream>\n");
-        fprintf(PCH_H,"#include <vector>\n");
-        fprintf(PCH_H,"#include <map>\n");
-        fprintf(PCH_H,"#include <array>\n");
-        fprintf(PCH_H,"#include <algorithm>\n");
-        fprintf(PCH_H,"#include <functional>\n");
-        fprintf(PCH_H,"#include <future>\n");
-        fprintf(PCH_H,"#include <mutex>\n");
-        fprintf(PCH_H,"#include <thread>\n\n");
-        fprintf(PCH_H,"#endif\n");
-    }
-    // 切换回原目录
-    if (chdir(cwd) != 0) {
-        perror("返回原目录失败");
-        // 即使目录恢复失败，仍返回先前操作的结果
-    }
-    
-    return true;
+    fprintf(PCH_H,"#ifndef PCH_H\n");
+    fprintf(PCH_H,"#define PCH_H\n\n");
+    fprintf(PCH_H,"#include <string>\n");
+    fprintf(PCH_H,"#include <iostream>\n");
+    fprintf(PCH_H,"#include <vector>\n");
+    fprintf(PCH_H,"#include <map>\n");
+    fprintf(PCH_H,"#include <array>\n");
+    fprintf(PCH_H,"#include <algorithm>\n");
+    fprintf(PCH_H,"#include <functional>\n");
+    fprintf(PCH_H,"#include <future>\n");
+    fprintf(PCH_H,"#include <mutex>\n");
+    fprintf(PCH_H,"#include <thread>\n\n");
+    fprintf(PCH_H,"#endif\n");
+    printf("创建预编译头文件pch.h\n");
+    return close_generated_file(&generated, "include/pch.h");
 }
 
-int create_cmake_toml(const char* project_name, const char* project_type, char deps[][MAX_PATH_LEN], int num_deps, bool add_precompile_headers) {
-    FILE* toml_file = fopen("CMake.toml", "w");
+int create_cmake_toml(const char* project_name, const char* project_type, const struct string_list* deps, bool add_precompile_headers) {
+    struct generated_file generated;
+    FILE* toml_file = open_generated_file(&generated);
     if (!toml_file) {
         perror("创建CMake.toml失败");
         return 0;
@@ -173,17 +569,26 @@ int create_cmake_toml(const char* project_name, const char* project_type, char d
         fprintf(toml_file, "precompile_headers = true\n");
     }
     fprintf(toml_file, "version = \"1.0.0\"\n\n");
+
+    fprintf(toml_file, "# 构建配置\n");
+    fprintf(toml_file, "[build]\n");
+    fprintf(toml_file, "cache = \"auto\"  # 编译器缓存: none/ccache/sccache/auto\n\n");
     
     fprintf(toml_file, "# 依赖配置\n");
     fprintf(toml_file, "[dependencies]\n");
     
     // 添加命令行指定的依赖项
-    for (int i = 0; i < num_deps; i++) {
-        fprintf(toml_file, "%s = \"latest\"\n", deps[i]);
+    for (size_t i = 0; i < deps->count; i++) {
+        // 命令行中的依赖可以带版本约束,例如 fmt>=9.1
+        const char* spec = deps->items[i];
+        size_t name_length = strcspn(spec, "<>= ");
+        const char* constraint = spec + name_length;
+        while (*constraint == ' ') constraint++;
+        fprintf(toml_file, "%.*s = \"%s\"\n", (int)name_length, spec, *constraint ? constraint : "latest");
     }
     
     // 添加示例依赖项（作为注释）
-    if (num_deps == 0) {
+    if (deps->count == 0) {
         fprintf(toml_file, "# fmt = \"9.1.0\"\n");
         fprintf(toml_file, "# boost = \"1.83.0\"\n");
         fprintf(toml_file, "# sdl2 = \"2.28.5\"\n");
@@ -191,1010 +596,8082 @@ int create_cmake_toml(const char* project_name, const char* project_type, char d
         fprintf(toml_file, "# json = { name = \"nlohmann_json\", version = \"3.11.2\" }\n");
     }
     
-    fclose(toml_file);
-    return 1;
+    return close_generated_file(&generated, "CMake.toml");
 }
 
-// 移除字符串首尾的空白字符和引号
-void trim_string(char *str) {
-    if (!str || !*str) return;
-    
-    char *start = str;
-    char *end = start + strlen(str);
-    
-    // 去除前面的空白和引号
-    while (isspace((unsigned char)*start) || *start == '"' || *start == '\'') start++;
-    
-    // 去除后面的空白和引号
-    while (end > start && (isspace((unsigned char)*(end-1)) || *(end-1) == '"' || *(end-1) == '\'')) end--;
-    
-    // 移动字符
-    memmove(str, start, end - start);
-    str[end - start] = '\0';
+// TOML文档模型: 所有节点和字符串都分配在文档的内存池中
+enum toml_type {
+    TOML_STRING,
+    TOML_INTEGER,
+    TOML_FLOAT,
+    TOML_BOOLEAN,
+    TOML_DATETIME,  // 以原始文本保存
+    TOML_ARRAY,
+    TOML_TABLE,
+};
+
+struct toml_table;
+
+struct toml_value {
+    enum toml_type type;
+    int line;  // 定义所在的行,用于错误提示
+    union {
+        const char* string;
+        int64_t integer;
+        double floating;
+        bool boolean;
+        struct {
+            struct toml_value** items;
+            size_t count;
+            size_t capacity;
+            bool of_tables;  // 由 [[name]] 定义的表数组
+        } array;
+        struct toml_table* table;
+    } as;
+};
+
+struct toml_table {
+    const char** keys;          // 保持定义顺序
+    struct toml_value** values;
+    size_t count;
+    size_t capacity;
+    bool defined;    // 已由[name]或键值对显式定义,不能再次定义
+    bool is_inline;  // 内联表定义后不能再添加键
+};
+
+struct toml_document {
+    struct arena arena;
+    struct toml_table* root;
+};
+
+struct toml_parser {
+    const char* p;
+    const char* end;
+    const char* line_start;
+    int line;
+    struct arena* arena;
+    char* error;
+    size_t error_size;
+    bool failed;
+};
+
+// 记录第一个错误(带行列号),返回NULL便于直接return
+void* toml_error(struct toml_parser* parser, const char* format, ...) {
+    if (parser->failed) return NULL;
+    parser->failed = true;
+    int length = snprintf(parser->error, parser->error_size, "第%d行第%d列: ",
+                          parser->line, (int)(parser->p - parser->line_start) + 1);
+    if (length >= 0 && (size_t)length < parser->error_size) {
+        va_list args;
+        va_start(args, format);
+        vsnprintf(parser->error + length, parser->error_size - length, format, args);
+        va_end(args);
+    }
+    return NULL;
 }
 
-// 智能解析CMake.toml文件
-int parse_cmake_toml(char* project_name, char* project_type, char deps[][MAX_PATH_LEN], int* num_deps, bool* add_precompile_headers) {
-    FILE* toml_file = fopen("CMake.toml", "r");
-    if (!toml_file) return 0;
-    
-    char line[BUFFER_SIZE];
-    int in_project = 0;
-    int in_dependencies = 0;
-    *num_deps = 0;
-    
-    // 设置默认值
-    strcpy(project_type, "executable");
+struct toml_value* toml_new_value(struct toml_parser* parser, enum toml_type type) {
+    struct toml_value* value = arena_alloc(parser->arena, sizeof(*value));
+    if (!value) return toml_error(parser, "内存不足");
+    memset(value, 0, sizeof(*value));
+    value->type = type;
+    value->line = parser->line;
+    return value;
+}
 
-    while (fgets(line, sizeof(line), toml_file)) {
-        // 移除行尾换行符
-        line[strcspn(line, "\r\n")] = '\0';
-        
-        // 跳过空行
-        if (strlen(line) == 0) continue;
-        
-        // 检测区块
-        if (strstr(line, "[project]")) {
-            in_project = 1;
-            in_dependencies = 0;
-            continue;
-        } 
-        else if (strstr(line, "[dependencies]")) {
-            in_project = 0;
-            in_dependencies = 1;
-            continue;
-        } 
-        else if (line[0] == '[') {
-            in_project = 0;
-            in_dependencies = 0;
-            continue;
+struct toml_value* toml_new_table(struct toml_parser* parser) {
+    struct toml_value* value = toml_new_value(parser, TOML_TABLE);
+    if (!value) return NULL;
+    value->as.table = arena_alloc(parser->arena, sizeof(struct toml_table));
+    if (!value->as.table) return toml_error(parser, "内存不足");
+    memset(value->as.table, 0, sizeof(struct toml_table));
+    return value;
+}
+
+struct toml_value* toml_table_get(const struct toml_table* table, const char* key) {
+    if (!table) return NULL;
+    for (size_t i = 0; i < table->count; i++) {
+        if (!strcmp(table->keys[i], key)) return table->values[i];
+    }
+    return NULL;
+}
+
+bool toml_table_put(struct toml_parser* parser, struct toml_table* table, const char* key, struct toml_value* value) {
+    if (toml_table_get(table, key)) {
+        toml_error(parser, "重复定义的键 \"%s\"", key);
+        return false;
+    }
+    if (table->count == table->capacity) {
+        size_t capacity = table->capacity ? table->capacity * 2 : 8;
+        const char** keys = arena_alloc(parser->arena, capacity * sizeof(*keys));
+        struct toml_value** values = arena_alloc(parser->arena, capacity * sizeof(*values));
+        if (!keys || !values) {
+            toml_error(parser, "内存不足");
+            return false;
         }
-        
-        // 跳过注释行
-        if (line[0] == '#') continue;
-        
-        // 解析项目信息
-        if (in_project) {
-            char* key = strtok(line, "=");
-            char* value = strtok(NULL, "\0");
-            if (!key || !value) continue;
-            
-            // 去除键和值两侧的空格
-            trim_string(key);
-            trim_string(value);
-            
-            // 去除值两侧的引号
-            char* v = value;
-            while (*v == '"' || *v == '\'') v++;
-            char* end = v + strlen(v) - 1;
-            while (end > v && (*end == '"' || *end == '\'')) end--;
-            *(end+1) = '\0';
-            
-            if (strstr(key, "name")) {
-                strncpy(project_name, v, MAX_PATH_LEN);
-            } 
-            else if (strstr(key, "type")) {
-                strncpy(project_type, v, 15);
+        if (table->count) {
+            memcpy(keys, table->keys, table->count * sizeof(*keys));
+            memcpy(values, table->values, table->count * sizeof(*values));
+        }
+        table->keys = keys;
+        table->values = values;
+        table->capacity = capacity;
+    }
+    table->keys[table->count] = key;
+    table->values[table->count] = value;
+    table->count++;
+    return true;
+}
+
+bool toml_array_push(struct toml_parser* parser, struct toml_value* array, struct toml_value* item) {
+    if (array->as.array.count == array->as.array.capacity) {
+        size_t capacity = array->as.array.capacity ? array->as.array.capacity * 2 : 8;
+        struct toml_value** items = arena_alloc(parser->arena, capacity * sizeof(*items));
+        if (!items) {
+            toml_error(parser, "内存不足");
+            return false;
+        }
+        if (array->as.array.count) {
+            memcpy(items, array->as.array.items, array->as.array.count * sizeof(*items));
+        }
+        array->as.array.items = items;
+        array->as.array.capacity = capacity;
+    }
+    array->as.array.items[array->as.array.count++] = item;
+    return true;
+}
+
+// 把Unicode码点编码为UTF-8
+bool string_buffer_append_codepoint(struct string_buffer* buffer, uint32_t cp) {
+    char out[4];
+    size_t length;
+    if (cp < 0x80) {
+        out[0] = (char)cp;
+        length = 1;
+    } 
+    else if (cp < 0x800) {
+        out[0] = (char)(0xC0 | (cp >> 6));
+        out[1] = (char)(0x80 | (cp & 0x3F));
+        length = 2;
+    } 
+    else if (cp < 0x10000) {
+        out[0] = (char)(0xE0 | (cp >> 12));
+        out[1] = (char)(0x80 | ((cp >> 6) & 0x3F));
+        out[2] = (char)(0x80 | (cp & 0x3F));
+        length = 3;
+    } 
+    else {
+        out[0] = (char)(0xF0 | (cp >> 18));
+        out[1] = (char)(0x80 | ((cp >> 12) & 0x3F));
+        out[2] = (char)(0x80 | ((cp >> 6) & 0x3F));
+        out[3] = (char)(0x80 | (cp & 0x3F));
+        length = 4;
+    }
+    return string_buffer_append(buffer, out, length);
+}
+
+void toml_skip_whitespace(struct toml_parser* parser) {
+    while (parser->p < parser->end && (*parser->p == ' ' || *parser->p == '\t')) parser->p++;
+}
+
+bool toml_at_newline(const struct toml_parser* parser) {
+    return parser->p < parser->end && (*parser->p == '\n' || (*parser->p == '\r' && parser->p + 1 < parser->end && parser->p[1] == '\n'));
+}
+
+void toml_consume_newline(struct toml_parser* parser) {
+    if (*parser->p == '\r') parser->p++;
+    parser->p++;
+    parser->line++;
+    parser->line_start = parser->p;
+}
+
+void toml_skip_comment(struct toml_parser* parser) {
+    if (parser->p < parser->end && *parser->p == '#') {
+        while (parser->p < parser->end && *parser->p != '\n' && *parser->p != '\r') parser->p++;
+    }
+}
+
+// 跳过空白、注释和换行(数组内部)
+void toml_skip_blank(struct toml_parser* parser) {
+    for (;;) {
+        toml_skip_whitespace(parser);
+        toml_skip_comment(parser);
+        if (toml_at_newline(parser)) toml_consume_newline(parser);
+        else break;
+    }
+}
+
+// 当前行剩余部分只能是空白和注释
+bool toml_expect_line_end(struct toml_parser* parser) {
+    toml_skip_whitespace(parser);
+    toml_skip_comment(parser);
+    if (parser->p >= parser->end) return true;
+    if (toml_at_newline(parser)) {
+        toml_consume_newline(parser);
+        return true;
+    }
+    toml_error(parser, "意外的字符 '%c'", *parser->p);
+    return false;
+}
+
+bool toml_starts_with(const struct toml_parser* parser, const char* text) {
+    size_t length = strlen(text);
+    return (size_t)(parser->end - parser->p) >= length && !memcmp(parser->p, text, length);
+}
+
+// 基本字符串 "..." 和多行基本字符串 """...""",处理转义序列
+const char* toml_parse_basic_string(struct toml_parser* parser) {
+    bool multiline = toml_starts_with(parser, "\"\"\"");
+    parser->p += multiline ? 3 : 1;
+    // 多行字符串紧跟开头引号的换行被忽略
+    if (multiline && toml_at_newline(parser)) toml_consume_newline(parser);
+
+    struct string_buffer buffer = {0};
+    string_buffer_append(&buffer, "", 0);
+    for (;;) {
+        if (parser->p >= parser->end) {
+            free(buffer.data);
+            return toml_error(parser, "字符串未结束");
+        }
+        char c = *parser->p;
+        if (multiline && toml_starts_with(parser, "\"\"\"")) {
+            // 结尾最多可以额外包含两个引号: """a""""" 表示 a""
+            size_t quotes = 0;
+            while (parser->p + quotes < parser->end && parser->p[quotes] == '"') quotes++;
+            if (quotes > 5) {
+                free(buffer.data);
+                return toml_error(parser, "多行字符串结尾的引号过多");
             }
-            else if (strstr(key,"precompile_headers")){
-                if(!strcmp("true",v)){
-                    *add_precompile_headers = true;
-                }
-                else if(!strcmp("false",v)){
-                    *add_precompile_headers = false;
-                }
+            string_buffer_append(&buffer, "\"\"", quotes - 3);
+            parser->p += quotes;
+            break;
+        }
+        if (!multiline && c == '"') {
+            parser->p++;
+            break;
+        }
+        if (toml_at_newline(parser)) {
+            if (!multiline) {
+                free(buffer.data);
+                return toml_error(parser, "字符串中不能包含换行");
             }
+            string_buffer_append(&buffer, "\n", 1);
+            toml_consume_newline(parser);
+            continue;
         }
-        
-        // 解析依赖项
-        if (in_dependencies) {
-            char dep_name[MAX_PATH_LEN] = {0};
-            char* name_start = line;
-            
-            // 跳过开头空格
-            while (isspace(*name_start)) name_start++;
-            
-            // 解析简单依赖格式: name = "version"
-            if (*num_deps < MAX_DEPS) {
-                char* equal_sign = strchr(name_start, '=');
-                char* open_brace = strchr(name_start, '{');
-                
-                // 简单格式: key = value
-                if (equal_sign && (!open_brace || equal_sign < open_brace)) {
-                    *equal_sign = '\0';
-                    trim_string(name_start);
-                    strncpy(deps[*num_deps], name_start, MAX_PATH_LEN);
-                    (*num_deps)++;
-                }
-                // 复杂格式: key = { ... }
-                else if (open_brace) {
-                    char* name_end = open_brace;
-                    while (name_end > name_start && isspace(*(name_end-1))) name_end--;
-                    *name_end = '\0';
-                    trim_string(name_start);
-                    strncpy(deps[*num_deps], name_start, MAX_PATH_LEN);
-                    (*num_deps)++;
+        if (c == '\\') {
+            parser->p++;
+            if (parser->p >= parser->end) continue;
+            char escape = *parser->p;
+            // 行尾反斜杠: 删除换行以及下一行开头的空白
+            if (multiline && (escape == ' ' || escape == '\t' || escape == '\n' || escape == '\r')) {
+                const char* q = parser->p;
+                while (q < parser->end && (*q == ' ' || *q == '\t')) q++;
+                if (q < parser->end && (*q == '\n' || *q == '\r')) {
+                    parser->p = q;
+                    while (parser->p < parser->end) {
+                        if (toml_at_newline(parser)) toml_consume_newline(parser);
+                        else if (*parser->p == ' ' || *parser->p == '\t') parser->p++;
+                        else break;
+                    }
+                    continue;
                 }
-                // 简单名称格式: name
-                else {
-                    char* name_end = name_start;
-                    while (*name_end && !isspace(*name_end) && *name_end != '#') name_end++;
-                    *name_end = '\0';
-                    if (strlen(name_start) > 0) {
-                        strncpy(deps[*num_deps], name_start, MAX_PATH_LEN);
-                        (*num_deps)++;
+            }
+            parser->p++;
+            const char* replacement = NULL;
+            switch (escape) {
+                case 'b': replacement = "\b"; break;
+                case 't': replacement = "\t"; break;
+                case 'n': replacement = "\n"; break;
+                case 'f': replacement = "\f"; break;
+                case 'r': replacement = "\r"; break;
+                case 'e': replacement = "\x1b"; break;
+                case '"': replacement = "\""; break;
+                case '\\': replacement = "\\"; break;
+                case 'u':
+                case 'U': {
+                    int digits = escape == 'u' ? 4 : 8;
+                    uint32_t cp = 0;
+                    for (int i = 0; i < digits; i++) {
+                        if (parser->p >= parser->end || !isxdigit((unsigned char)*parser->p)) {
+                            free(buffer.data);
+                            return toml_error(parser, "无效的Unicode转义");
+                        }
+                        char h = *parser->p++;
+                        cp = cp * 16 + (uint32_t)(isdigit((unsigned char)h) ? h - '0' : (tolower((unsigned char)h) - 'a' + 10));
                     }
+                    if (cp > 0x10FFFF || (cp >= 0xD800 && cp <= 0xDFFF)) {
+                        free(buffer.data);
+                        return toml_error(parser, "无效的Unicode码点 U+%X", cp);
+                    }
+                    string_buffer_append_codepoint(&buffer, cp);
+                    continue;
                 }
+                default:
+                    free(buffer.data);
+                    return toml_error(parser, "无效的转义序列 \\%c", escape);
             }
+            string_buffer_append(&buffer, replacement, 1);
+            continue;
         }
+        if ((unsigned char)c < 0x20 && c != '\t') {
+            free(buffer.data);
+            return toml_error(parser, "字符串中包含控制字符");
+        }
+        string_buffer_append(&buffer, &c, 1);
+        parser->p++;
     }
-    
-    fclose(toml_file);
-    return strlen(project_name) > 0; // 返回是否成功解析了项目名称
+    const char* result = arena_strndup(parser->arena, buffer.data, buffer.length);
+    free(buffer.data);
+    return result ? result : toml_error(parser, "内存不足");
 }
 
-// 创建CMakeLists.txt文件（带依赖项处理）
-int create_cmakelists(const char* project_name, const char* project_type, char deps[][MAX_PATH_LEN], int num_deps, bool add_precompile_headers) {
-    FILE* cmake_file = fopen("CMakeLists.txt", "w");
-    if (!cmake_file) {
-        perror("创建CMakeLists.txt失败");
-        return 0;
+// 字面量字符串 '...' 和多行字面量字符串 '''...''',不处理转义
+const char* toml_parse_literal_string(struct toml_parser* parser) {
+    bool multiline = toml_starts_with(parser, "'''");
+    parser->p += multiline ? 3 : 1;
+    if (multiline && toml_at_newline(parser)) toml_consume_newline(parser);
+
+    struct string_buffer buffer = {0};
+    string_buffer_append(&buffer, "", 0);
+    for (;;) {
+        if (parser->p >= parser->end) {
+            free(buffer.data);
+            return toml_error(parser, "字符串未结束");
+        }
+        if (multiline && toml_starts_with(parser, "'''")) {
+            size_t quotes = 0;
+            while (parser->p + quotes < parser->end && parser->p[quotes] == '\'') quotes++;
+            if (quotes > 5) {
+                free(buffer.data);
+                return toml_error(parser, "多行字符串结尾的引号过多");
+            }
+            string_buffer_append(&buffer, "''", quotes - 3);
+            parser->p += quotes;
+            break;
+        }
+        if (!multiline && *parser->p == '\'') {
+            parser->p++;
+            break;
+        }
+        if (toml_at_newline(parser)) {
+            if (!multiline) {
+                free(buffer.data);
+                return toml_error(parser, "字符串中不能包含换行");
+            }
+            string_buffer_append(&buffer, "\n", 1);
+            toml_consume_newline(parser);
+            continue;
+        }
+        if ((unsigned char)*parser->p < 0x20 && *parser->p != '\t') {
+            free(buffer.data);
+            return toml_error(parser, "字符串中包含控制字符");
+        }
+        string_buffer_append(&buffer, parser->p, 1);
+        parser->p++;
     }
-    
-    fprintf(cmake_file, "cmake_minimum_required(VERSION 3.16)\n");
-    fprintf(cmake_file, "project(%s LANGUAGES CXX)\n\n", project_name);
-    fprintf(cmake_file, "set(CMAKE_CXX_STANDARD 11)\n");
-    fprintf(cmake_file, "set(CMAKE_CXX_STANDARD_REQUIRED ON)\n");
-    fprintf(cmake_file, "set(CMAKE_EXPORT_COMPILE_COMMANDS ON)\n\n");
-#ifdef PLATFORM_WINDOWS
-    if (num_deps > 0) {
-        fprintf(cmake_file, "# Windows平台依赖设置\n");
-        for (int i = 0; i < num_deps; i++) {
-            fprintf(cmake_file, "find_package(%s REQUIRED)\n", deps[i]);
+    const char* result = arena_strndup(parser->arena, buffer.data, buffer.length);
+    free(buffer.data);
+    return result ? result : toml_error(parser, "内存不足");
+}
+
+bool toml_is_bare_key_char(char c) {
+    return isalnum((unsigned char)c) || c == '_' || c == '-';
+}
+
+// 解析一个键片段: 裸键、"基本字符串"或'字面量字符串'
+const char* toml_parse_key_part(struct toml_parser* parser) {
+    if (parser->p >= parser->end) return toml_error(parser, "缺少键名");
+    if (*parser->p == '"') {
+        if (toml_starts_with(parser, "\"\"\"")) return toml_error(parser, "键名不能是多行字符串");
+        return toml_parse_basic_string(parser);
+    }
+    if (*parser->p == '\'') {
+        if (toml_starts_with(parser, "'''")) return toml_error(parser, "键名不能是多行字符串");
+        return toml_parse_literal_string(parser);
+    }
+    const char* start = parser->p;
+    while (parser->p < parser->end && toml_is_bare_key_char(*parser->p)) parser->p++;
+    if (parser->p == start) return toml_error(parser, "无效的键名");
+    const char* key = arena_strndup(parser->arena, start, (size_t)(parser->p - start));
+    return key ? key : toml_error(parser, "内存不足");
+}
+
+// 点分隔的键 a.b."c.d", 返回片段数组
+struct toml_key_path {
+    const char** parts;
+    size_t count;
+};
+
+bool toml_parse_key_path(struct toml_parser* parser, struct toml_key_path* path) {
+    size_t capacity = 4;
+    path->parts = arena_alloc(parser->arena, capacity * sizeof(*path->parts));
+    path->count = 0;
+    if (!path->parts) {
+        toml_error(parser, "内存不足");
+        return false;
+    }
+    for (;;) {
+        toml_skip_whitespace(parser);
+        const char* part = toml_parse_key_part(parser);
+        if (!part) return false;
+        if (path->count == capacity) {
+            const char** parts = arena_alloc(parser->arena, capacity * 2 * sizeof(*parts));
+            if (!parts) {
+                toml_error(parser, "内存不足");
+                return false;
+            }
+            memcpy(parts, path->parts, capacity * sizeof(*parts));
+            path->parts = parts;
+            capacity *= 2;
         }
-        fprintf(cmake_file, "\n");
+        path->parts[path->count++] = part;
+        toml_skip_whitespace(parser);
+        if (parser->p < parser->end && *parser->p == '.') {
+            parser->p++;
+            continue;
+        }
+        return true;
     }
-#else
-    // 添加PkgConfig支持
-    if (num_deps > 0) {
-        fprintf(cmake_file, "# 启用pkg-config\n");
-        fprintf(cmake_file, "find_package(PkgConfig REQUIRED)\n");
+}
+
+// 从table出发进入子表,不存在时创建; 表数组进入最后一个元素
+struct toml_table* toml_descend(struct toml_parser* parser, struct toml_table* table, const char* key, bool mark_defined) {
+    struct toml_value* value = toml_table_get(table, key);
+    if (!value) {
+        value = toml_new_table(parser);
+        if (!value || !toml_table_put(parser, table, key, value)) return NULL;
+        value->as.table->defined = mark_defined;
+        return value->as.table;
     }
-    
-    // 处理依赖项
-    for (int i = 0; i < num_deps; i++) {
-        fprintf(cmake_file, "pkg_check_modules(%s REQUIRED %s)\n", deps[i], deps[i]);
+    if (value->type == TOML_TABLE) {
+        if (value->as.table->is_inline) return toml_error(parser, "不能扩展内联表 \"%s\"", key);
+        return value->as.table;
     }
-    
-    if (num_deps > 0) {
-        fprintf(cmake_file, "\n# 设置包含目录\n");
-        fprintf(cmake_file, "include_directories(${PKG_CONFIG_INCLUDE_DIRS})\n");
-        fprintf(cmake_file, "link_directories(${PKG_CONFIG_LIBRARY_DIRS})\n");
-        fprintf(cmake_file, "add_definitions(${PKG_CONFIG_CFLAGS_OTHER})\n\n");
+    if (value->type == TOML_ARRAY && value->as.array.of_tables && value->as.array.count > 0) {
+        return value->as.array.items[value->as.array.count - 1]->as.table;
     }
-    else if (strcmp(project_type, "library") != 0) {
-        fprintf(cmake_file, "include_directories(include)\n\n");
+    return toml_error(parser, "键 \"%s\" 已定义为非表类型的值", key);
+}
+
+struct toml_value* toml_parse_value(struct toml_parser* parser);
+
+struct toml_value* toml_parse_array(struct toml_parser* parser) {
+    struct toml_value* array = toml_new_value(parser, TOML_ARRAY);
+    if (!array) return NULL;
+    parser->p++;  // '['
+    for (;;) {
+        toml_skip_blank(parser);
+        if (parser->p >= parser->end) return toml_error(parser, "数组未结束");
+        if (*parser->p == ']') {
+            parser->p++;
+            return array;
+        }
+        struct toml_value* item = toml_parse_value(parser);
+        if (!item || !toml_array_push(parser, array, item)) return NULL;
+        toml_skip_blank(parser);
+        if (parser->p >= parser->end) return toml_error(parser, "数组未结束");
+        if (*parser->p == ',') {
+            parser->p++;
+            continue;
+        }
+        if (*parser->p == ']') {
+            parser->p++;
+            return array;
+        }
+        return toml_error(parser, "数组元素之间缺少 ','");
     }
-#endif
-    
-    if (strcmp(project_type, "executable") == 0) {
-        fprintf(cmake_file, "set(CMAKE_RUNTIME_OUTPUT_DIRECTORY ${CMAKE_SOURCE_DIR}/bin)\n");
-        fprintf(cmake_file, "add_executable(%s\n", project_name);
-        fprintf(cmake_file, "    src/main.cpp\n");
-        fprintf(cmake_file, ")\n");
-        fprintf(cmake_file, "target_include_directories(%s PRIVATE ${CMAKE_SOURCE_DIR}/include)\n",project_name);
+}
 
-        // 安装规则（跨平台）
-        fprintf(cmake_file, "\n# 安装规则\n");
-        fprintf(cmake_file, "install(TARGETS %s\n", project_name);
-        fprintf(cmake_file, "    RUNTIME DESTINATION bin\n");
-        fprintf(cmake_file, ")\n");
-    } 
-    else if (strcmp(project_type, "static") == 0) {
-        fprintf(cmake_file, "set(CMAKE_ARCHIVE_OUTPUT_DIRECTORY ${CMAKE_SOURCE_DIR}/lib/static)\n");
-        fprintf(cmake_file, "add_library(%s STATIC\n", project_name);
-        fprintf(cmake_file, "    src/%s.cpp\n", project_name);
-        fprintf(cmake_file, ")\n");
-        fprintf(cmake_file, "target_include_directories(%s PRIVATE ${CMAKE_SOURCE_DIR}/include)\n",project_name);
+// 在table中按键路径设置值, 中间的片段创建(或进入)子表
+bool toml_assign(struct toml_parser* parser, struct toml_table* table, const struct toml_key_path* path, struct toml_value* value) {
+    for (size_t i = 0; i + 1 < path->count; i++) {
+        struct toml_value* existing = toml_table_get(table, path->parts[i]);
+        if (existing && existing->type == TOML_ARRAY) {
+            toml_error(parser, "不能通过点分隔的键扩展数组 \"%s\"", path->parts[i]);
+            return false;
+        }
+        table = toml_descend(parser, table, path->parts[i], true);
+        if (!table) return false;
+    }
+    return toml_table_put(parser, table, path->parts[path->count - 1], value);
+}
 
-        // 安装规则（跨平台）
-        fprintf(cmake_file, "\n# 安装规则\n");
-        fprintf(cmake_file, "install(TARGETS %s\n", project_name);
-        fprintf(cmake_file, "    ARCHIVE DESTINATION lib\n");
-        fprintf(cmake_file, ")\n");
-        fprintf(cmake_file, "install(FILES include/%s.h DESTINATION include)\n", project_name);
-    } 
-    else if (strcmp(project_type, "shared") == 0) {
-        fprintf(cmake_file, "set(CMAKE_LIBRARY_OUTPUT_DIRECTORY ${CMAKE_SOURCE_DIR}/lib/shared)\n");
-        fprintf(cmake_file, "add_library(%s SHARED\n", project_name);
-        fprintf(cmake_file, "    src/%s.cpp\n", project_name);
-        fprintf(cmake_file, ")\n");
-        fprintf(cmake_file, "target_include_directories(%s PRIVATE ${CMAKE_SOURCE_DIR}/include)\n",project_name);
-        
-        // 安装规则（跨平台）
-        fprintf(cmake_file, "\n# 安装规则\n");
-        fprintf(cmake_file, "install(TARGETS %s\n", project_name);
-        fprintf(cmake_file, "    LIBRARY DESTINATION lib\n");
-        fprintf(cmake_file, ")\n");
-        fprintf(cmake_file, "install(FILES include/%s.h DESTINATION include)\n", project_name);
+// 内联表 { a = 1, b.c = "x" }, 必须写在一行内
+struct toml_value* toml_parse_inline_table(struct toml_parser* parser) {
+    struct toml_value* value = toml_new_table(parser);
+    if (!value) return NULL;
+    value->as.table->defined = true;
+    parser->p++;  // '{'
+    toml_skip_whitespace(parser);
+    if (parser->p < parser->end && *parser->p == '}') {
+        parser->p++;
+        value->as.table->is_inline = true;
+        return value;
     }
-    if(add_precompile_headers){
-        fprintf(cmake_file, "set(PRECOMPILED_HEADER ${CMAKE_SOURCE_DIR}/include/pch.h)\n");
-        fprintf(cmake_file, "if(MSVC)\n");
-        fprintf(cmake_file, "\tset_target_properties(%s PROPERTIES\n",project_name);
-        fprintf(cmake_file, "\t\tCOMPILE_FLAGS \"/Yu\"${PRECOMPILED_HEADER}\"\"\n");
-        fprintf(cmake_file, "\t)\n");
-        fprintf(cmake_file, "\tset_source_files_properties(${PRECOMPILED_HEADER} PROPERTIES\n");
-        fprintf(cmake_file, "\t\tCOMPILE_FLAGS \"/Yc\"${PRECOMPILED_HEADER}\"\"\n");
-        fprintf(cmake_file, "\t)\n");
-        fprintf(cmake_file, "elseif(CMAKE_CXX_COMPILER_ID MATCHES \"GNU|Clang\")\n");
-        fprintf(cmake_file, "\tset(PCH_OUTPUT \"${CMAKE_BINARY_DIR}/pch.h.gch\")\n");
-        fprintf(cmake_file, "\tadd_custom_command(\n");
-        fprintf(cmake_file, "\t\tOUTPUT ${PCH_OUTPUT}\n");
-        fprintf(cmake_file, "\t\tCOMMAND ${CMAKE_CXX_COMPILER}\n");
-        fprintf(cmake_file, "\t\t\t\t${CMAKE_CXX_FLAGS}\n");
-        fprintf(cmake_file, "\t\t\t\t-x c++-header\n");
-        fprintf(cmake_file, "\t\t\t\t-o ${PCH_OUTPUT}\n");
-        fprintf(cmake_file, "\t\t\t\t-I ${CMAKE_SOURCE_DIR}/include\n");
-        fprintf(cmake_file, "\t\t\t\t${PRECOMPILED_HEADER}\n");
-        fprintf(cmake_file, "\t\tDEPENDS ${PRECOMPILED_HEADER}\n");
-        fprintf(cmake_file, "\t)\n");
-        fprintf(cmake_file, "\tadd_custom_target(pch_target DEPENDS ${PCH_OUTPUT})\n");
-        fprintf(cmake_file, "\tadd_dependencies(%s pch_target)\n",project_name);
-        fprintf(cmake_file, "\ttarget_compile_options(%s PRIVATE\n",project_name);
-        fprintf(cmake_file, "\t\t-include ${PRECOMPILED_HEADER}\n");
-        fprintf(cmake_file, "\t)\n");
-        fprintf(cmake_file, "endif()\n");
+    for (;;) {
+        struct toml_key_path path;
+        if (!toml_parse_key_path(parser, &path)) return NULL;
+        if (parser->p >= parser->end || *parser->p != '=') return toml_error(parser, "内联表中的键后缺少 '='");
+        parser->p++;
+        toml_skip_whitespace(parser);
+        struct toml_value* item = toml_parse_value(parser);
+        if (!item || !toml_assign(parser, value->as.table, &path, item)) return NULL;
+        toml_skip_whitespace(parser);
+        if (parser->p < parser->end && *parser->p == ',') {
+            parser->p++;
+            continue;
+        }
+        if (parser->p < parser->end && *parser->p == '}') {
+            parser->p++;
+            break;
+        }
+        return toml_error(parser, "内联表未结束(内联表必须写在同一行)");
+    }
+    value->as.table->is_inline = true;
+    return value;
+}
+
+// 数字、日期时间: 先取出完整的词,再判断类型
+struct toml_value* toml_parse_scalar(struct toml_parser* parser) {
+    const char* start = parser->p;
+    while (parser->p < parser->end && (isalnum((unsigned char)*parser->p) || strchr("+-._:", *parser->p))) parser->p++;
+    // 日期和时间之间可以用空格分隔: 1979-05-27 07:32:00
+    if (parser->p - start == 10 && start[4] == '-' && start[7] == '-' && parser->end - parser->p > 3
+        && parser->p[0] == ' ' && isdigit((unsigned char)parser->p[1]) && isdigit((unsigned char)parser->p[2]) && parser->p[3] == ':') {
+        parser->p++;
+        while (parser->p < parser->end && (isalnum((unsigned char)*parser->p) || strchr("+-._:", *parser->p))) parser->p++;
+    }
+    size_t length = (size_t)(parser->p - start);
+    if (length == 0) return toml_error(parser, "缺少值");
+    char* text = arena_strndup(parser->arena, start, length);
+    if (!text) return toml_error(parser, "内存不足");
+
+    if (!strcmp(text, "true") || !strcmp(text, "false")) {
+        struct toml_value* value = toml_new_value(parser, TOML_BOOLEAN);
+        if (value) value->as.boolean = text[0] == 't';
+        return value;
+    }
+    // 日期时间: YYYY-MM-DD... 或 HH:MM:SS...
+    if ((length >= 10 && isdigit((unsigned char)text[0]) && text[4] == '-' && text[7] == '-')
+        || (length >= 8 && isdigit((unsigned char)text[0]) && text[2] == ':')) {
+        struct toml_value* value = toml_new_value(parser, TOML_DATETIME);
+        if (value) value->as.string = text;
+        return value;
     }
-#ifdef PLATFOROM_WINDOWS
-    if(num_deps > 0){
-        fprintf(cmake_file, "\n# Windows平台链接依赖库\n");
-        fprintf(cmake_file, "target_include_directories(%s PRIVATE\n", project_name);
-        for (int i = 0; i < num_deps; i++) {
-            fprintf(cmake_file, "    ${%s_INCLUDE_DIRS}\n", deps[i]);
+
+    const char* body = text;
+    if (*body == '+' || *body == '-') body++;
+    if (!strcmp(body, "inf") || !strcmp(body, "nan")) {
+        struct toml_value* value = toml_new_value(parser, TOML_FLOAT);
+        if (value) value->as.floating = (!strcmp(body, "inf") ? HUGE_VAL : NAN) * (text[0] == '-' ? -1 : 1);
+        return value;
+    }
+
+    // 下划线只能出现在两个数字之间
+    int base = 10;
+    if (body == text && text[0] == '0' && (text[1] == 'x' || text[1] == 'o' || text[1] == 'b')) {
+        base = text[1] == 'x' ? 16 : (text[1] == 'o' ? 8 : 2);
+        body = text + 2;
+    }
+    char* digits = arena_alloc(parser->arena, length + 1);
+    if (!digits) return toml_error(parser, "内存不足");
+    size_t n = 0;
+    bool is_float = false;
+    for (const char* c = text + (base == 10 ? 0 : 2); *c; c++) {
+        if (*c == '_') {
+            if (c == text || !isxdigit((unsigned char)c[-1]) || !isxdigit((unsigned char)c[1])) {
+                return toml_error(parser, "无效的数字 \"%s\"", text);
+            }
+            continue;
         }
-        fprintf(cmake_file, ")\n");
-        
-        fprintf(cmake_file, "target_link_libraries(%s PRIVATE\n", project_name);
-        for (int i = 0; i < num_deps; i++) {
-            fprintf(cmake_file, "    ${%s_LIBRARIES}\n", deps[i]);
+        if (base == 10 && (*c == '.' || *c == 'e' || *c == 'E')) is_float = true;
+        digits[n++] = *c;
+    }
+    digits[n] = '\0';
+
+    char* end = NULL;
+    errno = 0;
+    if (is_float) {
+        double number = strtod(digits, &end);
+        if (*end != '\0' || digits[0] == '.' || strstr(digits, ".e") || strstr(digits, ".E") || digits[n - 1] == '.') {
+            return toml_error(parser, "无效的浮点数 \"%s\"", text);
         }
-        fprintf(cmake_file, ")\n");
+        struct toml_value* value = toml_new_value(parser, TOML_FLOAT);
+        if (value) value->as.floating = number;
+        return value;
     }
-#else
-    // 链接依赖库
-    if (num_deps > 0) {
-        fprintf(cmake_file, "\n# 链接依赖库\n");
-        fprintf(cmake_file, "target_link_libraries(%s PRIVATE\n", project_name);
-        for (int i = 0; i < num_deps; i++) {
-            fprintf(cmake_file, "    ${%s_LIBRARIES}\n", deps[i]);
+    // 十进制整数不能有前导零
+    const char* first_digit = digits + (digits[0] == '+' || digits[0] == '-');
+    if (base == 10 && first_digit[0] == '0' && first_digit[1] != '\0') {
+        return toml_error(parser, "整数不能有前导零: \"%s\"", text);
+    }
+    if (*first_digit == '\0') return toml_error(parser, "无效的值 \"%s\"", text);
+    long long number = strtoll(digits, &end, base);
+    if (*end != '\0') return toml_error(parser, "无效的值 \"%s\"", text);
+    if (errno == ERANGE) return toml_error(parser, "整数超出范围: \"%s\"", text);
+    struct toml_value* value = toml_new_value(parser, TOML_INTEGER);
+    if (value) value->as.integer = number;
+    return value;
+}
+
+struct toml_value* toml_parse_value(struct toml_parser* parser) {
+    if (parser->p >= parser->end) return toml_error(parser, "缺少值");
+    char c = *parser->p;
+    if (c == '"' || c == '\'') {
+        int line = parser->line;
+        const char* text = c == '"' ? toml_parse_basic_string(parser) : toml_parse_literal_string(parser);
+        if (!text) return NULL;
+        struct toml_value* value = toml_new_value(parser, TOML_STRING);
+        if (!value) return NULL;
+        value->as.string = text;
+        value->line = line;
+        return value;
+    }
+    if (c == '[') return toml_parse_array(parser);
+    if (c == '{') return toml_parse_inline_table(parser);
+    return toml_parse_scalar(parser);
+}
+
+// [a.b] 和 [[a.b]] 表头, 返回之后的键值对所属的表
+struct toml_table* toml_parse_header(struct toml_parser* parser, struct toml_table* root) {
+    bool array_of_tables = toml_starts_with(parser, "[[");
+    parser->p += array_of_tables ? 2 : 1;
+    struct toml_key_path path;
+    if (!toml_parse_key_path(parser, &path)) return NULL;
+    if (array_of_tables ? !toml_starts_with(parser, "]]") : !toml_starts_with(parser, "]")) {
+        return toml_error(parser, "表头缺少 '%s'", array_of_tables ? "]]" : "]");
+    }
+    parser->p += array_of_tables ? 2 : 1;
+
+    struct toml_table* table = root;
+    for (size_t i = 0; i + 1 < path.count; i++) {
+        table = toml_descend(parser, table, path.parts[i], false);
+        if (!table) return NULL;
+    }
+    const char* last = path.parts[path.count - 1];
+    struct toml_value* existing = toml_table_get(table, last);
+
+    if (array_of_tables) {
+        if (!existing) {
+            existing = toml_new_value(parser, TOML_ARRAY);
+            if (!existing || !toml_table_put(parser, table, last, existing)) return NULL;
+            existing->as.array.of_tables = true;
+        } 
+        else if (existing->type != TOML_ARRAY || !existing->as.array.of_tables) {
+            return toml_error(parser, "\"%s\" 已定义为非表数组的值", last);
         }
-        fprintf(cmake_file, ")\n");
+        struct toml_value* element = toml_new_table(parser);
+        if (!element || !toml_array_push(parser, existing, element)) return NULL;
+        element->as.table->defined = true;
+        return element->as.table;
     }
-#endif
-    fclose(cmake_file);
-    return 1;
+
+    if (!existing) {
+        struct toml_value* value = toml_new_table(parser);
+        if (!value || !toml_table_put(parser, table, last, value)) return NULL;
+        value->as.table->defined = true;
+        return value->as.table;
+    }
+    if (existing->type != TOML_TABLE || existing->as.table->is_inline) {
+        return toml_error(parser, "\"%s\" 已定义为其他类型的值", last);
+    }
+    if (existing->as.table->defined) {
+        return toml_error(parser, "重复定义的表 [%s]", last);
+    }
+    existing->as.table->defined = true;
+    return existing->as.table;
 }
 
-int create_directory(const char* path) {
-    if (MKDIR(path) == -1) {
-        if (errno != EEXIST) {
-            perror("创建目录失败");
-            return 0;
+// 解析TOML文本, 失败时返回NULL并在error中写入带行号的错误信息
+struct toml_document* toml_parse(const char* data, size_t length, char* error, size_t error_size) {
+    struct toml_document* doc = calloc(1, sizeof(*doc));
+    if (!doc) return NULL;
+    struct toml_parser parser = { data, data + length, data, 1, &doc->arena, error, error_size, false };
+    // 跳过UTF-8 BOM
+    if (length >= 3 && !memcmp(data, "\xEF\xBB\xBF", 3)) parser.p += 3;
+
+    struct toml_value* root = toml_new_table(&parser);
+    if (root) {
+        doc->root = root->as.table;
+        doc->root->defined = true;
+    }
+    struct toml_table* current = doc->root;
+    while (!parser.failed && parser.p < parser.end) {
+        toml_skip_whitespace(&parser);
+        toml_skip_comment(&parser);
+        if (parser.p >= parser.end) break;
+        if (toml_at_newline(&parser)) {
+            toml_consume_newline(&parser);
+            continue;
+        }
+        if (*parser.p == '[') {
+            current = toml_parse_header(&parser, doc->root);
+            if (current) toml_expect_line_end(&parser);
+            continue;
         }
+        struct toml_key_path path;
+        if (!toml_parse_key_path(&parser, &path)) break;
+        if (parser.p >= parser.end || *parser.p != '=') {
+            toml_error(&parser, "键 \"%s\" 后缺少 '='", path.parts[path.count - 1]);
+            break;
+        }
+        parser.p++;
+        toml_skip_whitespace(&parser);
+        struct toml_value* value = toml_parse_value(&parser);
+        if (!value || !toml_assign(&parser, current, &path, value)) break;
+        toml_expect_line_end(&parser);
     }
-    return 1;
+    if (parser.failed || !doc->root) {
+        if (!parser.failed) snprintf(error, error_size, "内存不足");
+        arena_free(&doc->arena);
+        free(doc);
+        return NULL;
+    }
+    return doc;
 }
 
-// 创建初始的main.cpp文件
-int create_main_cpp_file(bool add_precompile_headers) {
-    FILE* main_file = fopen("src/main.cpp", "w");
-    if (!main_file) {
-        perror("创建main.cpp失败");
-        return 0;
+// 一次读入整个文件后解析; missing不为NULL时报告失败是否因为文件不存在(而不是读取或语法错误)
+struct toml_document* toml_parse_file(const char* path, char* error, size_t error_size, bool* missing) {
+    size_t length = 0;
+    if (missing) *missing = false;
+    char* data = read_file_contents(path, &length);
+    if (!data) {
+        if (missing) *missing = errno == ENOENT;
+        snprintf(error, error_size, "无法读取 %s: %s", path, strerror(errno));
+        return NULL;
     }
-    if(add_precompile_headers) fprintf(main_file, "#include \"pch.h\"\n");
-    fprintf(main_file, "#include <iostream>\n\n");
-    fprintf(main_file, "int main() {\n");
-    fprintf(main_file, "    std::cout << \"Hello, World!\" << std::endl;\n");
-    fprintf(main_file, "    return 0;\n");
-    fprintf(main_file, "}\n");
-    fclose(main_file);
-    return 1;
+    struct toml_document* doc = toml_parse(data, length, error, error_size);
+    free(data);
+    return doc;
 }
 
-// 创建库源文件和头文件
-int create_library_files(const char* project_name, bool add_precompile_headers) {
-    // 创建源文件
-    char src_filename[MAX_PATH_LEN];
-    snprintf(src_filename, MAX_PATH_LEN, "src/%s.cpp", project_name);
-    FILE* src_file = fopen(src_filename, "w");
-    if (!src_file) {
-        perror("创建库源文件失败");
-        return 0;
+void toml_free(struct toml_document* doc) {
+    if (!doc) return;
+    arena_free(&doc->arena);
+    free(doc);
+}
+
+// 取子表, 键不存在或不是表时返回NULL
+const struct toml_table* toml_get_table(const struct toml_table* table, const char* key) {
+    const struct toml_value* value = toml_table_get(table, key);
+    return value && value->type == TOML_TABLE ? value->as.table : NULL;
+}
+
+const char* toml_type_name(enum toml_type type) {
+    switch (type) {
+        case TOML_STRING:   return "字符串";
+        case TOML_INTEGER:  return "整数";
+        case TOML_FLOAT:    return "浮点数";
+        case TOML_BOOLEAN:  return "布尔值";
+        case TOML_DATETIME: return "日期时间";
+        case TOML_ARRAY:    return "数组";
+        case TOML_TABLE:    return "表";
     }
-    
-    if(add_precompile_headers) fprintf(src_file, "#include \"pch.h\"\n");
-    fprintf(src_file, "#include \"%s.h\"\n\n", project_name);
-    fprintf(src_file, "int %s_function() {\n", project_name);
-    fprintf(src_file, "    return 0;\n");
-    fprintf(src_file, "}\n");
-    fclose(src_file);
-    
-    // 创建头文件
-    char header_filename[MAX_PATH_LEN];
-    snprintf(header_filename, MAX_PATH_LEN, "include/%s.h", project_name);
-    FILE* header_file = fopen(header_filename, "w");
-    if (!header_file) {
-        perror("创建头文件失败");
-        return 0;
+    return "未知类型";
+}
+
+// 检查值的类型,不符合时给出带行号的警告
+bool toml_check_type(const struct toml_value* value, enum toml_type type, const char* section, const char* key) {
+    if (value->type == type) return true;
+    printf("警告: CMake.toml第%d行: [%s] %s 应为%s,实际为%s,已忽略\n",
+           value->line, section, key, toml_type_name(type), toml_type_name(value->type));
+    return false;
+}
+
+// 构建目录布局
+#define LAYOUT_SINGLE       "single"        // 所有构建类型共用一个构建目录
+#define LAYOUT_PER_TYPE     "per-type"      // 每种构建类型一个子目录: build/Debug, build/Release ...
+#define LAYOUT_MULTI_CONFIG "multi-config"  // Ninja Multi-Config, 一个构建目录包含所有构建类型
+
+// CMake.toml中的一个[[target]]
+struct project_target {
+    const char* name;
+    const char* type;                 // executable | static | shared
+    struct string_list sources;       // 源文件或glob模式(**匹配任意层子目录), 相对于项目根目录
+    struct string_list include_dirs;  // 库目标的公开包含目录, 默认include
+    struct string_list deps;          // 链接的其他目标或[dependencies]中的依赖项
+    struct string_list files;         // sources展开后的源文件
+    int line;
+};
+
+struct target_list {
+    struct project_target* items;
+    size_t count;
+    size_t capacity;
+    struct arena arena;               // 目标名和类型
+};
+
+// CMake.toml中的构建选项: [build]区块以及[project]区块中影响CMakeLists生成的选项
+struct build_options {
+    // [build]
+    char layout[16];
+    char generator[64];   // 为空时自动检测
+    char cache[16];       // 编译器缓存: none | ccache | sccache | auto
+    char lto[8];          // 链接时优化: off | thin | full
+    char linker[8];       // 链接器: default | mold | lld | gold | auto
+    bool split_dwarf;
+    int max_jobs;         // 并行任务上限, 0 表示不限制
+    int mem_per_job;      // 每个编译任务预估占用的内存(MB)
+    // [project]
+    bool unity_build;
+    int unity_batch_size; // -1 表示使用CMake默认值
+    struct string_list unity_exclude;
+    struct string_list pch_reuse;            // 复用项目预编译头的目标
+    struct string_list sources;              // 项目目标的源文件模式, 为空时使用src/main.cpp或src/<name>.cpp
+    struct string_list source_files;         // sources展开后的源文件
+    struct target_list targets;              // [[target]], 为空时只有一个与项目同名的目标
+    // 命令行
+    struct string_list cmake_args;           // 透传给CMake的额外参数
+    // [pgo]
+    char pgo_profile_dir[MAX_PATH_LEN];      // 相对于项目根目录
+    char pgo_train[MAX_PATH_LEN];            // 训练命令,在项目根目录执行
+    // [watch]
+    char watch_run[MAX_PATH_LEN];            // 每次构建成功后运行的命令, 为空时只构建
+    int watch_debounce_ms;                   // 最后一次修改之后等待的时间
+};
+
+void init_build_options(struct build_options* opts) {
+    memset(opts, 0, sizeof(*opts));
+    strcpy(opts->layout, LAYOUT_SINGLE);
+    strcpy(opts->cache, "none");
+    strcpy(opts->lto, "off");
+    strcpy(opts->linker, "default");
+    opts->mem_per_job = 1024;
+    opts->unity_batch_size = -1;
+    strcpy(opts->pgo_profile_dir, "pgo-data");
+    opts->watch_debounce_ms = 200;
+}
+
+void free_build_options(struct build_options* opts) {
+    string_list_free(&opts->unity_exclude);
+    string_list_free(&opts->pch_reuse);
+    string_list_free(&opts->cmake_args);
+    string_list_free(&opts->sources);
+    string_list_free(&opts->source_files);
+    for (size_t i = 0; i < opts->targets.count; i++) {
+        string_list_free(&opts->targets.items[i].sources);
+        string_list_free(&opts->targets.items[i].files);
+        string_list_free(&opts->targets.items[i].include_dirs);
+        string_list_free(&opts->targets.items[i].deps);
     }
-    
-    // 防止头文件重复包含的保护宏
-    char guard[MAX_PATH_LEN];
-    snprintf(guard, MAX_PATH_LEN, "%s_H", project_name);
-    for (char *p = guard; *p; p++) {
-        if (*p >= 'a' && *p <= 'z') *p -= 'a' - 'A';
-        else if (*p == '-' || *p == '.') *p = '_';
+    free(opts->targets.items);
+    arena_free(&opts->targets.arena);
+    memset(&opts->targets, 0, sizeof(opts->targets));
+}
+
+// 读取TOML字符串数组,追加到items中
+void toml_string_array(const struct toml_value* value, const char* section, const char* key, struct string_list* items) {
+    if (!toml_check_type(value, TOML_ARRAY, section, key)) return;
+    for (size_t i = 0; i < value->as.array.count; i++) {
+        const struct toml_value* item = value->as.array.items[i];
+        if (toml_check_type(item, TOML_STRING, section, key)) {
+            string_list_push(items, item->as.string);
+        }
     }
-    
-    fprintf(header_file, "#ifndef %s\n", guard);
-    fprintf(header_file, "#define %s\n\n", guard);
-    fprintf(header_file, "int %s_function();\n\n", project_name);
-    fprintf(header_file, "#endif // %s\n", guard);
-    
-    fclose(header_file);
-    return 1;
 }
 
+// 解析[pgo]区块中的一个键值对
+void parse_pgo_option(struct build_options* opts, const char* key, const struct toml_value* value) {
+    if (!strcmp(key, "profile_dir")) {
+        if (toml_check_type(value, TOML_STRING, "pgo", key)) {
+            snprintf(opts->pgo_profile_dir, sizeof(opts->pgo_profile_dir), "%s", value->as.string);
+        }
+    }
+    else if (!strcmp(key, "train")) {
+        if (toml_check_type(value, TOML_STRING, "pgo", key)) {
+            snprintf(opts->pgo_train, sizeof(opts->pgo_train), "%s", value->as.string);
+        }
+    }
+}
 
-uint8_t create_new_project(int argc,char*argv[]){
-    char project_name[MAX_PATH_LEN] = "my_project";
-    char project_type[15] = "executable";
-    char deps_from_cli[MAX_DEPS][MAX_PATH_LEN];
-    int num_deps_cli = 0;
-    uint8_t project_name_set = 0;
-    uint8_t create_project = 0;
-    bool add_precompile_headers = false;
+// 解析[watch]区块中的一个键值对
+void parse_watch_option(struct build_options* opts, const char* key, const struct toml_value* value) {
+    if (!strcmp(key, "run")) {
+        if (toml_check_type(value, TOML_STRING, "watch", key)) {
+            snprintf(opts->watch_run, sizeof(opts->watch_run), "%s", value->as.string);
+        }
+    }
+    else if (!strcmp(key, "debounce_ms")) {
+        if (toml_check_type(value, TOML_INTEGER, "watch", key) && value->as.integer >= 0) {
+            opts->watch_debounce_ms = (int)value->as.integer;
+        }
+    }
+}
 
-    if(2==argc){
-        create_project++;
+// 解析[project]区块中影响生成的选项,返回是否识别了该键
+bool parse_project_option(struct build_options* opts, const char* key, const struct toml_value* value) {
+    if (!strcmp(key, "unity_build")) {
+        if (toml_check_type(value, TOML_BOOLEAN, "project", key)) opts->unity_build = value->as.boolean;
     }
-    if(2<argc && argv[2][0]!='-'){
-        create_project++;
-        project_name_set = 1;
-        strcpy(project_name,argv[2]);
+    else if (!strcmp(key, "unity_batch_size")) {
+        if (toml_check_type(value, TOML_INTEGER, "project", key)) opts->unity_batch_size = (int)value->as.integer;
     }
-    else{
-        create_project++;
+    else if (!strcmp(key, "unity_exclude")) {
+        toml_string_array(value, "project", key, &opts->unity_exclude);
     }
-    
-    // 解析命令行参数
-    for(size_t i = 2; i < argc; i++){
-        if(!strcmp(argv[i], "-e") || !strcmp(argv[i], "--executable")) {
-            strcpy(project_type, "executable");
+    else if (!strcmp(key, "pch_reuse")) {
+        toml_string_array(value, "project", key, &opts->pch_reuse);
+    }
+    else if (!strcmp(key, "sources")) {
+        toml_string_array(value, "project", key, &opts->sources);
+    }
+    else {
+        return false;
+    }
+    return true;
+}
+
+bool is_valid_build_type(const char* type) {
+    return !strcmp(type, "Debug") || !strcmp(type, "Release") || !strcmp(type, "RelWithDebInfo") || !strcmp(type, "MinSizeRel");
+}
+
+bool is_valid_layout(const char* layout) {
+    return !strcmp(layout, LAYOUT_SINGLE) || !strcmp(layout, LAYOUT_PER_TYPE) || !strcmp(layout, LAYOUT_MULTI_CONFIG);
+}
+
+// 解析内存大小,支持 "2G"、"512M" 和纯数字(MB),返回MB
+int parse_memory_size(const char* value) {
+    char* end = NULL;
+    double size = strtod(value, &end);
+    if (end == value || size <= 0) return 0;
+    while (isspace((unsigned char)*end)) end++;
+    switch (toupper((unsigned char)*end)) {
+        case 'G': size *= 1024; break;
+        case 'K': size /= 1024; break;
+        case 'M': case '\0': break;
+        default: return 0;
+    }
+    return (int)size;
+}
+
+// 解析[build]区块中的一个键值对
+void parse_build_option(struct build_options* opts, const char* key, const struct toml_value* value) {
+    if (!strcmp(key, "split_dwarf")) {
+        if (toml_check_type(value, TOML_BOOLEAN, "build", key)) opts->split_dwarf = value->as.boolean;
+        return;
+    }
+    if (!strcmp(key, "max_jobs")) {
+        if (toml_check_type(value, TOML_INTEGER, "build", key)) opts->max_jobs = (int)value->as.integer;
+        return;
+    }
+    if (!strcmp(key, "mem_per_job")) {
+        // 整数表示MB, 字符串支持 "2G"、"512M"
+        int mb = 0;
+        if (value->type == TOML_INTEGER) {
+            mb = value->as.integer > 0 && value->as.integer <= INT32_MAX ? (int)value->as.integer : 0;
         }
-        else if(!strcmp(argv[i], "-s") || !strcmp(argv[i], "--static")) {
-            strcpy(project_type, "static");
+        else if (toml_check_type(value, TOML_STRING, "build", key)) {
+            mb = parse_memory_size(value->as.string);
         }
-        else if(!strcmp(argv[i], "-d") || !strcmp(argv[i], "--shared")) {
-            strcpy(project_type, "shared");
+        else {
+            return;
         }
-        else if(!strcmp(argv[i], "-p") || !strcmp(argv[i], "--precompile-headers")) {
-            add_precompile_headers = true;
+        if (mb > 0) {
+            opts->mem_per_job = mb;
+        } 
+        else {
+            printf("警告: 无效的mem_per_job,示例: \"2G\"、\"512M\" 或 1024\n");
         }
-        else if(!strcmp(argv[i], "-h") || !strcmp(argv[i], "--help")) {
-            print_usage(argv[0]);
-            return EXIT_SUCCESS;
+        return;
+    }
+
+    // 其余选项都是字符串
+    if (strcmp(key, "layout") && strcmp(key, "generator") && strcmp(key, "cache") && strcmp(key, "lto") && strcmp(key, "linker")) {
+        return;
+    }
+    if (!toml_check_type(value, TOML_STRING, "build", key)) return;
+    const char* text = value->as.string;
+
+    if (!strcmp(key, "layout")) {
+        if (is_valid_layout(text)) {
+            strcpy(opts->layout, text);
+        } 
+        else {
+            printf("警告: 未知的构建目录布局 %s,使用 %s\n", text, opts->layout);
         }
-        else if((!strcmp(argv[i], "-D") || !strcmp(argv[i], "--dep")) && i+1 < argc) {
-            // 获取依赖项名称
-            i++;
-            if(num_deps_cli < MAX_DEPS) {
-                strncpy(deps_from_cli[num_deps_cli], argv[i], MAX_PATH_LEN);
-                num_deps_cli++;
-            } else {
-                printf("警告: 已达到最大依赖项数量(%d)，忽略依赖项: %s\n", MAX_DEPS, argv[i]);
+    }
+    else if (!strcmp(key, "generator")) {
+        strncpy(opts->generator, text, sizeof(opts->generator) - 1);
+    }
+    else if (!strcmp(key, "cache")) {
+        if (!strcmp(text, "none") || !strcmp(text, "ccache") || !strcmp(text, "sccache") || !strcmp(text, "auto")) {
+            strcpy(opts->cache, text);
+        } 
+        else {
+            printf("警告: 未知的编译器缓存 %s,可选值为 none/ccache/sccache/auto\n", text);
+        }
+    }
+    else if (!strcmp(key, "lto")) {
+        if (!strcmp(text, "off") || !strcmp(text, "thin") || !strcmp(text, "full")) {
+            strcpy(opts->lto, text);
+        } 
+        else {
+            printf("警告: 未知的LTO模式 %s,可选值为 off/thin/full\n", text);
+        }
+    }
+    else if (!strcmp(key, "linker")) {
+        if (!strcmp(text, "default") || !strcmp(text, "mold") || !strcmp(text, "lld") || 
+            !strcmp(text, "gold") || !strcmp(text, "auto")) {
+            strcpy(opts->linker, text);
+        } 
+        else {
+            printf("警告: 未知的链接器 %s,可选值为 default/mold/lld/gold/auto\n", text);
+        }
+    }
+}
+
+bool is_valid_target_type(const char* type) {
+    return !strcmp(type, "executable") || !strcmp(type, "static") || !strcmp(type, "shared");
+}
+
+const struct project_target* find_project_target(const struct target_list* targets, const char* name) {
+    for (size_t i = 0; i < targets->count; i++) {
+        if (!strcmp(targets->items[i].name, name)) return &targets->items[i];
+    }
+    return NULL;
+}
+
+// 读取一个[[target]]: name(必需)、type、sources、include、deps
+void parse_target(struct target_list* targets, const struct toml_value* value) {
+    const struct toml_table* table = value->as.table;
+    const struct toml_value* name = toml_table_get(table, "name");
+    if (!name || name->type != TOML_STRING || name->as.string[0] == '\0') {
+        printf("警告: CMake.toml第%d行: [[target]]缺少name,已忽略\n", value->line);
+        return;
+    }
+    if (find_project_target(targets, name->as.string)) {
+        printf("警告: CMake.toml第%d行: 目标 %s 重复定义,已忽略\n", value->line, name->as.string);
+        return;
+    }
+    if (targets->count == targets->capacity) {
+        size_t capacity = targets->capacity ? targets->capacity * 2 : 8;
+        struct project_target* items = realloc(targets->items, capacity * sizeof(*items));
+        if (!items) return;
+        targets->items = items;
+        targets->capacity = capacity;
+    }
+    struct project_target* target = &targets->items[targets->count++];
+    memset(target, 0, sizeof(*target));
+    target->name = arena_strdup(&targets->arena, name->as.string);
+    target->type = "executable";
+    target->line = value->line;
+
+    for (size_t i = 0; i < table->count; i++) {
+        const char* key = table->keys[i];
+        const struct toml_value* item = table->values[i];
+        if (!strcmp(key, "name")) continue;
+        if (!strcmp(key, "type")) {
+            if (!toml_check_type(item, TOML_STRING, "target", key)) continue;
+            if (is_valid_target_type(item->as.string)) {
+                target->type = arena_strdup(&targets->arena, item->as.string);
+            } 
+            else {
+                printf("警告: CMake.toml第%d行: 目标类型必须是 executable、static 或 shared\n", item->line);
             }
         }
+        else if (!strcmp(key, "sources")) {
+            toml_string_array(item, "target", key, &target->sources);
+        }
+        else if (!strcmp(key, "include")) {
+            toml_string_array(item, "target", key, &target->include_dirs);
+        }
+        else if (!strcmp(key, "deps")) {
+            toml_string_array(item, "target", key, &target->deps);
+        }
+        else {
+            printf("警告: CMake.toml第%d行: 未知的[[target]]选项 %s\n", item->line, key);
+        }
+    }
+    // 默认约定: src/<name>/下的全部源文件, 公开头文件在include/
+    if (target->sources.count == 0) {
+        string_list_pushf(&target->sources, "src/%s/**/*.cpp", target->name);
+    }
+    if (target->include_dirs.count == 0) {
+        string_list_push(&target->include_dirs, "include");
+    }
+}
+
+// CMake.toml [dependencies]中的一个依赖项
+struct dependency {
+    const char* name;              // 键名, 也是生成的CMake变量前缀
+    const char* package;           // pkg-config模块名(Windows下为find_package包名), 默认与name相同
+    const char* op;                // 版本约束运算符: >= = <= > <, 不限制版本时为NULL
+    const char* version;           // 版本约束中的版本号
+    const char* mode;              // 查找方式: auto(有CMake配置包时使用find_package)、cmake、pkg-config、path
+    const char* cmake_package;     // find_package的CONFIG模式使用的包名, 使用pkg-config时为NULL
+    const char* cmake_config;      // 找到的<包名>Config.cmake, 未找到时为NULL
+    const char* path;              // 工作区成员的目录(路径依赖), 相对于项目根目录
+    const char** targets;          // 链接的目标: CONFIG模式的IMPORTED目标或工作区成员的库
+    const char** target_types;     // 路径依赖: 每个库的类型(static/shared)
+    const char** target_includes;  // 路径依赖: 每个库的包含目录, 以;分隔
+    const char** target_links;     // 路径依赖: 每个库链接的同一成员中的库和成员的依赖项, 以;分隔
+    size_t target_count;
+    // pkg-config解析结果, 版本和参数哈希记录在CMake.lock中
+    bool resolved;
+    bool cached;                   // 结果来自构建目录中的解析缓存
+    const char* resolved_version;
+    const char* cflags;
+    const char* libs;
+    uint64_t cflags_hash;
+    uint64_t libs_hash;
+};
+
+struct dependency_list {
+    struct dependency* items;
+    size_t count;
+    size_t capacity;
+    struct arena arena;            // 依赖项中的字符串
+};
+
+// 既没有CMake配置包也不是工作区成员的依赖项通过pkg-config解析
+bool uses_pkg_config(const struct dependency* dep) {
+    return !dep->cmake_package && !dep->path;
+}
+
+struct dependency* dependency_list_add(struct dependency_list* list, const char* name) {
+    if (list->count == list->capacity) {
+        size_t capacity = list->capacity ? list->capacity * 2 : 16;
+        struct dependency* items = realloc(list->items, capacity * sizeof(*items));
+        if (!items) return NULL;
+        list->items = items;
+        list->capacity = capacity;
+    }
+    struct dependency* dep = &list->items[list->count];
+    memset(dep, 0, sizeof(*dep));
+    dep->name = arena_strdup(&list->arena, name);
+    if (!dep->name) return NULL;
+    dep->package = dep->name;
+    dep->mode = "auto";
+    list->count++;
+    return dep;
+}
+
+void dependency_list_free(struct dependency_list* list) {
+    free(list->items);
+    arena_free(&list->arena);
+    memset(list, 0, sizeof(*list));
+}
+
+// 解析版本约束: "1.2" 等价于 ">=1.2", 支持 >= = == <= > <, "latest"、"*" 和空字符串表示不限制版本
+int parse_version_constraint(struct dependency* dep, const char* spec, struct arena* arena) {
+    static const char* ops[] = { ">=", "<=", "==", "=", ">", "<" };
+    dep->op = NULL;
+    dep->version = NULL;
+    while (isspace((unsigned char)*spec)) spec++;
+    if (*spec == '\0' || !strcmp(spec, "*") || !strcmp(spec, "latest")) return 1;
+
+    const char* op = ">=";
+    for (size_t i = 0; i < sizeof(ops) / sizeof(ops[0]); i++) {
+        if (!strncmp(spec, ops[i], strlen(ops[i]))) {
+            op = !strcmp(ops[i], "==") ? "=" : ops[i];
+            spec += strlen(ops[i]);
+            break;
+        }
+    }
+    while (isspace((unsigned char)*spec)) spec++;
+    size_t length = strlen(spec);
+    while (length > 0 && isspace((unsigned char)spec[length - 1])) length--;
+    if (length == 0 || !isdigit((unsigned char)spec[0])) return 0;
+    for (size_t i = 0; i < length; i++) {
+        if (!isalnum((unsigned char)spec[i]) && !strchr("._+-~", spec[i])) return 0;
+    }
+    dep->op = op;
+    dep->version = arena_strndup(arena, spec, length);
+    return dep->version != NULL;
+}
+
+// 读取一个依赖项: name = "约束" 或
+// name = { name = "模块名", version = "约束", mode = "auto|cmake|pkg-config", cmake = "包名", targets = ["ns::target"] }
+// 或工作区成员 name = { path = "../core", targets = ["core"] }
+void parse_dependency(struct dependency_list* deps, const char* key, const struct toml_value* value) {
+    struct dependency* dep = dependency_list_add(deps, key);
+    if (!dep) return;
+    const char* spec = NULL;
+    if (value->type == TOML_STRING) {
+        spec = value->as.string;
+    } 
+    else if (value->type == TOML_TABLE) {
+        const struct toml_value* package = toml_table_get(value->as.table, "name");
+        const struct toml_value* version = toml_table_get(value->as.table, "version");
+        const struct toml_value* mode = toml_table_get(value->as.table, "mode");
+        const struct toml_value* cmake = toml_table_get(value->as.table, "cmake");
+        const struct toml_value* targets = toml_table_get(value->as.table, "targets");
+        const struct toml_value* path = toml_table_get(value->as.table, "path");
+        if (package && toml_check_type(package, TOML_STRING, "dependencies", key)) {
+            dep->package = arena_strdup(&deps->arena, package->as.string);
+        }
+        if (version && toml_check_type(version, TOML_STRING, "dependencies", key)) {
+            spec = version->as.string;
+        }
+        if (mode && toml_check_type(mode, TOML_STRING, "dependencies", key)) {
+            if (!strcmp(mode->as.string, "auto") || !strcmp(mode->as.string, "cmake") || !strcmp(mode->as.string, "pkg-config")) {
+                dep->mode = arena_strdup(&deps->arena, mode->as.string);
+            } 
+            else {
+                printf("警告: CMake.toml第%d行: 依赖项 %s 的查找方式必须是 auto、cmake 或 pkg-config\n", mode->line, key);
+            }
+        }
+        // 指定了CMake包名或目标时使用CONFIG模式
+        if (cmake && toml_check_type(cmake, TOML_STRING, "dependencies", key)) {
+            dep->cmake_package = arena_strdup(&deps->arena, cmake->as.string);
+            dep->mode = "cmake";
+        }
+        if (targets) {
+            struct string_list names = {0};
+            toml_string_array(targets, "dependencies", key, &names);
+            dep->targets = arena_alloc(&deps->arena, (names.count + 1) * sizeof(*dep->targets));
+            for (size_t i = 0; dep->targets && i < names.count; i++) {
+                dep->targets[dep->target_count++] = arena_strdup(&deps->arena, names.items[i]);
+            }
+            if (dep->target_count > 0) dep->mode = "cmake";
+            string_list_free(&names);
+        }
+        // 工作区中的其他成员: targets为成员中要链接的库, 默认是与成员项目同名的库
+        if (path && toml_check_type(path, TOML_STRING, "dependencies", key)) {
+            dep->path = arena_strdup(&deps->arena, path->as.string);
+            dep->mode = "path";
+            dep->cmake_package = NULL;
+        }
+    } 
+    else {
+        toml_check_type(value, TOML_STRING, "dependencies", key);
+    }
+    if (spec && !parse_version_constraint(dep, spec, &deps->arena)) {
+        printf("警告: CMake.toml第%d行: 依赖项 %s 的版本约束 \"%s\" 无效,不限制版本\n", value->line, key, spec);
+    }
+}
+
+// 比较前length个字符, 不区分大小写
+bool equals_ignore_case(const char* a, const char* b, size_t length) {
+    for (size_t i = 0; i < length; i++) {
+        if (tolower((unsigned char)a[i]) != tolower((unsigned char)b[i])) return false;
+        if (a[i] == '\0') return true;
+    }
+    return true;
+}
+
+// CMake配置包的搜索目录: CMAKE_PREFIX_PATH和系统前缀下的 lib/cmake、lib64/cmake、lib/<多架构>/cmake、share/cmake
+void cmake_package_roots(struct string_list* roots) {
+    struct string_list prefixes = {0};
+    split_path_list(getenv("CMAKE_PREFIX_PATH"), &prefixes);
+#if !defined(PLATFORM_WINDOWS)
+    string_list_push(&prefixes, "/usr/local");
+    string_list_push(&prefixes, "/usr");
+#endif
+#if defined(PLATFORM_MACOS)
+    string_list_push(&prefixes, "/opt/homebrew");
+#endif
+    for (size_t i = 0; i < prefixes.count; i++) {
+        const char* prefix = prefixes.items[i];
+        string_list_pushf(roots, "%s%clib%ccmake", prefix, PATH_SEP, PATH_SEP);
+        string_list_pushf(roots, "%s%clib64%ccmake", prefix, PATH_SEP, PATH_SEP);
+        // Debian/Ubuntu的多架构目录, 例如 lib/x86_64-linux-gnu/cmake
+        char lib_dir[MAX_PATH_LEN];
+        snprintf(lib_dir, sizeof(lib_dir), "%s%clib", prefix, PATH_SEP);
+        DIR* dir = opendir(lib_dir);
+        struct dirent* entry;
+        while (dir && (entry = readdir(dir)) != NULL) {
+            if (strstr(entry->d_name, "-linux-")) {
+                string_list_pushf(roots, "%s%c%s%ccmake", lib_dir, PATH_SEP, entry->d_name, PATH_SEP);
+            }
+        }
+        if (dir) closedir(dir);
+        string_list_pushf(roots, "%s%cshare%ccmake", prefix, PATH_SEP, PATH_SEP);
+    }
+    string_list_free(&prefixes);
+}
+
+// 与find_package相同, 在<root>/<包名>*/中查找<包名>Config.cmake或<小写包名>-config.cmake, 包名不区分大小写;
+// 找到时package_name为配置文件名中的包名, find_package需要使用这个大小写
+int find_cmake_config(const char* root, const char* package, char* config_path, size_t path_size, char* package_name, size_t name_size) {
+    DIR* dir = opendir(root);
+    if (!dir) return 0;
+    size_t length = strlen(package);
+    struct dirent* entry;
+    int found = 0;
+    while (!found && (entry = readdir(dir)) != NULL) {
+        if (!equals_ignore_case(entry->d_name, package, length)) continue;
+        if (entry->d_name[length] != '\0' && entry->d_name[length] != '-') continue;
+        char package_dir[MAX_PATH_LEN];
+        snprintf(package_dir, sizeof(package_dir), "%s%c%s", root, PATH_SEP, entry->d_name);
+        DIR* sub = opendir(package_dir);
+        struct dirent* file;
+        while (sub && !found && (file = readdir(sub)) != NULL) {
+            size_t name_length = strlen(file->d_name);
+            bool config = name_length == length + strlen("Config.cmake") && !strcmp(file->d_name + length, "Config.cmake");
+            bool lower_config = name_length == length + strlen("-config.cmake") && !strcmp(file->d_name + length, "-config.cmake");
+            if ((config || lower_config) && equals_ignore_case(file->d_name, package, length)) {
+                snprintf(config_path, path_size, "%s%c%s", package_dir, PATH_SEP, file->d_name);
+                snprintf(package_name, name_size, "%.*s", (int)length, file->d_name);
+                found = 1;
+            }
+        }
+        if (sub) closedir(sub);
+    }
+    closedir(dir);
+    return found;
+}
+
+// 收集配置包目录中定义的带命名空间的IMPORTED目标: add_library(GTest::gtest SHARED IMPORTED)
+void scan_imported_targets(const char* package_dir, struct string_list* targets) {
+    DIR* dir = opendir(package_dir);
+    if (!dir) return;
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL) {
+        size_t name_length = strlen(entry->d_name);
+        if (name_length < 6 || strcmp(entry->d_name + name_length - 6, ".cmake") != 0) continue;
+        char path[MAX_PATH_LEN];
+        snprintf(path, sizeof(path), "%s%c%s", package_dir, PATH_SEP, entry->d_name);
+        char* data = read_file_contents(path, NULL);
+        for (const char* p = data ? strstr(data, "add_library(") : NULL; p; p = strstr(p + 1, "add_library(")) {
+            const char* name = p + strlen("add_library(");
+            while (*name == ' ' || *name == '\t') name++;
+            size_t length = strcspn(name, " \t\r\n)");
+            size_t line_length = strcspn(name, "\r\n");
+            char* target = arena_strndup(&targets->arena, name, length);
+            char* line = arena_strndup(&targets->arena, name, line_length);
+            // 由变量拼出的目标名(Boost::${comp})无法确定, 忽略
+            if (target && line && strstr(target, "::") && !strchr(target, '$') && strstr(line, "IMPORTED") &&
+                !string_list_contains(targets, target)) {
+                string_list_append(targets, target);
+            }
+        }
+        free(data);
+    }
+    closedir(dir);
+}
+
+// 选择要链接的目标: 优先选择 命名空间::依赖项名(不区分大小写), 否则只在包中只有一个目标时使用它
+const char* pick_imported_target(const struct string_list* targets, const char* name) {
+    for (size_t i = 0; i < targets->count; i++) {
+        const char* local = strstr(targets->items[i], "::") + 2;
+        if (strlen(local) == strlen(name) && equals_ignore_case(local, name, strlen(name))) return targets->items[i];
+    }
+    return targets->count == 1 ? targets->items[0] : NULL;
+}
+
+// 为依赖项选择查找方式: mode为auto时, 找到CMake配置包并能确定要链接的目标则使用find_package的CONFIG模式,
+// 否则使用pkg-config; mode为cmake时总是使用CONFIG模式, 未指定目标时链接<包名>::<包名>
+void detect_cmake_packages(struct dependency_list* deps) {
+    struct string_list roots = {0};
+    cmake_package_roots(&roots);
+    for (size_t i = 0; i < deps->count; i++) {
+        struct dependency* dep = &deps->items[i];
+        if (!strcmp(dep->mode, "pkg-config") || dep->path) continue;
+        bool automatic = !strcmp(dep->mode, "auto");
+        const char* wanted = dep->cmake_package ? dep->cmake_package : dep->package;
+        char config_path[MAX_PATH_LEN];
+        char package_name[MAX_PATH_LEN];
+        bool found = false;
+        for (size_t r = 0; r < roots.count && !found; r++) {
+            found = find_cmake_config(roots.items[r], wanted, config_path, sizeof(config_path), package_name, sizeof(package_name));
+        }
+        if (!found && automatic) continue;
+
+        const char* target = NULL;
+        struct string_list targets = {0};
+        if (found && dep->target_count == 0) {
+            char package_dir[MAX_PATH_LEN];
+            snprintf(package_dir, sizeof(package_dir), "%s", config_path);
+            *strrchr(package_dir, PATH_SEP) = '\0';
+            scan_imported_targets(package_dir, &targets);
+            target = pick_imported_target(&targets, dep->name);
+            if (!target && automatic) {
+                string_list_free(&targets);
+                continue;
+            }
+        }
+        dep->cmake_package = arena_strdup(&deps->arena, found ? package_name : wanted);
+        dep->cmake_config = found ? arena_strdup(&deps->arena, config_path) : NULL;
+        if (dep->target_count == 0) {
+            char* name = target ? arena_strdup(&deps->arena, target) : NULL;
+            if (!target) {
+                size_t size = strlen(dep->cmake_package) * 2 + 3;
+                name = arena_alloc(&deps->arena, size);
+                if (name) snprintf(name, size, "%s::%s", dep->cmake_package, dep->cmake_package);
+            }
+            dep->targets = arena_alloc(&deps->arena, 2 * sizeof(*dep->targets));
+            if (dep->targets && name) dep->targets[dep->target_count++] = name;
+        }
+        string_list_free(&targets);
+    }
+    string_list_free(&roots);
+}
+
+// 是否为绝对路径(包括Windows的盘符路径)
+bool is_absolute_path(const char* path) {
+    return path[0] == '/' || path[0] == '\\' || (path[0] && path[1] == ':');
+}
+
+// 两个路径是否指向同一个目录
+bool same_directory(const char* a, const char* b) {
+#if defined(PLATFORM_WINDOWS)
+    char full_a[MAX_PATH_LEN], full_b[MAX_PATH_LEN];
+    return _fullpath(full_a, a, sizeof(full_a)) && _fullpath(full_b, b, sizeof(full_b)) && !_stricmp(full_a, full_b);
+#else
+    struct stat st_a, st_b;
+    return stat(a, &st_a) == 0 && stat(b, &st_b) == 0 && st_a.st_dev == st_b.st_dev && st_a.st_ino == st_b.st_ino;
+#endif
+}
+
+// 把TOML字符串数组以;分隔追加到out
+void append_toml_strings(const struct toml_value* array, struct string_buffer* out) {
+    for (size_t i = 0; array && array->type == TOML_ARRAY && i < array->as.array.count; i++) {
+        const struct toml_value* item = array->as.array.items[i];
+        if (item->type != TOML_STRING) continue;
+        if (out->length > 0) string_buffer_append(out, ";", 1);
+        string_buffer_append(out, item->as.string, strlen(item->as.string));
+    }
+}
+
+const struct toml_table* find_member_target(const struct toml_document* doc, const char* name) {
+    const struct toml_value* targets = toml_table_get(doc->root, "target");
+    for (size_t i = 0; targets && targets->type == TOML_ARRAY && i < targets->as.array.count; i++) {
+        const struct toml_value* item = targets->as.array.items[i];
+        const struct toml_value* target_name = item->type == TOML_TABLE ? toml_table_get(item->as.table, "name") : NULL;
+        if (target_name && target_name->type == TOML_STRING && !strcmp(target_name->as.string, name)) return item->as.table;
+    }
+    return NULL;
+}
+
+// 在成员的CMake.toml中查找要链接的库: [[target]]中的库或与成员项目同名的库;
+// 返回库类型(不是库时返回NULL), 包含目录和库自身链接的目标、依赖项以;分隔追加到includes和links
+const char* find_member_library(const struct toml_document* doc, const char* name,
+                                struct string_buffer* includes, struct string_buffer* links) {
+    const struct toml_table* target = find_member_target(doc, name);
+    const struct toml_value* type = NULL;
+    if (target) {
+        type = toml_table_get(target, "type");
+        append_toml_strings(toml_table_get(target, "include"), includes);
+        append_toml_strings(toml_table_get(target, "deps"), links);
+    } 
+    else {
+        const struct toml_table* project = toml_get_table(doc->root, "project");
+        const struct toml_value* project_name = project ? toml_table_get(project, "name") : NULL;
+        if (!project_name || project_name->type != TOML_STRING || strcmp(project_name->as.string, name)) return NULL;
+        type = toml_table_get(project, "type");
+        const struct toml_table* member_deps = toml_get_table(doc->root, "dependencies");
+        for (size_t i = 0; member_deps && i < member_deps->count; i++) {
+            if (links->length > 0) string_buffer_append(links, ";", 1);
+            string_buffer_append(links, member_deps->keys[i], strlen(member_deps->keys[i]));
+        }
+    }
+    if (includes->length == 0) string_buffer_append(includes, "include", 7);
+    if (!type || type->type != TOML_STRING) return NULL;
+    return !strcmp(type->as.string, "static") || !strcmp(type->as.string, "shared") ? type->as.string : NULL;
+}
+
+// 工作区成员之间的路径依赖: 从成员的CMake.toml确定要导入的库、库类型、包含目录和库的链接项;
+// 库链接的同一成员中的其他库一并导入, 成员的依赖项(包括更深一层的路径依赖)加入本项目
+void expand_path_dependencies(struct dependency_list* deps) {
+    for (size_t i = 0; i < deps->count; i++) {
+        if (!deps->items[i].path || deps->items[i].target_types) continue;
+        char toml_path[MAX_PATH_LEN];
+        char error[BUFFER_SIZE];
+        snprintf(toml_path, sizeof(toml_path), "%s%cCMake.toml", deps->items[i].path, PATH_SEP);
+        struct toml_document* doc = toml_parse_file(toml_path, error, sizeof(error), NULL);
+        if (!doc) {
+            printf("警告: 依赖项 %s: %s\n", deps->items[i].name, error);
+            continue;
+        }
+        struct dependency* dep = &deps->items[i];
+        const struct toml_table* project = toml_get_table(doc->root, "project");
+        const struct toml_value* project_name = project ? toml_table_get(project, "name") : NULL;
+        const struct toml_value* version = project ? toml_table_get(project, "version") : NULL;
+        dep->resolved_version = arena_strdup(&deps->arena, version && version->type == TOML_STRING ? version->as.string : "0.0.0");
+
+        // 默认导入与成员项目同名的库
+        struct string_list names = {0};
+        for (size_t t = 0; t < dep->target_count; t++) {
+            string_list_push(&names, dep->targets[t]);
+        }
+        if (names.count == 0 && project_name && project_name->type == TOML_STRING) {
+            string_list_push(&names, project_name->as.string);
+        }
+        struct string_list types = {0};
+        struct string_list includes = {0};
+        struct string_list links = {0};
+        for (size_t t = 0; t < names.count; t++) {
+            struct string_buffer include_dirs = {0};
+            struct string_buffer link_items = {0};
+            string_buffer_append(&include_dirs, "", 0);
+            string_buffer_append(&link_items, "", 0);
+            const char* type = find_member_library(doc, names.items[t], &include_dirs, &link_items);
+            if (!type) {
+                printf("警告: 依赖项 %s: %s 中没有名为 %s 的库\n", dep->name, dep->path, names.items[t]);
+            }
+            string_list_push(&types, type ? type : "");
+            string_list_push(&includes, include_dirs.data);
+            string_list_push(&links, link_items.data);
+            struct string_list items = {0};
+            split_list(link_items.data, ';', &items);
+            for (size_t k = 0; k < items.count; k++) {
+                if (find_member_target(doc, items.items[k]) && !string_list_contains(&names, items.items[k])) {
+                    string_list_push(&names, items.items[k]);
+                }
+            }
+            string_list_free(&items);
+            string_buffer_free(&include_dirs);
+            string_buffer_free(&link_items);
+        }
+        dep->target_count = names.count;
+        dep->targets = arena_alloc(&deps->arena, (names.count + 1) * sizeof(*dep->targets));
+        dep->target_types = arena_alloc(&deps->arena, (names.count + 1) * sizeof(*dep->target_types));
+        dep->target_includes = arena_alloc(&deps->arena, (names.count + 1) * sizeof(*dep->target_includes));
+        dep->target_links = arena_alloc(&deps->arena, (names.count + 1) * sizeof(*dep->target_links));
+        if (!dep->targets || !dep->target_types || !dep->target_includes || !dep->target_links) dep->target_count = 0;
+        for (size_t t = 0; t < dep->target_count; t++) {
+            dep->targets[t] = arena_strdup(&deps->arena, names.items[t]);
+            dep->target_types[t] = types.items[t][0] ? arena_strdup(&deps->arena, types.items[t]) : NULL;
+            dep->target_includes[t] = arena_strdup(&deps->arena, includes.items[t]);
+            dep->target_links[t] = arena_strdup(&deps->arena, links.items[t]);
+        }
+        string_list_free(&names);
+        string_list_free(&types);
+        string_list_free(&includes);
+        string_list_free(&links);
+
+        const struct toml_table* member_deps = toml_get_table(doc->root, "dependencies");
+        for (size_t k = 0; member_deps && k < member_deps->count; k++) {
+            bool present = false;
+            for (size_t j = 0; j < deps->count && !present; j++) {
+                present = !strcmp(deps->items[j].name, member_deps->keys[k]);
+            }
+            if (present) continue;
+            size_t index = deps->count;
+            parse_dependency(deps, member_deps->keys[k], member_deps->values[k]);
+            if (deps->count == index || !deps->items[index].path) continue;
+            // 成员中的相对路径相对于成员目录; 指回本项目的依赖(成员之间的循环)忽略
+            if (!is_absolute_path(deps->items[index].path)) {
+                char rebased[MAX_PATH_LEN];
+                snprintf(rebased, sizeof(rebased), "%s%c%s", deps->items[i].path, PATH_SEP, deps->items[index].path);
+                deps->items[index].path = arena_strdup(&deps->arena, rebased);
+            }
+            if (same_directory(deps->items[index].path, ".")) deps->count--;
+        }
+        toml_free(doc);
+    }
+}
+
+// 解析CMake.toml文件, deps和build_opts可以为NULL;
+// 返回1表示解析出了项目名称, 0表示文件不存在或没有项目名称, -1表示文件存在但无法读取或有语法错误
+int parse_cmake_toml(char* project_name, char* project_type, struct dependency_list* deps, bool* add_precompile_headers, struct build_options* build_opts) {
+    // 设置默认值
+    strcpy(project_type, "executable");
+
+    char error[BUFFER_SIZE];
+    bool missing;
+    struct toml_document* doc = toml_parse_file("CMake.toml", error, sizeof(error), &missing);
+    if (!doc) {
+        if (missing) return 0;
+        printf("错误: 解析CMake.toml失败: %s\n", error);
+        return -1;
+    }
+
+    const struct toml_table* project = toml_get_table(doc->root, "project");
+    for (size_t i = 0; project && i < project->count; i++) {
+        const char* key = project->keys[i];
+        const struct toml_value* value = project->values[i];
+        if (build_opts && parse_project_option(build_opts, key, value)) continue;
+
+        if (!strcmp(key, "name")) {
+            if (toml_check_type(value, TOML_STRING, "project", key)) {
+                snprintf(project_name, MAX_PATH_LEN, "%s", value->as.string);
+            }
+        }
+        else if (!strcmp(key, "type")) {
+            if (toml_check_type(value, TOML_STRING, "project", key)) {
+                snprintf(project_type, 15, "%s", value->as.string);
+            }
+        }
+        else if (!strcmp(key, "precompile_headers")) {
+            if (toml_check_type(value, TOML_BOOLEAN, "project", key)) {
+                *add_precompile_headers = value->as.boolean;
+            }
+        }
+    }
+
+    const struct toml_table* build = toml_get_table(doc->root, "build");
+    for (size_t i = 0; build_opts && build && i < build->count; i++) {
+        parse_build_option(build_opts, build->keys[i], build->values[i]);
+    }
+
+    const struct toml_table* pgo = toml_get_table(doc->root, "pgo");
+    for (size_t i = 0; build_opts && pgo && i < pgo->count; i++) {
+        parse_pgo_option(build_opts, pgo->keys[i], pgo->values[i]);
+    }
+
+    const struct toml_table* watch = toml_get_table(doc->root, "watch");
+    for (size_t i = 0; build_opts && watch && i < watch->count; i++) {
+        parse_watch_option(build_opts, watch->keys[i], watch->values[i]);
+    }
+
+    // [[target]]: 表数组, 每个元素是一个目标
+    const struct toml_value* targets = toml_table_get(doc->root, "target");
+    if (build_opts && targets) {
+        if (targets->type != TOML_ARRAY || !targets->as.array.of_tables) {
+            printf("警告: CMake.toml第%d行: 目标需要用[[target]]定义,已忽略\n", targets->line);
+        } 
+        for (size_t i = 0; targets->type == TOML_ARRAY && targets->as.array.of_tables && i < targets->as.array.count; i++) {
+            parse_target(&build_opts->targets, targets->as.array.items[i]);
+        }
+    }
+
+    // 依赖项按定义顺序
+    const struct toml_table* dependencies = toml_get_table(doc->root, "dependencies");
+    for (size_t i = 0; deps && dependencies && i < dependencies->count; i++) {
+        parse_dependency(deps, dependencies->keys[i], dependencies->values[i]);
+    }
+    if (deps) {
+        expand_path_dependencies(deps);
+        detect_cmake_packages(deps);
+    }
+
+    toml_free(doc);
+    return strlen(project_name) > 0; // 返回是否成功解析了项目名称
+}
+
+// 只读取CMake.toml中的[build]区块,CMake.toml不存在时保持默认值;
+// CMake.toml存在但无法解析时返回0, 不能带着默认选项继续(会忽略布局、缓存和PGO等设置)
+int load_build_options(struct build_options* opts, struct dependency_list* deps) {
+    char project_name[MAX_PATH_LEN] = "";
+    char project_type[15] = "executable";
+    bool add_precompile_headers = false;
+    init_build_options(opts);
+    return parse_cmake_toml(project_name, project_type, deps, &add_precompile_headers, opts) >= 0;
+}
+
+// 写入一个路径参数, 含空格等特殊字符的路径加引号
+void emit_cmake_path(FILE* cmake_file, const char* path) {
+    if (!strpbrk(path, " \t;()#\"\\$")) {
+        fputs(path, cmake_file);
+        return;
+    }
+    fputc('"', cmake_file);
+    for (const char* c = path; *c; c++) {
+        if (*c == '"' || *c == '\\' || *c == '$') fputc('\\', cmake_file);
+        fputc(*c, cmake_file);
+    }
+    fputc('"', cmake_file);
+}
+
+// 创建CMakeLists.txt文件（带依赖项处理）
+// Unity构建: 按批次合并源文件,减少重复解析相同的头文件
+void emit_unity_build(FILE* cmake_file, const char* target, const struct build_options* opts) {
+    if (!opts->unity_build) return;
+    fprintf(cmake_file, "\n# Unity构建\n");
+    fprintf(cmake_file, "set_target_properties(%s PROPERTIES\n", target);
+    fprintf(cmake_file, "    UNITY_BUILD ON\n");
+    if (opts->unity_batch_size >= 0) {
+        fprintf(cmake_file, "    UNITY_BUILD_BATCH_SIZE %d\n", opts->unity_batch_size);
+    }
+    fprintf(cmake_file, ")\n");
+}
+
+// 与其他源文件冲突(匿名命名空间、宏等)的文件单独编译; 源文件属性作用于整个目录, 多个目标时只写一次
+void emit_unity_exclude(FILE* cmake_file, const struct build_options* opts) {
+    if (!opts->unity_build) return;
+    for (size_t i = 0; i < opts->unity_exclude.count; i++) {
+        fprintf(cmake_file, "set_source_files_properties(");
+        emit_cmake_path(cmake_file, opts->unity_exclude.items[i]);
+        fprintf(cmake_file, " PROPERTIES SKIP_UNITY_BUILD_INCLUSION ON)\n");
+    }
+}
+
+// 检查工具链是否支持LTO、指定的链接器和split DWARF,每个CMakeLists只需检查一次
+void emit_toolchain_checks(FILE* cmake_file, const struct build_options* opts) {
+    bool lto = strcmp(opts->lto, "off") != 0;
+    bool linker = strcmp(opts->linker, "default") != 0;
+    if (!lto && !linker && !opts->split_dwarf) return;
+
+    fprintf(cmake_file, "# 工具链能力检查\n");
+    if (lto) {
+        fprintf(cmake_file, "include(CheckIPOSupported)\n");
+        fprintf(cmake_file, "check_ipo_supported(RESULT CBUILD_IPO_SUPPORTED OUTPUT CBUILD_IPO_ERROR LANGUAGES CXX)\n");
+        fprintf(cmake_file, "if(NOT CBUILD_IPO_SUPPORTED)\n");
+        fprintf(cmake_file, "    message(WARNING \"工具链不支持LTO,已禁用: ${CBUILD_IPO_ERROR}\")\n");
+        fprintf(cmake_file, "endif()\n");
+    }
+    if (linker) {
+        // auto按链接速度依次尝试
+        const char* candidates = !strcmp(opts->linker, "auto") ? "mold lld gold" : opts->linker;
+        fprintf(cmake_file, "include(CheckCXXSourceCompiles)\n");
+        fprintf(cmake_file, "set(CBUILD_LINKER \"\")\n");
+        fprintf(cmake_file, "if(NOT MSVC)\n");
+        fprintf(cmake_file, "    foreach(cbuild_ld %s)\n", candidates);
+        fprintf(cmake_file, "        set(CMAKE_REQUIRED_LINK_OPTIONS \"-fuse-ld=${cbuild_ld}\")\n");
+        fprintf(cmake_file, "        check_cxx_source_compiles(\"int main() { return 0; }\" CBUILD_HAS_LD_${cbuild_ld})\n");
+        fprintf(cmake_file, "        unset(CMAKE_REQUIRED_LINK_OPTIONS)\n");
+        fprintf(cmake_file, "        if(CBUILD_HAS_LD_${cbuild_ld})\n");
+        fprintf(cmake_file, "            set(CBUILD_LINKER ${cbuild_ld})\n");
+        fprintf(cmake_file, "            break()\n");
+        fprintf(cmake_file, "        endif()\n");
+        fprintf(cmake_file, "    endforeach()\n");
+        fprintf(cmake_file, "endif()\n");
+        fprintf(cmake_file, "if(NOT CBUILD_LINKER)\n");
+        fprintf(cmake_file, "    message(WARNING \"未找到可用的链接器(%s),使用默认链接器\")\n", candidates);
+        fprintf(cmake_file, "endif()\n");
+    }
+    if (opts->split_dwarf) {
+        fprintf(cmake_file, "include(CheckCXXCompilerFlag)\n");
+        fprintf(cmake_file, "check_cxx_compiler_flag(-gsplit-dwarf CBUILD_HAS_SPLIT_DWARF)\n");
+    }
+    fprintf(cmake_file, "\n");
+}
+
+// 为目标应用LTO、链接器和split DWARF设置,依赖emit_toolchain_checks的检查结果
+void emit_link_settings(FILE* cmake_file, const char* target, const struct build_options* opts) {
+    bool lto = strcmp(opts->lto, "off") != 0;
+    bool linker = strcmp(opts->linker, "default") != 0;
+    if (!lto && !linker && !opts->split_dwarf) return;
+
+    fprintf(cmake_file, "\n# 链接优化\n");
+    if (lto) {
+        // LTO只用于发布配置,Debug保持快速链接
+        fprintf(cmake_file, "if(CBUILD_IPO_SUPPORTED)\n");
+        if (!strcmp(opts->lto, "full")) {
+            // CMake为Clang生成的是ThinLTO参数,完整LTO需要显式指定
+            fprintf(cmake_file, "    if(CMAKE_CXX_COMPILER_ID MATCHES \"Clang\")\n");
+            fprintf(cmake_file, "        target_compile_options(%s PRIVATE $<$<NOT:$<CONFIG:Debug>>:-flto=full>)\n", target);
+            fprintf(cmake_file, "        target_link_options(%s PRIVATE $<$<NOT:$<CONFIG:Debug>>:-flto=full>)\n", target);
+            fprintf(cmake_file, "    else()\n");
+            fprintf(cmake_file, "        set_target_properties(%s PROPERTIES\n", target);
+            fprintf(cmake_file, "            INTERPROCEDURAL_OPTIMIZATION_RELEASE ON\n");
+            fprintf(cmake_file, "            INTERPROCEDURAL_OPTIMIZATION_RELWITHDEBINFO ON\n");
+            fprintf(cmake_file, "            INTERPROCEDURAL_OPTIMIZATION_MINSIZEREL ON\n");
+            fprintf(cmake_file, "        )\n");
+            fprintf(cmake_file, "    endif()\n");
+        } 
+        else {
+            fprintf(cmake_file, "    set_target_properties(%s PROPERTIES\n", target);
+            fprintf(cmake_file, "        INTERPROCEDURAL_OPTIMIZATION_RELEASE ON\n");
+            fprintf(cmake_file, "        INTERPROCEDURAL_OPTIMIZATION_RELWITHDEBINFO ON\n");
+            fprintf(cmake_file, "        INTERPROCEDURAL_OPTIMIZATION_MINSIZEREL ON\n");
+            fprintf(cmake_file, "    )\n");
+        }
+        fprintf(cmake_file, "endif()\n");
+    }
+    if (linker) {
+        fprintf(cmake_file, "if(CBUILD_LINKER)\n");
+        fprintf(cmake_file, "    target_link_options(%s PRIVATE -fuse-ld=${CBUILD_LINKER})\n", target);
+        fprintf(cmake_file, "endif()\n");
+    }
+    if (opts->split_dwarf) {
+        // 调试信息写入.dwo文件,减少链接器需要处理的数据量
+        fprintf(cmake_file, "if(CBUILD_HAS_SPLIT_DWARF)\n");
+        fprintf(cmake_file, "    target_compile_options(%s PRIVATE $<$<OR:$<CONFIG:Debug>,$<CONFIG:RelWithDebInfo>>:-gsplit-dwarf>)\n", target);
+        fprintf(cmake_file, "endif()\n");
+    }
+}
+
+// 预编译头: 由CMake按每个构建配置的编译参数生成,GCC/Clang/MSVC通用
+void emit_precompile_headers(FILE* cmake_file, const char* target) {
+    fprintf(cmake_file, "\n# 预编译头文件\n");
+    fprintf(cmake_file, "target_precompile_headers(%s PRIVATE ${CMAKE_SOURCE_DIR}/include/pch.h)\n", target);
+}
+
+// 其他目标(测试、基准等)通过REUSE_FROM共享同一份预编译头,需放在所有目标定义之后
+void emit_pch_reuse(FILE* cmake_file, const char* pch_owner, const struct build_options* opts) {
+    if (opts->pch_reuse.count == 0) return;
+    fprintf(cmake_file, "\n# 复用%s的预编译头\n", pch_owner);
+    fprintf(cmake_file, "foreach(pch_target");
+    for (size_t i = 0; i < opts->pch_reuse.count; i++) {
+        fprintf(cmake_file, " %s", opts->pch_reuse.items[i]);
+    }
+    fprintf(cmake_file, ")\n");
+    fprintf(cmake_file, "    if(TARGET ${pch_target})\n");
+    fprintf(cmake_file, "        target_precompile_headers(${pch_target} REUSE_FROM %s)\n", pch_owner);
+    fprintf(cmake_file, "    endif()\n");
+    fprintf(cmake_file, "endforeach()\n");
+}
+
+// 一个依赖项的链接项: CONFIG模式的IMPORTED目标、工作区成员的库或pkg-config的IMPORTED目标
+void dependency_link_items(const struct dependency* dep, struct string_list* out) {
+    if (dep->cmake_package || dep->path) {
+        for (size_t t = 0; t < dep->target_count; t++) {
+            if (!dep->path || dep->target_types[t]) string_list_push(out, dep->targets[t]);
+        }
+        return;
+    }
+#if defined(PLATFORM_WINDOWS)
+    string_list_pushf(out, "${%s_LIBRARIES}", dep->package);
+#else
+    string_list_pushf(out, "PkgConfig::%s", dep->name);
+#endif
+}
+
+// 工作区成员的库: 成员先于本项目构建, 直接导入成员输出目录中的库文件;
+// 库自身链接的库和依赖项作为INTERFACE_LINK_LIBRARIES传递. 只支持单配置生成器的输出布局,
+// Windows的动态库需要导入库, 暂不支持
+void emit_path_dependencies(FILE* cmake_file, const struct dependency_list* deps) {
+    fprintf(cmake_file, "# 依赖项: 工作区成员的库\n");
+    for (size_t i = 0; i < deps->count; i++) {
+        const struct dependency* dep = &deps->items[i];
+        if (!dep->path) continue;
+        const char* base = is_absolute_path(dep->path) ? "" : "${CMAKE_CURRENT_SOURCE_DIR}/";
+        for (size_t t = 0; t < dep->target_count; t++) {
+            if (!dep->target_types[t]) continue;
+            const char* kind = !strcmp(dep->target_types[t], "shared") ? "SHARED" : "STATIC";
+            fprintf(cmake_file, "if(NOT TARGET %s)\n", dep->targets[t]);
+            fprintf(cmake_file, "    add_library(%s %s IMPORTED)\n", dep->targets[t], kind);
+            fprintf(cmake_file, "    set_target_properties(%s PROPERTIES\n", dep->targets[t]);
+            fprintf(cmake_file, "        IMPORTED_LOCATION \"%s%s/lib/%s/${CBUILD_OUTPUT_SUBDIR}/${CMAKE_%s_LIBRARY_PREFIX}%s${CMAKE_%s_LIBRARY_SUFFIX}\"\n",
+                    base, dep->path, dep->target_types[t], kind, dep->targets[t], kind);
+            struct string_list items = {0};
+            split_list(dep->target_includes[t], ';', &items);
+            fprintf(cmake_file, "        INTERFACE_INCLUDE_DIRECTORIES \"");
+            for (size_t k = 0; k < items.count; k++) {
+                bool absolute = is_absolute_path(items.items[k]);
+                fprintf(cmake_file, "%s%s%s%s%s", k > 0 ? ";" : "", absolute ? "" : base, absolute ? "" : dep->path,
+                        absolute ? "" : "/", items.items[k]);
+            }
+            fprintf(cmake_file, "\"\n");
+            string_list_free(&items);
+
+            // 链接项: 同一成员中的库直接使用目标名, 依赖项展开为它的链接项
+            split_list(dep->target_links[t], ';', &items);
+            struct string_list links = {0};
+            for (size_t k = 0; k < items.count; k++) {
+                for (size_t n = 0; n < dep->target_count; n++) {
+                    if (!strcmp(dep->targets[n], items.items[k]) && dep->target_types[n]) string_list_push(&links, items.items[k]);
+                }
+                for (size_t n = 0; n < deps->count; n++) {
+                    if (!strcmp(deps->items[n].name, items.items[k])) dependency_link_items(&deps->items[n], &links);
+                }
+            }
+            if (links.count > 0) {
+                fprintf(cmake_file, "        INTERFACE_LINK_LIBRARIES \"");
+                for (size_t k = 0; k < links.count; k++) {
+                    fprintf(cmake_file, "%s%s", k > 0 ? ";" : "", links.items[k]);
+                }
+                fprintf(cmake_file, "\"\n");
+            }
+            string_list_free(&links);
+            string_list_free(&items);
+            fprintf(cmake_file, "    )\n");
+            fprintf(cmake_file, "endif()\n");
+        }
+    }
+    fprintf(cmake_file, "\n");
+}
+
+// 依赖项的查找: 提供CMake配置包的依赖项使用find_package的CONFIG模式;
+// 其余依赖项在cbuild构建时通过CBUILD_DEPS_FILE直接定义IMPORTED目标, 单独使用CMake时由pkg-config查找,
+// 版本约束交给pkg-config检查: pkg_check_modules(fmt REQUIRED IMPORTED_TARGET fmt>=9.1)
+void emit_dependencies(FILE* cmake_file, const struct dependency_list* deps) {
+    size_t cmake_count = 0;
+    size_t path_count = 0;
+    for (size_t i = 0; i < deps->count; i++) {
+        if (deps->items[i].path) path_count++;
+        else if (deps->items[i].cmake_package) cmake_count++;
+    }
+    if (cmake_count > 0) {
+        fprintf(cmake_file, "# 依赖项: 使用CMake配置包\n");
+        for (size_t i = 0; i < deps->count; i++) {
+            // find_package的版本参数表示最低兼容版本, 其他约束由cbuild解析依赖项时检查
+            const struct dependency* dep = &deps->items[i];
+            if (!dep->cmake_package) continue;
+            bool use_version = dep->op && (!strcmp(dep->op, ">=") || !strcmp(dep->op, "="));
+            fprintf(cmake_file, "find_package(%s%s%s%s CONFIG REQUIRED)\n", dep->cmake_package,
+                    use_version ? " " : "", use_version ? dep->version : "", use_version && !strcmp(dep->op, "=") ? " EXACT" : "");
+        }
+        fprintf(cmake_file, "\n");
+    }
+    if (deps->count > cmake_count + path_count) {
+#if defined(PLATFORM_WINDOWS)
+        fprintf(cmake_file, "# Windows平台依赖设置\n");
+        for (size_t i = 0; i < deps->count; i++) {
+            const struct dependency* dep = &deps->items[i];
+            if (!uses_pkg_config(dep)) continue;
+            bool use_version = dep->op && (!strcmp(dep->op, ">=") || !strcmp(dep->op, "="));
+            fprintf(cmake_file, "find_package(%s%s%s%s REQUIRED)\n", dep->package,
+                    use_version ? " " : "", use_version ? dep->version : "", use_version && !strcmp(dep->op, "=") ? " EXACT" : "");
+        }
+#else
+        fprintf(cmake_file, "# 依赖项: 优先使用cbuild生成的IMPORTED目标,否则通过pkg-config查找\n");
+        fprintf(cmake_file, "if(DEFINED CBUILD_DEPS_FILE AND EXISTS \"${CBUILD_DEPS_FILE}\")\n");
+        fprintf(cmake_file, "    include(\"${CBUILD_DEPS_FILE}\")\n");
+        fprintf(cmake_file, "else()\n");
+        fprintf(cmake_file, "    find_package(PkgConfig REQUIRED)\n");
+        for (size_t i = 0; i < deps->count; i++) {
+            const struct dependency* dep = &deps->items[i];
+            if (!uses_pkg_config(dep)) continue;
+            fprintf(cmake_file, "    pkg_check_modules(%s REQUIRED IMPORTED_TARGET %s%s%s)\n", dep->name, dep->package,
+                    dep->op ? dep->op : "", dep->op ? dep->version : "");
+        }
+        fprintf(cmake_file, "endif()\n");
+#endif
+        fprintf(cmake_file, "\n");
+    }
+    if (path_count > 0) emit_path_dependencies(cmake_file, deps);
+}
+
+#if defined(PLATFORM_WINDOWS)
+// 模块模式的find_package只提供变量
+void emit_dependency_include_dirs(FILE* cmake_file, const char* target, const struct dependency* dep) {
+    if (!uses_pkg_config(dep)) return;
+    fprintf(cmake_file, "target_include_directories(%s PRIVATE ${%s_INCLUDE_DIRS})\n", target, dep->package);
+}
+#endif
+
+// 按目标链接依赖项, 包含目录和编译参数随IMPORTED目标传递, 只作用于链接它们的目标
+void emit_dependency_links(FILE* cmake_file, const char* target, const struct dependency_list* deps) {
+    if (deps->count == 0) return;
+    fprintf(cmake_file, "\n# 链接依赖库\n");
+#if defined(PLATFORM_WINDOWS)
+    for (size_t i = 0; i < deps->count; i++) {
+        emit_dependency_include_dirs(cmake_file, target, &deps->items[i]);
+    }
+#endif
+    struct string_list links = {0};
+    for (size_t i = 0; i < deps->count; i++) {
+        dependency_link_items(&deps->items[i], &links);
+    }
+    fprintf(cmake_file, "target_link_libraries(%s PRIVATE\n", target);
+    for (size_t i = 0; i < links.count; i++) {
+        fprintf(cmake_file, "    %s\n", links.items[i]);
+    }
+    fprintf(cmake_file, ")\n");
+    string_list_free(&links);
+}
+
+// 源文件列表, 每行一个; 含空格等特殊字符的路径加引号
+void emit_source_files(FILE* cmake_file, const struct string_list* files) {
+    for (size_t i = 0; i < files->count; i++) {
+        fprintf(cmake_file, "    ");
+        emit_cmake_path(cmake_file, files->items[i]);
+        fprintf(cmake_file, "\n");
+    }
+}
+
+// [[target]]定义的多个目标: 源文件是cbuild展开sources模式得到的列表,
+// deps中的名称是其他目标或[dependencies]中的依赖项, 库的包含目录和链接项向使用它的目标传递
+void emit_project_targets(FILE* cmake_file, const struct dependency_list* deps, bool add_precompile_headers, const struct build_options* opts) {
+    const struct target_list* targets = &opts->targets;
+    fprintf(cmake_file, "set(CMAKE_RUNTIME_OUTPUT_DIRECTORY ${CMAKE_SOURCE_DIR}/bin/${CBUILD_OUTPUT_SUBDIR})\n");
+    fprintf(cmake_file, "set(CMAKE_ARCHIVE_OUTPUT_DIRECTORY ${CMAKE_SOURCE_DIR}/lib/static/${CBUILD_OUTPUT_SUBDIR})\n");
+    fprintf(cmake_file, "set(CMAKE_LIBRARY_OUTPUT_DIRECTORY ${CMAKE_SOURCE_DIR}/lib/shared/${CBUILD_OUTPUT_SUBDIR})\n");
+
+    struct string_list installed_includes = {0};
+    const char* pch_owner = NULL;
+    for (size_t i = 0; i < targets->count; i++) {
+        const struct project_target* target = &targets->items[i];
+        bool library = strcmp(target->type, "executable") != 0;
+        fprintf(cmake_file, "\n# 目标 %s\n", target->name);
+
+        if (library) {
+            fprintf(cmake_file, "add_library(%s %s\n", target->name, !strcmp(target->type, "static") ? "STATIC" : "SHARED");
+        } 
+        else {
+            fprintf(cmake_file, "add_executable(%s\n", target->name);
+        }
+        emit_source_files(cmake_file, &target->files);
+        fprintf(cmake_file, ")\n");
+
+        // 库的公开头文件目录向链接它的目标传递
+        fprintf(cmake_file, "target_include_directories(%s %s", target->name, library ? "PUBLIC" : "PRIVATE");
+        for (size_t k = 0; k < target->include_dirs.count; k++) {
+            const char* dir = target->include_dirs.items[k];
+            fprintf(cmake_file, " \"%s%s\"", is_absolute_path(dir) ? "" : "${CMAKE_SOURCE_DIR}/", dir);
+        }
+        fprintf(cmake_file, ")\n");
+
+        struct string_list links = {0};
+        for (size_t k = 0; k < target->deps.count; k++) {
+            const char* name = target->deps.items[k];
+            const struct project_target* other = find_project_target(targets, name);
+            bool found = false;
+            if (other && other != target) {
+                if (!strcmp(other->type, "executable")) {
+                    printf("警告: CMake.toml第%d行: 目标 %s 不能链接可执行文件 %s\n", target->line, target->name, name);
+                } 
+                else {
+                    string_list_push(&links, name);
+                }
+                continue;
+            }
+            for (size_t n = 0; n < deps->count; n++) {
+                if (strcmp(deps->items[n].name, name)) continue;
+#if defined(PLATFORM_WINDOWS)
+                emit_dependency_include_dirs(cmake_file, target->name, &deps->items[n]);
+#endif
+                dependency_link_items(&deps->items[n], &links);
+                found = true;
+            }
+            if (!found) {
+                printf("警告: CMake.toml第%d行: 目标 %s 的依赖 %s 既不是目标也不是[dependencies]中的依赖项\n",
+                       target->line, target->name, name);
+            }
+        }
+        if (links.count > 0) {
+            fprintf(cmake_file, "target_link_libraries(%s %s\n", target->name, library ? "PUBLIC" : "PRIVATE");
+            for (size_t k = 0; k < links.count; k++) {
+                fprintf(cmake_file, "    %s\n", links.items[k]);
+            }
+            fprintf(cmake_file, ")\n");
+        }
+        string_list_free(&links);
+
+        fprintf(cmake_file, "install(TARGETS %s %s DESTINATION %s)\n", target->name,
+                !library ? "RUNTIME" : !strcmp(target->type, "static") ? "ARCHIVE" : "LIBRARY", library ? "lib" : "bin");
+        for (size_t k = 0; library && k < target->include_dirs.count; k++) {
+            const char* dir = target->include_dirs.items[k];
+            if (string_list_contains(&installed_includes, dir)) continue;
+            string_list_push(&installed_includes, dir);
+            fprintf(cmake_file, "install(DIRECTORY %s/ DESTINATION include)\n", dir);
+        }
+
+        if (add_precompile_headers && !string_list_contains(&opts->pch_reuse, target->name)) {
+            emit_precompile_headers(cmake_file, target->name);
+            if (!pch_owner) pch_owner = target->name;
+        }
+        emit_unity_build(cmake_file, target->name, opts);
+        emit_link_settings(cmake_file, target->name, opts);
+    }
+    emit_unity_exclude(cmake_file, opts);
+    if (pch_owner) {
+        emit_pch_reuse(cmake_file, pch_owner, opts);
+    }
+    string_list_free(&installed_includes);
+}
+
+// build_opts可以为NULL,此时使用默认构建选项
+int create_cmakelists(const char* project_name, const char* project_type, const struct dependency_list* deps, bool add_precompile_headers, const struct build_options* build_opts) {
+    struct build_options default_opts;
+    if (!build_opts) {
+        init_build_options(&default_opts);
+        build_opts = &default_opts;
+    }
+
+    // 内容不变时不改写CMakeLists.txt, 避免CMake在下次构建时重新配置
+    struct generated_file generated;
+    FILE* cmake_file = open_generated_file(&generated);
+    if (!cmake_file) {
+        perror("创建CMakeLists.txt失败");
+        return 0;
+    }
+    
+    fprintf(cmake_file, "cmake_minimum_required(VERSION 3.16)\n");
+    fprintf(cmake_file, "project(%s LANGUAGES CXX)\n\n", project_name);
+    fprintf(cmake_file, "set(CMAKE_CXX_STANDARD 11)\n");
+    fprintf(cmake_file, "set(CMAKE_CXX_STANDARD_REQUIRED ON)\n");
+    fprintf(cmake_file, "set(CMAKE_EXPORT_COMPILE_COMMANDS ON)\n\n");
+    emit_toolchain_checks(cmake_file, build_opts);
+    emit_dependencies(cmake_file, deps);
+    if (build_opts->targets.count > 0) {
+        emit_project_targets(cmake_file, deps, add_precompile_headers, build_opts);
+        return close_generated_file(&generated, "CMakeLists.txt");
+    }
+
+    if (strcmp(project_type, "executable") == 0) {
+        // 按构建类型分目录构建时由cbuild传入CBUILD_OUTPUT_SUBDIR,避免不同构建类型的产物互相覆盖
+        fprintf(cmake_file, "set(CMAKE_RUNTIME_OUTPUT_DIRECTORY ${CMAKE_SOURCE_DIR}/bin/${CBUILD_OUTPUT_SUBDIR})\n");
+        fprintf(cmake_file, "add_executable(%s\n", project_name);
+        if (build_opts->sources.count > 0) {
+            emit_source_files(cmake_file, &build_opts->source_files);
+        } 
+        else {
+            fprintf(cmake_file, "    src/main.cpp\n");
+        }
+        fprintf(cmake_file, ")\n");
+        fprintf(cmake_file, "target_include_directories(%s PRIVATE ${CMAKE_SOURCE_DIR}/include)\n",project_name);
+
+        // 安装规则（跨平台）
+        fprintf(cmake_file, "\n# 安装规则\n");
+        fprintf(cmake_file, "install(TARGETS %s\n", project_name);
+        fprintf(cmake_file, "    RUNTIME DESTINATION bin\n");
+        fprintf(cmake_file, ")\n");
+    } 
+    else if (strcmp(project_type, "static") == 0) {
+        fprintf(cmake_file, "set(CMAKE_ARCHIVE_OUTPUT_DIRECTORY ${CMAKE_SOURCE_DIR}/lib/static/${CBUILD_OUTPUT_SUBDIR})\n");
+        fprintf(cmake_file, "add_library(%s STATIC\n", project_name);
+        if (build_opts->sources.count > 0) {
+            emit_source_files(cmake_file, &build_opts->source_files);
+        } 
+        else {
+            fprintf(cmake_file, "    src/%s.cpp\n", project_name);
+        }
+        fprintf(cmake_file, ")\n");
+        fprintf(cmake_file, "target_include_directories(%s PRIVATE ${CMAKE_SOURCE_DIR}/include)\n",project_name);
+
+        // 安装规则（跨平台）
+        fprintf(cmake_file, "\n# 安装规则\n");
+        fprintf(cmake_file, "install(TARGETS %s\n", project_name);
+        fprintf(cmake_file, "    ARCHIVE DESTINATION lib\n");
+        fprintf(cmake_file, ")\n");
+        fprintf(cmake_file, "install(FILES include/%s.h DESTINATION include)\n", project_name);
+    } 
+    else if (strcmp(project_type, "shared") == 0) {
+        fprintf(cmake_file, "set(CMAKE_LIBRARY_OUTPUT_DIRECTORY ${CMAKE_SOURCE_DIR}/lib/shared/${CBUILD_OUTPUT_SUBDIR})\n");
+        fprintf(cmake_file, "add_library(%s SHARED\n", project_name);
+        if (build_opts->sources.count > 0) {
+            emit_source_files(cmake_file, &build_opts->source_files);
+        } 
+        else {
+            fprintf(cmake_file, "    src/%s.cpp\n", project_name);
+        }
+        fprintf(cmake_file, ")\n");
+        fprintf(cmake_file, "target_include_directories(%s PRIVATE ${CMAKE_SOURCE_DIR}/include)\n",project_name);
+        
+        // 安装规则（跨平台）
+        fprintf(cmake_file, "\n# 安装规则\n");
+        fprintf(cmake_file, "install(TARGETS %s\n", project_name);
+        fprintf(cmake_file, "    LIBRARY DESTINATION lib\n");
+        fprintf(cmake_file, ")\n");
+        fprintf(cmake_file, "install(FILES include/%s.h DESTINATION include)\n", project_name);
+    }
+    if(add_precompile_headers){
+        emit_precompile_headers(cmake_file, project_name);
+    }
+    emit_unity_build(cmake_file, project_name, build_opts);
+    emit_unity_exclude(cmake_file, build_opts);
+    emit_link_settings(cmake_file, project_name, build_opts);
+    emit_dependency_links(cmake_file, project_name, deps);
+    if(add_precompile_headers){
+        emit_pch_reuse(cmake_file, project_name, build_opts);
+    }
+    return close_generated_file(&generated, "CMakeLists.txt");
+}
+
+int create_directory(const char* path) {
+    if (MKDIR(path) == -1) {
+        if (errno != EEXIST) {
+            perror("创建目录失败");
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// 创建初始的main.cpp文件
+int create_main_cpp_file(bool add_precompile_headers) {
+    struct generated_file generated;
+    FILE* main_file = open_generated_file(&generated);
+    if (!main_file) {
+        perror("创建main.cpp失败");
+        return 0;
+    }
+    if(add_precompile_headers) fprintf(main_file, "#include \"pch.h\"\n");
+    fprintf(main_file, "#include <iostream>\n\n");
+    fprintf(main_file, "int main() {\n");
+    fprintf(main_file, "    std::cout << \"Hello, World!\" << std::endl;\n");
+    fprintf(main_file, "    return 0;\n");
+    fprintf(main_file, "}\n");
+    return close_generated_file(&generated, "src/main.cpp");
+}
+
+// 创建库源文件和头文件
+int create_library_files(const char* project_name, bool add_precompile_headers) {
+    // 创建源文件
+    char src_filename[MAX_PATH_LEN];
+    snprintf(src_filename, MAX_PATH_LEN, "src/%s.cpp", project_name);
+    struct generated_file generated;
+    FILE* src_file = open_generated_file(&generated);
+    if (!src_file) {
+        perror("创建库源文件失败");
+        return 0;
+    }
+    
+    if(add_precompile_headers) fprintf(src_file, "#include \"pch.h\"\n");
+    fprintf(src_file, "#include \"%s.h\"\n\n", project_name);
+    fprintf(src_file, "int %s_function() {\n", project_name);
+    fprintf(src_file, "    return 0;\n");
+    fprintf(src_file, "}\n");
+    if (!close_generated_file(&generated, src_filename)) return 0;
+    
+    // 创建头文件
+    char header_filename[MAX_PATH_LEN];
+    snprintf(header_filename, MAX_PATH_LEN, "include/%s.h", project_name);
+    FILE* header_file = open_generated_file(&generated);
+    if (!header_file) {
+        perror("创建头文件失败");
+        return 0;
+    }
+    
+    // 防止头文件重复包含的保护宏
+    char guard[MAX_PATH_LEN];
+    snprintf(guard, MAX_PATH_LEN, "%s_H", project_name);
+    for (char *p = guard; *p; p++) {
+        if (*p >= 'a' && *p <= 'z') *p -= 'a' - 'A';
+        else if (*p == '-' || *p == '.') *p = '_';
+    }
+    
+    fprintf(header_file, "#ifndef %s\n", guard);
+    fprintf(header_file, "#define %s\n\n", guard);
+    fprintf(header_file, "int %s_function();\n\n", project_name);
+    fprintf(header_file, "#endif // %s\n", guard);
+    
+    return close_generated_file(&generated, header_filename);
+}
+
+
+// 源文件索引(位于构建目录中): 记录目录的修改时间和条目以及上次展开的源文件列表,
+// 展开sources模式时只重新读取修改过的目录
+#define SOURCE_INDEX_FILE "cbuild_sources.index"
+// 修改时间距上次写入索引不足该值的目录可能在同一时间刻度内再次修改, 不使用记录的条目
+#define SOURCE_INDEX_RACY_US 2000000
+
+struct source_entry {
+    const char* name;
+    bool is_dir;
+};
+
+struct source_dir {
+    const char* path;      // 相对于项目根目录, 以/分隔, 根目录为"."
+    int64_t mtime_us;
+    size_t first_entry;    // 条目在entries中的范围
+    size_t entry_count;
+    bool build_tree;       // 含有CMakeCache.txt的构建目录, 不展开
+    bool visited;          // 本次展开时访问过, 只有访问过的目录写回索引
+};
+
+struct source_index {
+    struct source_dir* dirs;
+    size_t dir_count;
+    size_t dir_capacity;
+    size_t* slots;         // 按路径哈希的开放寻址表, 存放dirs的下标+1
+    size_t slot_count;
+    struct source_entry* entries;
+    size_t entry_count;
+    size_t entry_capacity;
+    int64_t written_us;    // 上次写入索引的时间
+    char* previous;        // 上次展开的源文件列表
+    size_t scanned;        // 本次重新读取的目录数
+    struct arena arena;
+};
+
+size_t source_index_find(const struct source_index* index, const char* path) {
+    if (index->slot_count == 0) return SIZE_MAX;
+    for (size_t slot = hash_string(FNV1A_OFFSET, path) & (index->slot_count - 1); index->slots[slot];
+         slot = (slot + 1) & (index->slot_count - 1)) {
+        size_t i = index->slots[slot] - 1;
+        if (!strcmp(index->dirs[i].path, path)) return i;
+    }
+    return SIZE_MAX;
+}
+
+// 添加一个目录, 返回其下标; 哈希表的负载超过一半时扩容
+size_t source_index_add(struct source_index* index, const char* path) {
+    if (index->dir_count == index->dir_capacity) {
+        size_t capacity = index->dir_capacity ? index->dir_capacity * 2 : 64;
+        struct source_dir* dirs = realloc(index->dirs, capacity * sizeof(*dirs));
+        if (!dirs) return SIZE_MAX;
+        index->dirs = dirs;
+        index->dir_capacity = capacity;
+    }
+    if ((index->dir_count + 1) * 2 > index->slot_count) {
+        size_t slot_count = index->slot_count ? index->slot_count * 2 : 128;
+        size_t* slots = calloc(slot_count, sizeof(*slots));
+        if (!slots) return SIZE_MAX;
+        free(index->slots);
+        index->slots = slots;
+        index->slot_count = slot_count;
+        for (size_t i = 0; i < index->dir_count; i++) {
+            size_t slot = hash_string(FNV1A_OFFSET, index->dirs[i].path) & (slot_count - 1);
+            while (slots[slot]) slot = (slot + 1) & (slot_count - 1);
+            slots[slot] = i + 1;
+        }
+    }
+    size_t i = index->dir_count++;
+    memset(&index->dirs[i], 0, sizeof(index->dirs[i]));
+    index->dirs[i].path = arena_strdup(&index->arena, path);
+    size_t slot = hash_string(FNV1A_OFFSET, path) & (index->slot_count - 1);
+    while (index->slots[slot]) slot = (slot + 1) & (index->slot_count - 1);
+    index->slots[slot] = i + 1;
+    return i;
+}
+
+bool source_index_push_entry(struct source_index* index, const char* name, bool is_dir) {
+    if (index->entry_count == index->entry_capacity) {
+        size_t capacity = index->entry_capacity ? index->entry_capacity * 2 : 256;
+        struct source_entry* entries = realloc(index->entries, capacity * sizeof(*entries));
+        if (!entries) return false;
+        index->entries = entries;
+        index->entry_capacity = capacity;
+    }
+    index->entries[index->entry_count++] = (struct source_entry){ arena_strdup(&index->arena, name), is_dir };
+    return true;
+}
+
+void source_index_free(struct source_index* index) {
+    free(index->dirs);
+    free(index->slots);
+    free(index->entries);
+    free(index->previous);
+    arena_free(&index->arena);
+    memset(index, 0, sizeof(*index));
+}
+
+// 索引文件格式(按行):
+//   time <写入时间>
+//   dir <修改时间> <是否为构建目录> <路径>, 其后是该目录的条目: f <文件名> 或 d <子目录名>
+//   [sources] 之后是上次展开的源文件列表
+void load_source_index(struct source_index* index, const char* path) {
+    char* data = read_file_contents(path, NULL);
+    if (!data) return;
+    size_t current = SIZE_MAX;
+    for (char* line = data; line && *line; ) {
+        char* next = strchr(line, '\n');
+        if (next) *next++ = '\0';
+        long long mtime;
+        int build_tree;
+        int consumed = 0;
+        if (!strcmp(line, "[sources]")) {
+            index->previous = strdup(next ? next : "");
+            break;
+        }
+        if (sscanf(line, "time %lld", &mtime) == 1) {
+            index->written_us = mtime;
+        }
+        else if (sscanf(line, "dir %lld %d %n", &mtime, &build_tree, &consumed) == 2 && consumed > 0) {
+            current = source_index_find(index, line + consumed) == SIZE_MAX ? source_index_add(index, line + consumed) : SIZE_MAX;
+            if (current != SIZE_MAX) {
+                index->dirs[current].mtime_us = mtime;
+                index->dirs[current].build_tree = build_tree != 0;
+                index->dirs[current].first_entry = index->entry_count;
+            }
+        }
+        else if ((line[0] == 'f' || line[0] == 'd') && line[1] == ' ' && current != SIZE_MAX) {
+            if (source_index_push_entry(index, line + 2, line[0] == 'd')) index->dirs[current].entry_count++;
+        }
+        line = next;
+    }
+    free(data);
+}
+
+// 返回目录在索引中的下标: 修改时间未变时使用记录的条目, 否则重新读取目录; 目录不存在时返回SIZE_MAX
+size_t scan_source_dir(struct source_index* index, const char* path) {
+    int64_t mtime = file_mtime_us(path);
+    size_t i = source_index_find(index, path);
+    if (i != SIZE_MAX && index->dirs[i].visited) return i;
+    if (i != SIZE_MAX && mtime != 0 && index->dirs[i].mtime_us == mtime && mtime + SOURCE_INDEX_RACY_US < index->written_us) {
+        index->dirs[i].visited = true;
+        return i;
+    }
+    DIR* dir = opendir(path);
+    if (!dir) return SIZE_MAX;
+    if (i == SIZE_MAX) i = source_index_add(index, path);
+    if (i == SIZE_MAX) {
+        closedir(dir);
+        return SIZE_MAX;
+    }
+    index->dirs[i].mtime_us = mtime;
+    index->dirs[i].first_entry = index->entry_count;
+    index->dirs[i].entry_count = 0;
+    index->dirs[i].build_tree = false;
+    index->dirs[i].visited = true;
+    index->scanned++;
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL) {
+        // 隐藏文件和目录(.git等)不参与匹配, 换行符无法写入索引
+        if (entry->d_name[0] == '.' || strchr(entry->d_name, '\n')) continue;
+        if (!strcmp(entry->d_name, "CMakeCache.txt")) index->dirs[i].build_tree = true;
+        bool is_dir;
+#if defined(DT_DIR)
+        if (entry->d_type != DT_UNKNOWN && entry->d_type != DT_LNK) {
+            is_dir = entry->d_type == DT_DIR;
+        } 
+        else
+#endif
+        {
+            // 指向目录的符号链接不展开(src/loop -> . 会无限递归), 指向文件的符号链接按文件处理
+            char child[MAX_PATH_LEN];
+            struct stat st;
+            snprintf(child, sizeof(child), "%s/%s", path, entry->d_name);
+            if (stat(child, &st) != 0) continue;
+            is_dir = S_ISDIR(st.st_mode);
+            if (is_dir && is_symlink(child)) continue;
+        }
+        if (source_index_push_entry(index, entry->d_name, is_dir)) index->dirs[i].entry_count++;
+    }
+    closedir(dir);
+    return i;
+}
+
+// glob匹配: * 和 ? 不匹配/, **/ 匹配零个或多个目录, 结尾的 ** 匹配任意路径
+bool glob_match(const char* pattern, const char* path) {
+    while (*pattern) {
+        if (pattern[0] == '*' && pattern[1] == '*' && (pattern[2] == '/' || pattern[2] == '\0')) {
+            if (pattern[2] == '\0') return true;
+            for (const char* p = path; p; p = strchr(p, '/'), p = p ? p + 1 : NULL) {
+                if (glob_match(pattern + 3, p)) return true;
+            }
+            return false;
+        }
+        if (*pattern == '*') {
+            for (const char* p = path; ; p++) {
+                if (glob_match(pattern + 1, p)) return true;
+                if (*p == '\0' || *p == '/') return false;
+            }
+        }
+        if (*path == '\0' || (*pattern == '?' ? *path == '/' : *pattern != *path)) return false;
+        pattern++;
+        path++;
+    }
+    return *path == '\0';
+}
+
+// 从dir_path开始逐级匹配, depth为还可以进入的子目录层数(负数表示不限制)
+void walk_source_dir(struct source_index* index, const char* dir_path, const char* pattern, int depth, struct string_list* out) {
+    size_t d = scan_source_dir(index, dir_path);
+    if (d == SIZE_MAX || index->dirs[d].build_tree) return;
+    // 递归期间entries可能重新分配, 每次按下标访问
+    for (size_t k = 0; k < index->dirs[d].entry_count; k++) {
+        const struct source_entry entry = index->entries[index->dirs[d].first_entry + k];
+        char path[MAX_PATH_LEN];
+        if (!strcmp(dir_path, ".")) {
+            snprintf(path, sizeof(path), "%s", entry.name);
+        } 
+        else {
+            snprintf(path, sizeof(path), "%s/%s", dir_path, entry.name);
+        }
+        if (!entry.is_dir) {
+            if (glob_match(pattern, path)) string_list_push(out, path);
+        }
+        else if (depth != 0 && !is_symlink(path)) {
+            // 旧索引中可能记录了指向目录的符号链接, 进入前再检查一次
+            walk_source_dir(index, path, pattern, depth - 1, out);
+        }
+    }
+}
+
+// 展开一个sources模式: 不含通配符的部分作为起始目录, 不含通配符的模式直接作为文件
+void expand_source_pattern(struct source_index* index, const char* pattern, struct string_list* out) {
+    while (pattern[0] == '.' && pattern[1] == '/') pattern += 2;
+    if (!strpbrk(pattern, "*?")) {
+        struct stat st;
+        if (stat(pattern, &st) == 0 && !S_ISDIR(st.st_mode)) string_list_push(out, pattern);
+        return;
+    }
+    const char* wildcard = strpbrk(pattern, "*?");
+    const char* base_end = wildcard;
+    while (base_end > pattern && base_end[-1] != '/') base_end--;
+    char base[MAX_PATH_LEN] = ".";
+    if (base_end > pattern) snprintf(base, sizeof(base), "%.*s", (int)(base_end - pattern - 1), pattern);
+    int depth = 0;
+    for (const char* c = base_end; *c; c++) {
+        if (*c == '/') depth++;
+    }
+    walk_source_dir(index, base, pattern, strstr(base_end, "**") ? -1 : depth, out);
+}
+
+int compare_strings(const void* a, const void* b) {
+    return strcmp(*(const char* const*)a, *(const char* const*)b);
+}
+
+// 展开一组模式到files, 结果排序并去重
+void expand_sources(struct source_index* index, const struct string_list* patterns, struct string_list* files) {
+    struct string_list found = {0};
+    for (size_t i = 0; i < patterns->count; i++) {
+        expand_source_pattern(index, patterns->items[i], &found);
+    }
+    if (found.count > 1) qsort(found.items, found.count, sizeof(*found.items), compare_strings);
+    for (size_t i = 0; i < found.count; i++) {
+        if (i == 0 || strcmp(found.items[i], found.items[i - 1])) string_list_push(files, found.items[i]);
+    }
+    string_list_free(&found);
+}
+
+// 展开[project]和[[target]]的sources模式, 使用index_dir中的源文件索引;
+// changed返回源文件列表与上次展开的结果是否不同
+int expand_project_sources(struct build_options* opts, const char* index_dir, bool* changed) {
+    *changed = false;
+    if (opts->sources.count == 0 && opts->targets.count == 0) return 1;
+    char index_path[MAX_PATH_LEN];
+    snprintf(index_path, sizeof(index_path), "%s%c%s", index_dir, PATH_SEP, SOURCE_INDEX_FILE);
+    struct source_index index = {0};
+    load_source_index(&index, index_path);
+
+    struct string_buffer listing = {0};
+    string_buffer_append(&listing, "", 0);
+    if (opts->sources.count > 0) {
+        opts->source_files.count = 0;
+        expand_sources(&index, &opts->sources, &opts->source_files);
+        string_buffer_appendf(&listing, "project\n");
+        for (size_t i = 0; i < opts->source_files.count; i++) {
+            string_buffer_appendf(&listing, "s %s\n", opts->source_files.items[i]);
+        }
+        if (opts->source_files.count == 0) printf("警告: [project]的sources没有匹配到源文件\n");
+    }
+    for (size_t t = 0; t < opts->targets.count; t++) {
+        struct project_target* target = &opts->targets.items[t];
+        target->files.count = 0;
+        expand_sources(&index, &target->sources, &target->files);
+        string_buffer_appendf(&listing, "target %s\n", target->name);
+        for (size_t i = 0; i < target->files.count; i++) {
+            string_buffer_appendf(&listing, "s %s\n", target->files.items[i]);
+        }
+        if (target->files.count == 0) printf("警告: 目标 %s 的sources没有匹配到源文件\n", target->name);
+    }
+    *changed = !index.previous || strcmp(index.previous, listing.data) != 0;
+
+    // 有目录重新读取或列表变化时写回索引, 只保留本次访问过的目录
+    struct stat st;
+    if ((index.scanned > 0 || *changed) && (stat(index_dir, &st) == 0 || create_directory(index_dir))) {
+        struct generated_file generated;
+        FILE* file = open_generated_file(&generated);
+        if (file) {
+            struct timespec now;
+            timespec_get(&now, TIME_UTC);
+            fprintf(file, "# 由cbuild生成的源文件索引,不要手动修改\n");
+            fprintf(file, "time %lld\n", (long long)now.tv_sec * 1000000 + now.tv_nsec / 1000);
+            for (size_t i = 0; i < index.dir_count; i++) {
+                const struct source_dir* dir = &index.dirs[i];
+                if (!dir->visited) continue;
+                fprintf(file, "dir %lld %d %s\n", (long long)dir->mtime_us, dir->build_tree ? 1 : 0, dir->path);
+                for (size_t k = 0; k < dir->entry_count; k++) {
+                    const struct source_entry* entry = &index.entries[dir->first_entry + k];
+                    fprintf(file, "%c %s\n", entry->is_dir ? 'd' : 'f', entry->name);
+                }
+            }
+            fprintf(file, "[sources]\n%s", listing.data);
+            close_generated_file(&generated, index_path);
+        }
+    }
+    string_buffer_free(&listing);
+    source_index_free(&index);
+    return 1;
+}
+
+// 构建前展开sources模式, 源文件列表变化或CMakeLists.txt不存在时重新生成CMakeLists.txt
+int refresh_cmakelists(const char* build_dir, struct build_options* opts, const struct dependency_list* deps) {
+    bool changed = false;
+    if (opts->sources.count == 0 && opts->targets.count == 0) return 1;
+    if (!expand_project_sources(opts, build_dir, &changed)) return 0;
+    struct stat st;
+    if (!changed && stat("CMakeLists.txt", &st) == 0) return 1;
+    char project_name[MAX_PATH_LEN] = "";
+    char project_type[15] = "executable";
+    bool add_precompile_headers = false;
+    parse_cmake_toml(project_name, project_type, NULL, &add_precompile_headers, NULL);
+    printf("源文件列表已变化,重新生成CMakeLists.txt\n");
+    return create_cmakelists(project_name, project_type, deps, add_precompile_headers, opts);
+}
+
+
+uint8_t create_new_project(int argc,char*argv[]){
+    char project_name[MAX_PATH_LEN] = "my_project";
+    char project_type[15] = "executable";
+    struct string_list deps_from_cli = {0};
+    uint8_t project_name_set = 0;
+    uint8_t create_project = 0;
+    bool add_precompile_headers = false;
+
+    if(2==argc){
+        create_project++;
+    }
+    if(2<argc && argv[2][0]!='-'){
+        create_project++;
+        project_name_set = 1;
+        strcpy(project_name,argv[2]);
+    }
+    else{
+        create_project++;
+    }
+    
+    // 解析命令行参数
+    for(size_t i = 2; i < argc; i++){
+        if(!strcmp(argv[i], "-e") || !strcmp(argv[i], "--executable")) {
+            strcpy(project_type, "executable");
+        }
+        else if(!strcmp(argv[i], "-s") || !strcmp(argv[i], "--static")) {
+            strcpy(project_type, "static");
+        }
+        else if(!strcmp(argv[i], "-d") || !strcmp(argv[i], "--shared")) {
+            strcpy(project_type, "shared");
+        }
+        else if(!strcmp(argv[i], "-p") || !strcmp(argv[i], "--precompile-headers")) {
+            add_precompile_headers = true;
+        }
+        else if(!strcmp(argv[i], "-h") || !strcmp(argv[i], "--help")) {
+            print_usage(argv[0]);
+            string_list_free(&deps_from_cli);
+            return EXIT_SUCCESS;
+        }
+        else if((!strcmp(argv[i], "-D") || !strcmp(argv[i], "--dep")) && i+1 < argc) {
+            // 获取依赖项名称
+            i++;
+            string_list_push(&deps_from_cli, argv[i]);
+        }
+    }
+
+    if(!project_name_set){
+        printf("未设置项目名称,使用默认名称%s\n",project_name);
+    }
+    printf("项目名称为 : %s\n",project_name);
+    printf("项目类型为 : %s (%s)\n",project_name, 
+           strcmp(project_type, "executable") == 0 ? "可执行文件" :
+           strcmp(project_type, "static") == 0 ? "静态库" : "动态库");
+    
+    // 显示命令行添加的依赖项
+    if(deps_from_cli.count > 0) {
+        printf("命令行添加的依赖项: ");
+        for(size_t i = 0; i < deps_from_cli.count; i++) {
+            printf("%s ", deps_from_cli.items[i]);
+        }
+        printf("\n");
+    }
+    
+    if(!create_directory(project_name)){
+        string_list_free(&deps_from_cli);
+        return EXIT_FAILURE;
+    }
+
+    if(CHDIR(project_name)!=0){
+        perror("无法进入项目目录");
+        string_list_free(&deps_from_cli);
+        return EXIT_FAILURE;
+    }
+
+    // 创建目录和CMake.toml文件（包含命令行依赖项）
+    bool created = create_directory("src") && 
+                   create_directory("include") && 
+                   create_directory("build") &&
+                   create_cmake_toml(project_name, project_type, &deps_from_cli, add_precompile_headers);
+    string_list_free(&deps_from_cli);
+    if (!created) {
+        return EXIT_FAILURE;
+    }
+    
+    // 解析CMake.toml获取依赖项（包括命令行添加的）
+    struct dependency_list deps = {0};
+    struct build_options build_opts;
+    init_build_options(&build_opts);
+    if (parse_cmake_toml(project_name, project_type, &deps, &add_precompile_headers, &build_opts) <= 0) {
+        printf("警告 : 未能完全解析CMake.toml,使用默认配置\n");
+    }
+    else if (deps.count > 0) {
+        printf("检测到依赖项: ");
+        for (size_t i = 0; i < deps.count; i++) {
+            printf("%s ", deps.items[i].name);
+        }
+        printf("\n");
+    }
+
+    // 创建CMakeLists.txt文件（带依赖处理）, 之后只需要知道是否有依赖项
+    created = create_cmakelists(project_name, project_type, &deps, add_precompile_headers, &build_opts);
+    bool has_deps = deps.count > 0;
+    dependency_list_free(&deps);
+    free_build_options(&build_opts);
+    if(!created){
+        return EXIT_FAILURE;
+    }
+    
+    if (strcmp(project_type, "executable") == 0) {
+        if (!create_main_cpp_file(add_precompile_headers)) {
+            return EXIT_FAILURE;
+        }
+    } 
+    else {
+        if (!create_library_files(project_name,add_precompile_headers)) {
+            return EXIT_FAILURE;
+        }
+    }
+    if(add_precompile_headers){
+        if(!create_precompile_headers(add_precompile_headers)){
+            return EXIT_FAILURE;
+        }
+    }
+    // 输出成功信息
+    printf("\n项目创建成功! 结构如下:\n");
+    printf("%s%c\n", project_name, PATH_SEP);
+    printf("├── CMakeLists.txt\n");
+    printf("├── CMake.toml\n");
+    printf("├── build%c\n", PATH_SEP);
+    printf("├── include%c\n", PATH_SEP);
+    if (strcmp(project_type, "static") == 0 || strcmp(project_type, "shared") == 0) {
+        printf("│   └── %s.h\n", project_name);
+    }
+    printf("└── src%c\n", PATH_SEP);
+    
+    if (strcmp(project_type, "executable") == 0) {
+        printf("    └── main.cpp\n");
+    } else {
+        printf("    └── %s.cpp\n", project_name);
+    }
+
+    printf("\n构建指南:\n");
+    printf("  cd %s\n", project_name);
+    printf("  cd build\n");
+    
+    if (strcmp(project_type, "executable") == 0) {
+        printf("  cmake ..\n");
+        printf("  cmake --build .\n");
+        printf("  .%c%s%s\n", PATH_SEP, project_name, EXE_EXT);
+    } 
+    else if (strcmp(project_type, "static") == 0) {
+        printf("  cmake ..\n");
+        printf("  cmake --build .\n");
+        printf("  # 静态库文件: build%clib%cstatic%c%s%s\n", 
+               PATH_SEP, PATH_SEP, PATH_SEP, project_name, STATIC_LIB_EXT);
+    } 
+    else {
+        printf("  cmake ..\n");
+        printf("  cmake --build .\n");
+        printf("  # 动态库文件: build%cbin%c%s%s (Windows) 或 build%clib%cshared%c%s\n", 
+               PATH_SEP, PATH_SEP, project_name, SHARED_LIB_EXT, 
+               PATH_SEP, PATH_SEP, PATH_SEP, SHARED_LIB_EXT);
+    }
+    
+    if (has_deps) {
+        printf("\n注意 : 本项目的依赖项需要通过系统包管理器安装\n");
+#if defined(PLATFORM_WINDOWS)
+        printf("      请使用 vcpkg 安装依赖项\n");
+#elif defined(PLATFORM_MACOS)
+        printf("      请使用 Homebrew 安装依赖项\n");
+#else
+        printf("      请使用 apt-get/yum 安装依赖项\n");
+#endif
+    }
+    
+    return EXIT_SUCCESS;
+
+}
+
+uint8_t init_project(int argc,char*argv[]){
+    char project_name[MAX_PATH_LEN] = "my_project";
+    char project_type[15] = "executable";
+    struct dependency_list deps = {0};
+    bool add_precompile_headers = false;
+    struct build_options build_opts;
+    bool sources_changed = false;
+    init_build_options(&build_opts);
+
+    // 尝试从CMake.toml获取项目名称
+    if (parse_cmake_toml(project_name, project_type, &deps, &add_precompile_headers, &build_opts) > 0) {
+        printf("从CMake.toml获取项目名称: %s\n", project_name);
+        printf("从CMake.toml获取项目类型: %s\n", project_type);
+        if (deps.count > 0) {
+            printf("检测到依赖项: ");
+            for (size_t i = 0; i < deps.count; i++) {
+                printf("%s ", deps.items[i].name);
+            }
+            printf("\n");
+        }
+    } 
+    else {
+        printf("无法打开CMake.toml或解析失败\n");
+        dependency_list_free(&deps);
+        free_build_options(&build_opts);
+        return EXIT_FAILURE;
+    }
+
+    printf("\n在当前目录初始化项目: %s (%s)\n", project_name, 
+           strcmp(project_type, "executable") == 0 ? "可执行文件" :
+           strcmp(project_type, "static") == 0 ? "静态库" : "动态库");
+
+    // 创建必要的子目录
+    struct stat st;
+    memset(&st, 0, sizeof(st)); // 修复初始化方式
+    
+    bool created = (stat("src", &st) == 0 || create_directory("src")) &&
+                   (stat("include", &st) == 0 || create_directory("include")) &&
+                   (stat("build", &st) == 0 || create_directory("build")) &&
+                   // 展开sources模式, 源文件索引位于build目录中
+                   expand_project_sources(&build_opts, "build", &sources_changed) &&
+                   // 创建CMakeLists.txt文件（带依赖处理）
+                   create_cmakelists(project_name, project_type, &deps, add_precompile_headers, &build_opts);
+    // 用[[target]]或sources指定源文件时源文件由用户组织
+    size_t target_count = build_opts.targets.count;
+    bool has_targets = target_count > 0;
+    bool has_sources = build_opts.sources.count > 0;
+    free_build_options(&build_opts);
+    if (!created) {
+        dependency_list_free(&deps);
+        return EXIT_FAILURE;
+    }
+
+    // 创建源文件（如果不存在）
+    if (has_targets || has_sources) {
+        // 源文件由sources指定
+    }
+    else if (strcmp(project_type, "executable") == 0) {
+        if (stat("src/main.cpp", &st) == -1 && !create_main_cpp_file(add_precompile_headers)) {
+            dependency_list_free(&deps);
+            return EXIT_FAILURE;
+        }
+    } 
+    else {
+        char src_file[MAX_PATH_LEN];
+        snprintf(src_file, MAX_PATH_LEN, "src/%s.cpp", project_name);
+        if (stat(src_file, &st) == -1 && !create_library_files(project_name,add_precompile_headers)) {
+            dependency_list_free(&deps);
+            return EXIT_FAILURE;
+        }
+    }
+    if(add_precompile_headers){
+        if(!create_precompile_headers(add_precompile_headers)){
+            dependency_list_free(&deps);
+            return EXIT_FAILURE;
+        }
+    }
+    // 输出成功信息
+    printf("\n项目初始化成功!\n");
+    printf("已创建/更新以下文件:\n");
+    printf("  CMakeLists.txt\n");
+    if (stat("CMake.toml", &st) == -1) {
+        printf("  CMake.toml (已创建)\n");
+        struct string_list specs = {0};
+        for (size_t i = 0; i < deps.count; i++) {
+            const struct dependency* dep = &deps.items[i];
+            string_list_pushf(&specs, "%s%s%s", dep->name, dep->op ? dep->op : "", dep->op ? dep->version : "");
+        }
+        create_cmake_toml(project_name, project_type, &specs, add_precompile_headers);
+        string_list_free(&specs);
+    } 
+    else {
+        printf("  CMake.toml (已更新)\n");
+    }
+    
+    if (has_targets) {
+        printf("  (%zu 个[[target]]目标)\n", target_count);
+    }
+    else if (has_sources) {
+        printf("  (源文件由sources指定)\n");
+    }
+    else if (strcmp(project_type, "static") == 0 || strcmp(project_type, "shared") == 0) {
+        printf("  include/%s.h\n", project_name);
+        printf("  src/%s.cpp\n", project_name);
+    } 
+    else {
+        printf("  src/main.cpp\n");
+    }
+    
+    if (deps.count > 0) {
+        printf("\n注意 : 本项目的依赖项需要通过系统包管理器安装\n");
+#if defined(PLATFORM_WINDOWS)
+        printf("      请使用 vcpkg 安装依赖项\n");
+#elif defined(PLATFORM_MACOS)
+        printf("      请使用 Homebrew 安装依赖项\n");
+#else
+        printf("      请使用 apt-get/yum 安装依赖项\n");
+#endif
+    }
+    
+    dependency_list_free(&deps);
+    return EXIT_SUCCESS;
+}
+
+// 当前时间(微秒)
+int64_t now_us() {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+// 把参数数组格式化为可读(也可交给shell执行)的命令行,含空格或引号的参数加引号
+// 返回的字符串由调用方free
+char* format_command(char* const argv[]) {
+    struct string_buffer out = {0};
+    string_buffer_append(&out, "", 0);
+    for (size_t i = 0; argv[i]; i++) {
+        bool quote = argv[i][0] == '\0' || strpbrk(argv[i], " \t\"'") != NULL;
+        if (i > 0) string_buffer_append(&out, " ", 1);
+        if (quote) string_buffer_append(&out, "\"", 1);
+        for (const char* c = argv[i]; *c; c++) {
+            if (quote && (*c == '"' || *c == '\\')) string_buffer_append(&out, "\\", 1);
+            string_buffer_append(&out, c, 1);
+        }
+        if (quote) string_buffer_append(&out, "\"", 1);
+    }
+    return out.data;
+}
+
+// 子进程输出的处理方式; 全部为空时子进程直接继承终端
+struct run_options {
+    const char* prefix;                                  // 每行输出前的前缀
+    bool timestamps;                                     // 每行输出前加上距启动的时间
+    void (*on_line)(const char* line, void* ctx);        // 每行输出的回调
+    void* ctx;
+    bool quiet;                                          // 不显示命令、输出和失败信息, 只交给回调
+    const char* cwd;                                     // 子进程的工作目录, NULL表示当前目录
+    bool process_group;                                  // 子进程放入新的进程组, 可以连同其子进程一起终止
+    bool hide_command;                                   // 不显示执行的命令, 用于stdout需要保持机器可读的场合
+};
+
+// 正在运行的子进程
+struct child_process {
+    int64_t pid;
+    int output_fd;    // 捕获输出时为管道读端, 否则为-1
+    int term_signal;  // 子进程因信号退出时的信号编号
+};
+
+bool run_options_capture(const struct run_options* opts) {
+    return opts && (opts->prefix || opts->timestamps || opts->on_line || opts->quiet);
+}
+
+#if !defined(PLATFORM_WINDOWS)
+static volatile sig_atomic_t forward_pid = 0;
+
+// 终端产生的信号(Ctrl-C等)已经发送到整个前台进程组,子进程自己会收到;
+// 只转发通过kill()单独发给cbuild的信号,避免子进程收到两次
+void forward_signal(int sig, siginfo_t* info, void* context) {
+    (void)context;
+    if (forward_pid > 0 && info && (info->si_code == SI_USER || info->si_code == SI_QUEUE)) {
+        kill((pid_t)forward_pid, sig);
+    }
+}
+#endif
+
+// glibc 2.29和macOS 10.15起提供posix_spawn_file_actions_addchdir_np
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 29))
+#define SPAWN_HAS_ADDCHDIR 1
+#elif defined(__APPLE__) && defined(__MAC_OS_X_VERSION_MIN_REQUIRED) && __MAC_OS_X_VERSION_MIN_REQUIRED >= 101500
+#define SPAWN_HAS_ADDCHDIR 1
+#else
+#define SPAWN_HAS_ADDCHDIR 0
+#endif
+
+// 启动子进程(不经过shell), argv[0]在PATH中查找
+int spawn_process(char* const argv[], const struct run_options* opts, struct child_process* child) {
+    if (!opts || (!opts->quiet && !opts->hide_command)) {
+        char* display = format_command(argv);
+        printf("执行命令: %s\n", display ? display : argv[0]);
+        fflush(stdout);
+        free(display);
+    }
+    child->pid = -1;
+    child->output_fd = -1;
+    child->term_signal = 0;
+
+#if defined(PLATFORM_WINDOWS)
+    // Windows下没有posix_spawn,通过cmd执行, 输出在wait_process中读取
+    (void)opts;
+    child->pid = 0;
+    return 1;
+#else
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+#if SPAWN_HAS_ADDCHDIR
+    // 工作目录只对子进程生效, 不影响其他线程
+    if (opts && opts->cwd) posix_spawn_file_actions_addchdir_np(&actions, opts->cwd);
+#else
+    // 没有addchdir_np时启动期间临时切换整个进程的工作目录, 只能由主线程调用
+    char saved_cwd[MAX_PATH_LEN];
+    if (opts && opts->cwd && (!getcwd(saved_cwd, sizeof(saved_cwd)) || CHDIR(opts->cwd) != 0)) {
+        fprintf(stderr, "无法进入目录 %s: %s\n", opts->cwd, strerror(errno));
+        posix_spawn_file_actions_destroy(&actions);
+        return 0;
+    }
+#endif
+    int pipe_fds[2] = {-1, -1};
+    if (run_options_capture(opts)) {
+        // 管道带FD_CLOEXEC, 不会泄漏给同时启动的其他子进程(工作区并行构建)
+#if defined(PLATFORM_LINUX)
+        int piped = pipe2(pipe_fds, O_CLOEXEC);
+#else
+        int piped = pipe(pipe_fds);
+        if (piped == 0) {
+            fcntl(pipe_fds[0], F_SETFD, FD_CLOEXEC);
+            fcntl(pipe_fds[1], F_SETFD, FD_CLOEXEC);
+        }
+#endif
+        if (piped != 0) {
+            perror("创建管道失败");
+            posix_spawn_file_actions_destroy(&actions);
+#if !SPAWN_HAS_ADDCHDIR
+            if (opts->cwd && CHDIR(saved_cwd) != 0) perror("恢复工作目录失败");
+#endif
+            return 0;
+        }
+        posix_spawn_file_actions_addclose(&actions, pipe_fds[0]);
+        posix_spawn_file_actions_adddup2(&actions, pipe_fds[1], STDOUT_FILENO);
+        posix_spawn_file_actions_adddup2(&actions, pipe_fds[1], STDERR_FILENO);
+        posix_spawn_file_actions_addclose(&actions, pipe_fds[1]);
+    }
+
+    // 新的进程组不是前台进程组, 读取终端会因SIGTTIN停止, 标准输入改为/dev/null
+    if (opts && opts->process_group) {
+        posix_spawn_file_actions_addopen(&actions, STDIN_FILENO, "/dev/null", O_RDONLY, 0);
+    }
+
+    posix_spawnattr_t attr;
+    posix_spawnattr_init(&attr);
+    if (opts && opts->process_group) {
+        posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETPGROUP);
+        posix_spawnattr_setpgroup(&attr, 0);
+    }
+
+    pid_t pid;
+    int err = posix_spawnp(&pid, argv[0], &actions, &attr, argv, environ);
+    posix_spawn_file_actions_destroy(&actions);
+    posix_spawnattr_destroy(&attr);
+#if !SPAWN_HAS_ADDCHDIR
+    if (opts && opts->cwd && CHDIR(saved_cwd) != 0) perror("恢复工作目录失败");
+#endif
+    if (pipe_fds[1] != -1) close(pipe_fds[1]);
+    if (err != 0) {
+        fprintf(stderr, "无法启动 %s: %s\n", argv[0], strerror(err));
+        if (pipe_fds[0] != -1) close(pipe_fds[0]);
+        return 0;
+    }
+    child->pid = pid;
+    child->output_fd = pipe_fds[0];
+    return 1;
+#endif
+}
+
+// 转发一行输出(带前缀和时间戳)并交给回调
+void emit_output_line(const char* line, const struct run_options* opts, int64_t start_us) {
+    if (opts->quiet) {
+        if (opts->on_line) opts->on_line(line, opts->ctx);
+        return;
+    }
+    // 多个线程同时转发输出时(工作区并行构建)保持整行输出
+#if !defined(PLATFORM_WINDOWS)
+    flockfile(stdout);
+#endif
+    if (opts->timestamps) {
+        printf("[%8.3f] ", (now_us() - start_us) / 1e6);
+    }
+    if (opts->prefix) {
+        printf("%s", opts->prefix);
+    }
+    printf("%s\n", line);
+    fflush(stdout);
+#if !defined(PLATFORM_WINDOWS)
+    funlockfile(stdout);
+#endif
+    if (opts->on_line) opts->on_line(line, opts->ctx);
+}
+
+#if !defined(PLATFORM_WINDOWS)
+// 检查waitpid得到的子进程退出状态
+int check_exit_status(struct child_process* child, int status, const struct run_options* opts) {
+    if (WIFSIGNALED(status)) {
+        child->term_signal = WTERMSIG(status);
+        fprintf(stderr, "命令被信号 %d 终止\n", WTERMSIG(status));
+        return 0;
+    }
+    if (!WIFEXITED(status)) {
+        fprintf(stderr, "命令异常终止\n");
+        return 0;
+    }
+    if (WEXITSTATUS(status) != 0) {
+        if (!opts || !opts->quiet) fprintf(stderr, "命令退出代码: %d\n", WEXITSTATUS(status));
+        return 0;
+    }
+    return 1;
+}
+#endif
+
+// 转发子进程输出直到结束,等待子进程退出并检查状态
+int wait_process(struct child_process* child, char* const argv[], const struct run_options* opts) {
+#if defined(PLATFORM_WINDOWS)
+    char* command = format_command(argv);
+    struct string_buffer full_command = {0};
+    if (!command) return 0;
+    if (opts && opts->cwd) {
+        // cmd先进入工作目录再执行命令
+        string_buffer_appendf(&full_command, "cd /d \"%s\" && ", opts->cwd);
+    }
+    if (!run_options_capture(opts)) {
+        string_buffer_appendf(&full_command, "cmd /c \"%s\"", command);
+        free(command);
+        int status = system(full_command.data);
+        string_buffer_free(&full_command);
+        if (status != 0) {
+            fprintf(stderr, "命令退出代码: %d\n", status);
+            return 0;
+        }
+        return 1;
+    }
+    string_buffer_appendf(&full_command, "%s 2>&1", command);
+    free(command);
+    FILE* pipe = _popen(full_command.data, "r");
+    string_buffer_free(&full_command);
+    if (!pipe) {
+        perror("命令执行失败");
+        return 0;
+    }
+    int64_t start_us = now_us();
+    char line[BUFFER_SIZE * 8];
+    while (fgets(line, sizeof(line), pipe)) {
+        line[strcspn(line, "\r\n")] = '\0';
+        emit_output_line(line, opts, start_us);
+    }
+    int status = _pclose(pipe);
+    if (status != 0) {
+        if (!opts->quiet) fprintf(stderr, "命令退出代码: %d\n", status);
+        return 0;
+    }
+    return 1;
+#else
+    (void)argv;
+    if (child->output_fd != -1) {
+        int64_t start_us = now_us();
+        char buffer[BUFFER_SIZE * 8];
+        struct string_buffer line = {0};
+        string_buffer_append(&line, "", 0);
+        for (;;) {
+            ssize_t n = read(child->output_fd, buffer, sizeof(buffer));
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) break;
+            // 按行转发,行的长度不受读缓冲区大小限制
+            const char* start = buffer;
+            const char* end = buffer + n;
+            for (const char* nl; (nl = memchr(start, '\n', (size_t)(end - start))) != NULL; start = nl + 1) {
+                string_buffer_append(&line, start, (size_t)(nl - start));
+                if (line.length > 0 && line.data[line.length - 1] == '\r') line.data[--line.length] = '\0';
+                emit_output_line(line.data, opts, start_us);
+                line.length = 0;
+                line.data[0] = '\0';
+            }
+            string_buffer_append(&line, start, (size_t)(end - start));
+        }
+        if (line.length > 0) {
+            emit_output_line(line.data, opts, start_us);
+        }
+        string_buffer_free(&line);
+        close(child->output_fd);
+        child->output_fd = -1;
+    }
+
+    int status;
+    pid_t result;
+    do {
+        result = waitpid((pid_t)child->pid, &status, 0);
+    } while (result == -1 && errno == EINTR);
+    if (result == -1) {
+        perror("等待子进程失败");
+        return 0;
+    }
+    return check_exit_status(child, status, opts);
+#endif
+}
+
+// 运行命令并等待结束,运行期间把收到的终止信号转发给子进程;
+// 子进程因信号退出时cbuild以同一信号退出,使调用方(shell、脚本循环)能感知中断
+int run_process(char* const argv[], const struct run_options* opts) {
+#if defined(PLATFORM_WINDOWS)
+    struct child_process child;
+    if (!spawn_process(argv, opts, &child)) return 0;
+    return wait_process(&child, argv, opts);
+#else
+    static const int forwarded_signals[] = { SIGINT, SIGTERM, SIGHUP, SIGQUIT };
+    const size_t signal_count = sizeof(forwarded_signals) / sizeof(forwarded_signals[0]);
+    struct sigaction action, previous[sizeof(forwarded_signals) / sizeof(forwarded_signals[0])];
+    memset(&action, 0, sizeof(action));
+    action.sa_sigaction = forward_signal;
+    action.sa_flags = SA_SIGINFO | SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    for (size_t i = 0; i < signal_count; i++) {
+        sigaction(forwarded_signals[i], &action, &previous[i]);
+    }
+
+    struct child_process child;
+    int ok = spawn_process(argv, opts, &child);
+    if (ok) {
+        forward_pid = (sig_atomic_t)child.pid;
+        ok = wait_process(&child, argv, opts);
+        forward_pid = 0;
+    }
+
+    for (size_t i = 0; i < signal_count; i++) {
+        sigaction(forwarded_signals[i], &previous[i], NULL);
+    }
+    for (size_t i = 0; ok == 0 && i < signal_count; i++) {
+        if (child.term_signal == forwarded_signals[i]) {
+            fflush(stdout);
+            raise(child.term_signal);
+        }
+    }
+    return ok;
+#endif
+}
+
+// 通过shell执行命令字符串,用于用户在CMake.toml中配置的命令(例如[pgo] train)
+int execute_command(const char* command) {
+#if defined(PLATFORM_WINDOWS)
+    printf("执行命令: %s\n", command);
+    // Windows下需要将参数传递给cmd
+    char cmd[MAX_PATH_LEN * 3];
+    snprintf(cmd, sizeof(cmd), "cmd /c \"%s\"", command);
+    int status = system(cmd);
+    if (status != 0) {
+        fprintf(stderr, "命令退出代码: %d\n", status);
+        return 0;
+    }
+    return 1;
+#else
+    char* argv[] = { "/bin/sh", "-c", (char*)command, NULL };
+    return run_process(argv, NULL);
+#endif
+}
+
+// 把一行输出追加到string_buffer, 多行之间用空格分隔
+void collect_output_line(const char* line, void* ctx) {
+    struct string_buffer* out = ctx;
+    if (line[0] == '\0') return;
+    if (out->length > 0) string_buffer_append(out, " ", 1);
+    string_buffer_append(out, line, strlen(line));
+}
+
+// 运行命令并收集输出,不在终端显示; 用于查询pkg-config等工具
+int capture_process_output(char* const argv[], struct string_buffer* out) {
+    struct run_options opts = { NULL, false, collect_output_line, out, true, NULL, false, false };
+    string_buffer_append(out, "", 0);
+    return run_process(argv, &opts);
+}
+
+// 配置指纹文件(位于构建目录中)
+#define FINGERPRINT_FILE ".cbuild_fingerprint"
+// 依赖锁文件(位于项目根目录)
+#define LOCK_FILE "CMake.lock"
+
+// 在PATH中查找可执行文件,找到时写入完整路径
+int find_in_path(const char* name, char* out, size_t out_size) {
+    const char* path_env = getenv("PATH");
+    if (!path_env || !*path_env) return 0;
+
+#if defined(PLATFORM_WINDOWS)
+    const char list_sep = ';';
+#else
+    const char list_sep = ':';
+#endif
+    const char* dir = path_env;
+    while (*dir) {
+        const char* end = strchr(dir, list_sep);
+        size_t dir_len = end ? (size_t)(end - dir) : strlen(dir);
+        if (dir_len > 0) {
+            struct stat st;
+            snprintf(out, out_size, "%.*s%c%s%s", (int)dir_len, dir, PATH_SEP, name, EXE_EXT);
+#if defined(PLATFORM_WINDOWS)
+            if (stat(out, &st) == 0 && !(st.st_mode & S_IFDIR)) return 1;
+#else
+            if (stat(out, &st) == 0 && S_ISREG(st.st_mode) && access(out, X_OK) == 0) return 1;
+#endif
+        }
+        if (!end) break;
+        dir = end + 1;
+    }
+    out[0] = '\0';
+    return 0;
+}
+
+// 工具链指纹: 可执行文件的位置、大小和修改时间
+uint64_t hash_tool(uint64_t hash, const char* name) {
+    char tool_path[MAX_PATH_LEN];
+    struct stat st;
+    hash = hash_string(hash, name);
+    if (find_in_path(name, tool_path, sizeof(tool_path)) && stat(tool_path, &st) == 0) {
+        hash = hash_string(hash, tool_path);
+        hash = hash_bytes(hash, &st.st_size, sizeof(st.st_size));
+        hash = hash_bytes(hash, &st.st_mtime, sizeof(st.st_mtime));
+    }
+    return hash;
+}
+
+// 配置的输入: 项目目录dir(NULL表示当前目录)中的CMake.toml、CMakeLists.txt、CMake.lock以及工具链
+uint64_t hash_configure_inputs(uint64_t hash, const char* dir) {
+    static const char* const files[] = { "CMake.toml", "CMakeLists.txt", LOCK_FILE, NULL };
+    static const char* const tools[] = { "cmake", "gcc", "g++", NULL };
+    for (size_t i = 0; files[i]; i++) {
+        char path[MAX_PATH_LEN];
+        if (dir) snprintf(path, sizeof(path), "%s%c%s", dir, PATH_SEP, files[i]);
+        hash = hash_file(hash, dir ? path : files[i]);
+    }
+    for (size_t i = 0; tools[i]; i++) {
+        hash = hash_tool(hash, tools[i]);
+    }
+    return hash;
+}
+
+// 计算配置指纹: CMake.toml、CMakeLists.txt、工具链以及完整的配置命令
+// 需要在项目根目录下调用
+void compute_configure_fingerprint(const char* configure_command, char* out, size_t out_size) {
+    uint64_t hash = hash_configure_inputs(FNV1A_OFFSET, NULL);
+    hash = hash_string(hash, configure_command);
+    snprintf(out, out_size, "%016llx", (unsigned long long)hash);
+}
+
+// 读取构建目录中保存的配置指纹
+int read_configure_fingerprint(const char* path, char* out, size_t out_size) {
+    FILE* file = fopen(path, "r");
+    if (!file) return 0;
+    int ok = fgets(out, (int)out_size, file) != NULL;
+    fclose(file);
+    if (ok) out[strcspn(out, "\r\n")] = '\0';
+    return ok;
+}
+
+int write_configure_fingerprint(const char* path, const char* fingerprint) {
+    FILE* file = fopen(path, "w");
+    if (!file) {
+        perror("写入配置指纹失败");
+        return 0;
+    }
+    fprintf(file, "%s\n", fingerprint);
+    fclose(file);
+    return 1;
+}
+
+// 以TOML基本字符串的形式追加, 转义引号、反斜杠和控制字符
+void string_buffer_append_toml_string(struct string_buffer* out, const char* str) {
+    string_buffer_append(out, "\"", 1);
+    for (const char* c = str; *c; c++) {
+        if (*c == '"' || *c == '\\') {
+            string_buffer_appendf(out, "\\%c", *c);
+        } 
+        else if ((unsigned char)*c < 0x20) {
+            string_buffer_appendf(out, "\\u%04x", (unsigned char)*c);
+        } 
+        else {
+            string_buffer_append(out, c, 1);
+        }
+    }
+    string_buffer_append(out, "\"", 1);
+}
+
+// pkg-config的模块描述,包含版本约束: "fmt >= 9.1"
+const char* dependency_spec(const struct dependency* dep, char* out, size_t out_size) {
+    if (!dep->op) return dep->package;
+    snprintf(out, out_size, "%s %s %s", dep->package, dep->op, dep->version);
+    return out;
+}
+
+// 生成CMake.lock的内容, 依赖项按CMake.toml中的顺序排列
+void format_lock_file(const struct dependency_list* deps, struct string_buffer* out) {
+    string_buffer_appendf(out, "# 由cbuild生成,记录依赖项的解析结果,请提交到版本库,不要手动修改\n");
+    string_buffer_appendf(out, "version = 1\n");
+    for (size_t i = 0; i < deps->count; i++) {
+        const struct dependency* dep = &deps->items[i];
+        string_buffer_appendf(out, "\n[[dependency]]\nname = ");
+        string_buffer_append_toml_string(out, dep->name);
+        string_buffer_appendf(out, "\npackage = ");
+        string_buffer_append_toml_string(out, dep->package);
+        string_buffer_appendf(out, "\nconstraint = \"%s%s\"\nversion = ", dep->op ? dep->op : "", dep->op ? dep->version : "");
+        string_buffer_append_toml_string(out, dep->resolved_version);
+        string_buffer_appendf(out, "\ncflags = \"%016llx\"\nlibs = \"%016llx\"\n",
+                              (unsigned long long)dep->cflags_hash, (unsigned long long)dep->libs_hash);
+    }
+}
+
+// 读取锁文件中某个依赖项的字符串字段
+const char* lock_entry_string(const struct toml_table* entry, const char* key) {
+    const struct toml_value* value = toml_table_get(entry, key);
+    return value && value->type == TOML_STRING ? value->as.string : "";
+}
+
+// 对比旧的CMake.lock和新的解析结果,打印发生变化的依赖项
+void report_lock_changes(const char* old_data, size_t old_length, const struct dependency_list* deps) {
+    char error[BUFFER_SIZE];
+    struct toml_document* old = old_data ? toml_parse(old_data, old_length, error, sizeof(error)) : NULL;
+    const struct toml_value* entries = old ? toml_table_get(old->root, "dependency") : NULL;
+    size_t old_count = entries && entries->type == TOML_ARRAY ? entries->as.array.count : 0;
+
+    for (size_t i = 0; i < deps->count; i++) {
+        const struct dependency* dep = &deps->items[i];
+        const struct toml_table* entry = NULL;
+        for (size_t j = 0; j < old_count && !entry; j++) {
+            const struct toml_value* item = entries->as.array.items[j];
+            if (item->type == TOML_TABLE && !strcmp(lock_entry_string(item->as.table, "name"), dep->name)) {
+                entry = item->as.table;
+            }
+        }
+        if (!entry) {
+            printf("  + %s %s\n", dep->name, dep->resolved_version);
+            continue;
+        }
+        char cflags[32], libs[32];
+        snprintf(cflags, sizeof(cflags), "%016llx", (unsigned long long)dep->cflags_hash);
+        snprintf(libs, sizeof(libs), "%016llx", (unsigned long long)dep->libs_hash);
+        const char* old_version = lock_entry_string(entry, "version");
+        if (strcmp(old_version, dep->resolved_version)) {
+            printf("  ~ %s %s -> %s\n", dep->name, old_version, dep->resolved_version);
+        } 
+        else if (strcmp(lock_entry_string(entry, "cflags"), cflags) || strcmp(lock_entry_string(entry, "libs"), libs)) {
+            printf("  ~ %s %s (编译或链接参数已变化)\n", dep->name, dep->resolved_version);
+        } 
+        else if (strcmp(lock_entry_string(entry, "package"), dep->package)) {
+            printf("  ~ %s 模块名: %s -> %s\n", dep->name, lock_entry_string(entry, "package"), dep->package);
+        }
+        else {
+            char constraint[MAX_PATH_LEN];
+            snprintf(constraint, sizeof(constraint), "%s%s", dep->op ? dep->op : "", dep->op ? dep->version : "");
+            if (strcmp(lock_entry_string(entry, "constraint"), constraint)) {
+                printf("  ~ %s 版本约束: \"%s\" -> \"%s\"\n", dep->name, lock_entry_string(entry, "constraint"), constraint);
+            }
+        }
+    }
+    for (size_t j = 0; j < old_count; j++) {
+        const struct toml_value* item = entries->as.array.items[j];
+        if (item->type != TOML_TABLE) continue;
+        const char* name = lock_entry_string(item->as.table, "name");
+        bool present = false;
+        for (size_t i = 0; i < deps->count && !present; i++) {
+            present = !strcmp(deps->items[i].name, name);
+        }
+        if (!present) printf("  - %s %s\n", name, lock_entry_string(item->as.table, "version"));
+    }
+    toml_free(old);
+}
+
+// 依赖项解析缓存(位于构建目录中), 命中时不再运行pkg-config
+#define DEPS_CACHE_FILE "cbuild_deps.cache"
+// 由解析结果生成的IMPORTED目标定义(位于构建目录中), 通过CBUILD_DEPS_FILE传给CMake
+#define DEPS_CMAKE_FILE "cbuild_deps.cmake"
+// 同时运行的pkg-config进程数上限
+#define DEPS_MAX_QUERIES 32
+
+// 依赖项缓存键的公共部分: pkg-config本身、相关环境变量以及各搜索目录的修改时间
+// (安装、升级或删除.pc文件时目录的修改时间随之变化)
+uint64_t pkg_config_environment_hash(const struct string_list* dirs) {
+    static const char* const env_names[] = { "PKG_CONFIG_SYSROOT_DIR", "PKG_CONFIG_ALLOW_SYSTEM_CFLAGS", "PKG_CONFIG_ALLOW_SYSTEM_LIBS" };
+    uint64_t hash = hash_tool(FNV1A_OFFSET, "pkg-config");
+    for (size_t i = 0; i < sizeof(env_names) / sizeof(env_names[0]); i++) {
+        const char* value = getenv(env_names[i]);
+        hash = hash_string(hash, value ? value : "");
+    }
+    for (size_t i = 0; i < dirs->count; i++) {
+        struct stat st;
+        hash = hash_string(hash, dirs->items[i]);
+        if (stat(dirs->items[i], &st) == 0) {
+            hash = hash_bytes(hash, &st.st_mtime, sizeof(st.st_mtime));
+        }
+    }
+    return hash;
+}
+
+// 依赖项的缓存键: 模块描述以及按搜索顺序找到的第一个.pc文件的大小和修改时间
+uint64_t dependency_cache_key(const struct dependency* dep, uint64_t env_hash, const struct string_list* dirs) {
+    char spec[MAX_PATH_LEN];
+    uint64_t hash = hash_string(env_hash, dependency_spec(dep, spec, sizeof(spec)));
+    for (size_t i = 0; i < dirs->count; i++) {
+        char pc_path[MAX_PATH_LEN];
+        struct stat st;
+        snprintf(pc_path, sizeof(pc_path), "%s%c%s.pc", dirs->items[i], PATH_SEP, dep->package);
+        if (stat(pc_path, &st) == 0) {
+            hash = hash_string(hash, pc_path);
+            hash = hash_bytes(hash, &st.st_size, sizeof(st.st_size));
+            hash = hash_bytes(hash, &st.st_mtime, sizeof(st.st_mtime));
+            break;
+        }
+    }
+    return hash;
+}
+
+// 一次pkg-config查询
+struct pkg_config_query {
+    char* argv[4];
+    struct string_buffer output;
+    struct run_options opts;
+    struct child_process child;
+    bool spawned;
+    bool ok;
+};
+
+// 并行运行查询,最多同时运行DEPS_MAX_QUERIES个进程,按启动顺序等待;
+// pkg-config的输出远小于管道缓冲区,子进程不会因为尚未读取输出而阻塞
+void run_pkg_config_queries(struct pkg_config_query* queries, size_t count) {
+    size_t spawned = 0;
+    for (size_t done = 0; done < count; done++) {
+        while (spawned < count && spawned - done < DEPS_MAX_QUERIES) {
+            struct pkg_config_query* query = &queries[spawned++];
+            query->opts = (struct run_options){ NULL, false, collect_output_line, &query->output, true, NULL, false, false };
+            string_buffer_append(&query->output, "", 0);
+            query->spawned = spawn_process(query->argv, &query->opts, &query->child);
+        }
+        struct pkg_config_query* query = &queries[done];
+        query->ok = query->spawned && wait_process(&query->child, query->argv, &query->opts);
+    }
+}
+
+// 生成解析缓存的内容, 只记录解析成功的依赖项
+void format_dependency_cache(const struct dependency_list* deps, const char* tool_hash, const char* default_path,
+                             const uint64_t* keys, struct string_buffer* out) {
+    string_buffer_appendf(out, "# 由cbuild生成的依赖项解析缓存,可以随时删除\nversion = 1\ntool = \"%s\"\npc_path = ", tool_hash);
+    string_buffer_append_toml_string(out, default_path);
+    string_buffer_append(out, "\n", 1);
+    for (size_t i = 0; i < deps->count; i++) {
+        const struct dependency* dep = &deps->items[i];
+        if (!dep->resolved || !uses_pkg_config(dep)) continue;
+        string_buffer_appendf(out, "\n[[dependency]]\nkey = \"%016llx\"\nname = ", (unsigned long long)keys[i]);
+        string_buffer_append_toml_string(out, dep->name);
+        string_buffer_appendf(out, "\nversion = ");
+        string_buffer_append_toml_string(out, dep->resolved_version);
+        string_buffer_appendf(out, "\ncflags = ");
+        string_buffer_append_toml_string(out, dep->cflags);
+        string_buffer_appendf(out, "\nlibs = ");
+        string_buffer_append_toml_string(out, dep->libs);
+        string_buffer_append(out, "\n", 1);
+    }
+}
+
+// 在解析缓存中查找缓存键对应的条目
+const struct toml_table* find_cached_dependency(const struct toml_document* cache, uint64_t key) {
+    const struct toml_value* entries = cache ? toml_table_get(cache->root, "dependency") : NULL;
+    if (!entries || entries->type != TOML_ARRAY) return NULL;
+    char key_text[32];
+    snprintf(key_text, sizeof(key_text), "%016llx", (unsigned long long)key);
+    for (size_t i = 0; i < entries->as.array.count; i++) {
+        const struct toml_value* item = entries->as.array.items[i];
+        if (item->type != TOML_TABLE) continue;
+        const struct toml_value* value = toml_table_get(item->as.table, "key");
+        if (value && value->type == TOML_STRING && !strcmp(value->as.string, key_text)) return item->as.table;
+    }
+    return NULL;
+}
+
+// 按数字逐段比较版本号: 1.10 > 1.9
+int compare_versions(const char* a, const char* b) {
+    while (*a && *b) {
+        if (isdigit((unsigned char)*a) && isdigit((unsigned char)*b)) {
+            char* end_a;
+            char* end_b;
+            unsigned long long x = strtoull(a, &end_a, 10);
+            unsigned long long y = strtoull(b, &end_b, 10);
+            if (x != y) return x < y ? -1 : 1;
+            a = end_a;
+            b = end_b;
+        } 
+        else {
+            if (*a != *b) return (unsigned char)*a < (unsigned char)*b ? -1 : 1;
+            a++;
+            b++;
+        }
+    }
+    return *a ? 1 : *b ? -1 : 0;
+}
+
+bool version_satisfies(const char* version, const char* op, const char* required) {
+    if (!op) return true;
+    int result = compare_versions(version, required);
+    if (!strcmp(op, ">=")) return result >= 0;
+    if (!strcmp(op, "<=")) return result <= 0;
+    if (!strcmp(op, ">")) return result > 0;
+    if (!strcmp(op, "<")) return result < 0;
+    return result == 0;
+}
+
+// 配置包的版本文件: <包名>ConfigVersion.cmake 或 <包名>-config-version.cmake
+void cmake_version_file(const char* config_path, char* out, size_t out_size) {
+    size_t length = strlen(config_path);
+    if (length > 13 && !strcmp(config_path + length - 13, "-config.cmake")) {
+        snprintf(out, out_size, "%.*s-config-version.cmake", (int)(length - 13), config_path);
+    } 
+    else {
+        snprintf(out, out_size, "%.*sConfigVersion.cmake", (int)(length > 12 ? length - 12 : 0), config_path);
+    }
+}
+
+// CONFIG模式的依赖项不经过pkg-config: 版本从配置包的版本文件读取并检查版本约束,
+// 参数哈希取配置文件和版本文件的内容
+int resolve_cmake_dependency(struct dependency* dep, struct arena* arena) {
+    if (!dep->cmake_config) {
+        printf("警告: 未找到依赖项 %s 的CMake配置包 %s\n", dep->name, dep->cmake_package);
+        return 0;
+    }
+    char version_path[MAX_PATH_LEN];
+    cmake_version_file(dep->cmake_config, version_path, sizeof(version_path));
+    // set(PACKAGE_VERSION "1.12.1") 或 set(PACKAGE_VERSION 1.74.0), 跳过引用变量的赋值
+    char* data = read_file_contents(version_path, NULL);
+    const char* start = NULL;
+    for (const char* p = data ? strstr(data, "set(PACKAGE_VERSION ") : NULL; p && !start; p = strstr(p + 1, "set(PACKAGE_VERSION ")) {
+        p += strlen("set(PACKAGE_VERSION ");
+        if (*p == '"') p++;
+        if (isdigit((unsigned char)*p)) start = p;
+    }
+    char version[128] = "unknown";
+    if (start) {
+        snprintf(version, sizeof(version), "%.*s", (int)strcspn(start, "\" )"), start);
+    }
+    free(data);
+    // 没有版本文件时交给find_package检查
+    if (start && !version_satisfies(version, dep->op, dep->version)) {
+        printf("警告: 依赖项 %s 的CMake配置包版本 %s 不满足要求 %s %s\n", dep->name, version, dep->op, dep->version);
+        return 0;
+    }
+    dep->resolved = true;
+    dep->resolved_version = arena_strdup(arena, version);
+    dep->cflags = dep->libs = "";
+    dep->cflags_hash = hash_file_contents(dep->cmake_config);
+    dep->libs_hash = hash_file_contents(version_path);
+    return 1;
+}
+
+// 工作区成员在展开路径依赖时已读取版本, 参数哈希取成员的CMake.toml
+int resolve_path_dependency(struct dependency* dep) {
+    if (!dep->resolved_version) {
+        printf("警告: 未找到依赖项 %s 的工作区成员 %s\n", dep->name, dep->path);
+        return 0;
+    }
+    if (!version_satisfies(dep->resolved_version, dep->op, dep->version)) {
+        printf("警告: 工作区成员 %s 的版本 %s 不满足要求 %s %s\n", dep->name, dep->resolved_version, dep->op, dep->version);
+        return 0;
+    }
+    char toml_path[MAX_PATH_LEN];
+    snprintf(toml_path, sizeof(toml_path), "%s%cCMake.toml", dep->path, PATH_SEP);
+    dep->resolved = true;
+    dep->cflags = dep->libs = "";
+    dep->cflags_hash = hash_file_contents(toml_path);
+    dep->libs_hash = 0;
+    return 1;
+}
+
+// .pc文件的搜索目录, 顺序与pkg-config相同: PKG_CONFIG_PATH, 然后是PKG_CONFIG_LIBDIR或默认目录
+// pkg-config内置的默认目录随pkg-config本身一起缓存在cache中, 缓存失效时查询pkg-config
+void pkg_config_search_dirs(const struct toml_document* cache, char* tool_hash, size_t tool_hash_size,
+                            struct string_buffer* default_path, struct string_list* dirs) {
+    snprintf(tool_hash, tool_hash_size, "%016llx", (unsigned long long)hash_tool(FNV1A_OFFSET, "pkg-config"));
+    string_buffer_append(default_path, "", 0);
+    const struct toml_value* cached_tool = cache ? toml_table_get(cache->root, "tool") : NULL;
+    const struct toml_value* cached_path = cache ? toml_table_get(cache->root, "pc_path") : NULL;
+    if (cached_tool && cached_tool->type == TOML_STRING && !strcmp(cached_tool->as.string, tool_hash) &&
+        cached_path && cached_path->type == TOML_STRING) {
+        string_buffer_append(default_path, cached_path->as.string, strlen(cached_path->as.string));
+    } 
+    else {
+        char* path_argv[] = { "pkg-config", "--variable", "pc_path", "pkg-config", NULL };
+        if (!capture_process_output(path_argv, default_path)) {
+            default_path->length = 0;
+            default_path->data[0] = '\0';
+        }
+    }
+    const char* libdir = getenv("PKG_CONFIG_LIBDIR");
+    split_path_list(getenv("PKG_CONFIG_PATH"), dirs);
+    split_path_list(libdir ? libdir : default_path->data, dirs);
+}
+
+// 全部pkg-config依赖项的缓存键(与cache_dir中的解析缓存一致), 没有pkg-config依赖项时返回0
+uint64_t pkg_config_dependencies_key(const struct dependency_list* deps, const char* cache_dir) {
+    size_t count = 0;
+    for (size_t i = 0; i < deps->count; i++) {
+        if (uses_pkg_config(&deps->items[i])) count++;
+    }
+    if (count == 0) return 0;
+
+    char cache_path[MAX_PATH_LEN];
+    char error[BUFFER_SIZE];
+    snprintf(cache_path, sizeof(cache_path), "%s%c%s", cache_dir, PATH_SEP, DEPS_CACHE_FILE);
+    struct toml_document* cache = toml_parse_file(cache_path, error, sizeof(error), NULL);
+    char tool_hash[32];
+    struct string_buffer default_path = {0};
+    struct string_list dirs = {0};
+    pkg_config_search_dirs(cache, tool_hash, sizeof(tool_hash), &default_path, &dirs);
+    uint64_t env_hash = pkg_config_environment_hash(&dirs);
+    uint64_t hash = env_hash;
+    for (size_t i = 0; i < deps->count; i++) {
+        if (!uses_pkg_config(&deps->items[i])) continue;
+        uint64_t key = dependency_cache_key(&deps->items[i], env_hash, &dirs);
+        hash = hash_bytes(hash, &key, sizeof(key));
+    }
+    string_list_free(&dirs);
+    string_buffer_free(&default_path);
+    toml_free(cache);
+    return hash;
+}
+
+// 解析全部依赖项: 缓存键未变化的直接使用cache_dir中缓存的结果,
+// 其余依赖项的pkg-config查询(版本、编译参数、链接参数)并行运行; cache_dir为NULL时不使用缓存
+// 返回是否全部解析成功
+int resolve_dependencies(struct dependency_list* deps, const char* cache_dir) {
+    int unresolved = 0;
+    size_t pkg_config_count = 0;
+    for (size_t i = 0; i < deps->count; i++) {
+        struct dependency* dep = &deps->items[i];
+        if (uses_pkg_config(dep)) {
+            pkg_config_count++;
+        }
+        else if (!(dep->path ? resolve_path_dependency(dep) : resolve_cmake_dependency(dep, &deps->arena))) {
+            unresolved++;
+        }
+    }
+    if (pkg_config_count == 0) return unresolved == 0;
+
+    char pkg_config[MAX_PATH_LEN];
+    if (!find_in_path("pkg-config", pkg_config, sizeof(pkg_config))) {
+        printf("警告: 未找到pkg-config,无法解析依赖项版本\n");
+        return 0;
+    }
+    char cache_path[MAX_PATH_LEN] = "";
+    char error[BUFFER_SIZE];
+    struct toml_document* cache = NULL;
+    if (cache_dir) {
+        snprintf(cache_path, sizeof(cache_path), "%s%c%s", cache_dir, PATH_SEP, DEPS_CACHE_FILE);
+        cache = toml_parse_file(cache_path, error, sizeof(error), NULL);
+    }
+
+    char tool_hash[32];
+    struct string_buffer default_path = {0};
+    struct string_list dirs = {0};
+    pkg_config_search_dirs(cache, tool_hash, sizeof(tool_hash), &default_path, &dirs);
+    uint64_t env_hash = pkg_config_environment_hash(&dirs);
+
+    uint64_t* keys = calloc(deps->count + 1, sizeof(*keys));
+    struct pkg_config_query* queries = calloc(deps->count * 3 + 1, sizeof(*queries));
+    size_t* first_query = calloc(deps->count + 1, sizeof(*first_query));
+    if (!keys || !queries || !first_query) {
+        fprintf(stderr, "内存不足\n");
+        free(keys);
+        free(queries);
+        free(first_query);
+        string_list_free(&dirs);
+        string_buffer_free(&default_path);
+        toml_free(cache);
+        return 0;
+    }
+    size_t query_count = 0;
+    size_t cached_count = 0;
+    for (size_t i = 0; i < deps->count; i++) {
+        struct dependency* dep = &deps->items[i];
+        if (!uses_pkg_config(dep)) continue;
+        keys[i] = dependency_cache_key(dep, env_hash, &dirs);
+        const struct toml_table* entry = find_cached_dependency(cache, keys[i]);
+        if (entry) {
+            dep->resolved = dep->cached = true;
+            dep->resolved_version = arena_strdup(&deps->arena, lock_entry_string(entry, "version"));
+            dep->cflags = arena_strdup(&deps->arena, lock_entry_string(entry, "cflags"));
+            dep->libs = arena_strdup(&deps->arena, lock_entry_string(entry, "libs"));
+            cached_count++;
+            continue;
+        }
+        // 版本查询带上约束,不满足约束时pkg-config失败
+        char spec[MAX_PATH_LEN];
+        char* module = arena_strdup(&deps->arena, dependency_spec(dep, spec, sizeof(spec)));
+        first_query[i] = query_count;
+        queries[query_count++] = (struct pkg_config_query){ .argv = { "pkg-config", "--modversion", module, NULL } };
+        queries[query_count++] = (struct pkg_config_query){ .argv = { "pkg-config", "--cflags", (char*)dep->package, NULL } };
+        queries[query_count++] = (struct pkg_config_query){ .argv = { "pkg-config", "--libs", (char*)dep->package, NULL } };
+    }
+
+    int64_t start_us = now_us();
+    run_pkg_config_queries(queries, query_count);
+    for (size_t i = 0; i < deps->count; i++) {
+        struct dependency* dep = &deps->items[i];
+        if (!uses_pkg_config(dep)) continue;
+        if (!dep->cached) {
+            struct pkg_config_query* query = &queries[first_query[i]];
+            dep->resolved = query[0].ok && query[1].ok && query[2].ok;
+            if (dep->resolved) {
+                dep->resolved_version = arena_strdup(&deps->arena, query[0].output.data);
+                dep->cflags = arena_strdup(&deps->arena, query[1].output.data);
+                dep->libs = arena_strdup(&deps->arena, query[2].output.data);
+            }
+            else {
+                char spec[MAX_PATH_LEN];
+                printf("警告: pkg-config未找到满足要求的依赖项 %s (%s)\n", dep->name, dependency_spec(dep, spec, sizeof(spec)));
+                unresolved++;
+            }
+        }
+        if (dep->resolved) {
+            dep->cflags_hash = hash_string(FNV1A_OFFSET, dep->cflags);
+            dep->libs_hash = hash_string(FNV1A_OFFSET, dep->libs);
+        }
+    }
+    if (query_count > 0) {
+        printf("pkg-config解析了 %zu 个依赖项(%zu 个命中缓存), 耗时 %.1f ms\n",
+               pkg_config_count - cached_count, cached_count, (now_us() - start_us) / 1000.0);
+    }
+    for (size_t i = 0; i < query_count; i++) {
+        string_buffer_free(&queries[i].output);
+    }
+
+    if (cache_dir && (query_count > 0 || !cache)) {
+        struct string_buffer content = {0};
+        format_dependency_cache(deps, tool_hash, default_path.data, keys, &content);
+        struct stat st;
+        if (stat(cache_dir, &st) == 0 || create_directory(cache_dir)) {
+            write_file_if_changed(cache_path, content.data, content.length);
+        }
+        string_buffer_free(&content);
+    }
+    free(keys);
+    free(queries);
+    free(first_query);
+    string_list_free(&dirs);
+    string_buffer_free(&default_path);
+    toml_free(cache);
+    return unresolved == 0;
+}
+
+// 按空白拆分pkg-config输出的参数, 反斜杠转义其后的字符(例如路径中的空格)
+void split_flags(const char* flags, struct string_list* out) {
+    struct string_buffer token = {0};
+    string_buffer_append(&token, "", 0);
+    for (const char* c = flags; ; c++) {
+        if (*c == '\0' || isspace((unsigned char)*c)) {
+            if (token.length > 0) {
+                string_list_push(out, token.data);
+                token.length = 0;
+                token.data[0] = '\0';
+            }
+            if (*c == '\0') break;
+            continue;
+        }
+        if (*c == '\\' && c[1] != '\0') c++;
+        string_buffer_append(&token, c, 1);
+    }
+    string_buffer_free(&token);
+}
+
+// 以CMake带引号参数的形式追加列表, 元素中的分号等特殊字符加反斜杠转义
+void string_buffer_append_cmake_list(struct string_buffer* out, const struct string_list* items) {
+    string_buffer_append(out, "\"", 1);
+    for (size_t i = 0; i < items->count; i++) {
+        if (i > 0) string_buffer_append(out, ";", 1);
+        for (const char* c = items->items[i]; *c; c++) {
+            if (strchr("\\\"$;", *c)) string_buffer_append(out, "\\", 1);
+            string_buffer_append(out, c, 1);
+        }
+    }
+    string_buffer_append(out, "\"", 1);
+}
+
+// 把一个依赖项的解析结果写成IMPORTED目标, 目标名与pkg_check_modules(IMPORTED_TARGET)相同,
+// CMakeLists.txt在两种方式下都链接PkgConfig::<name>
+void format_dependency_target(const struct dependency* dep, struct string_buffer* out) {
+    enum { INCLUDE_DIRS, COMPILE_OPTIONS, LINK_DIRS, LINK_LIBRARIES, PROPERTY_COUNT };
+    static const char* const property_names[PROPERTY_COUNT] = {
+        "INTERFACE_INCLUDE_DIRECTORIES", "INTERFACE_COMPILE_OPTIONS", "INTERFACE_LINK_DIRECTORIES",
+        "INTERFACE_LINK_LIBRARIES"
+    };
+    struct string_list properties[PROPERTY_COUNT] = {0};
+    struct string_list cflags = {0};
+    struct string_list libs = {0};
+    split_flags(dep->cflags, &cflags);
+    split_flags(dep->libs, &libs);
+
+    // -I和-isystem后的目录可以与选项分开写
+    for (size_t i = 0; i < cflags.count; i++) {
+        const char* flag = cflags.items[i];
+        if (!strncmp(flag, "-I", 2)) {
+            const char* dir = flag[2] ? flag + 2 : cflags.items[i + 1] ? cflags.items[++i] : "";
+            if (dir[0]) string_list_push(&properties[INCLUDE_DIRS], dir);
+        } 
+        else if (!strcmp(flag, "-isystem") && cflags.items[i + 1]) {
+            string_list_push(&properties[INCLUDE_DIRS], cflags.items[++i]);
+        }
+        else {
+            string_list_push(&properties[COMPILE_OPTIONS], flag);
+        }
+    }
+    // 除-L外的链接参数按原顺序放入INTERFACE_LINK_LIBRARIES,
+    // -Wl,--push-state ... -Wl,--pop-state、-Wl,--whole-archive ... 等成对的选项依赖相对顺序
+    for (size_t i = 0; i < libs.count; i++) {
+        const char* flag = libs.items[i];
+        if (!strncmp(flag, "-L", 2)) {
+            const char* dir = flag[2] ? flag + 2 : libs.items[i + 1] ? libs.items[++i] : "";
+            if (dir[0]) string_list_push(&properties[LINK_DIRS], dir);
+        } 
+        else if (!strncmp(flag, "-l", 2) && flag[2]) {
+            string_list_push(&properties[LINK_LIBRARIES], flag + 2);
+        }
+        else if (!strcmp(flag, "-framework") && libs.items[i + 1]) {
+            string_list_pushf(&properties[LINK_LIBRARIES], "-framework %s", libs.items[++i]);
+        }
+        else {
+            // 库文件的完整路径或链接器选项
+            string_list_push(&properties[LINK_LIBRARIES], flag);
+        }
+    }
+
+    string_buffer_appendf(out, "\n# %s %s\nif(NOT TARGET PkgConfig::%s)\n    add_library(PkgConfig::%s INTERFACE IMPORTED)\n",
+                          dep->package, dep->resolved_version, dep->name, dep->name);
+    bool has_properties = false;
+    for (int p = 0; p < PROPERTY_COUNT; p++) {
+        if (properties[p].count == 0) continue;
+        if (!has_properties) string_buffer_appendf(out, "    set_target_properties(PkgConfig::%s PROPERTIES", dep->name);
+        has_properties = true;
+        string_buffer_appendf(out, "\n        %s ", property_names[p]);
+        string_buffer_append_cmake_list(out, &properties[p]);
+    }
+    if (has_properties) string_buffer_append(out, ")\n", 2);
+    string_buffer_appendf(out, "endif()\nset(%s_FOUND TRUE)\nset(%s_VERSION \"%s\")\n", dep->name, dep->name, dep->resolved_version);
+
+    for (int p = 0; p < PROPERTY_COUNT; p++) {
+        string_list_free(&properties[p]);
+    }
+    string_list_free(&cflags);
+    string_list_free(&libs);
+}
+
+// 在构建目录中生成依赖项的IMPORTED目标定义, 内容不变时不写入;
+// 有通过pkg-config查找的依赖项未解析时删除旧文件, CMakeLists.txt回退到pkg_check_modules并由CMake报告错误
+int write_dependency_targets(const struct dependency_list* deps, const char* build_dir) {
+    char path[MAX_PATH_LEN];
+    snprintf(path, sizeof(path), "%s%c%s", build_dir, PATH_SEP, DEPS_CMAKE_FILE);
+    for (size_t i = 0; i < deps->count; i++) {
+        if (!deps->items[i].resolved && uses_pkg_config(&deps->items[i])) {
+            remove(path);
+            return 0;
+        }
+    }
+    struct stat st;
+    if (stat(build_dir, &st) != 0 && !create_directory(build_dir)) return 0;
+
+    struct string_buffer content = {0};
+    string_buffer_appendf(&content, "# 由cbuild根据pkg-config的解析结果生成,不要手动修改\n");
+    for (size_t i = 0; i < deps->count; i++) {
+        if (uses_pkg_config(&deps->items[i])) format_dependency_target(&deps->items[i], &content);
+    }
+    int ok = write_file_if_changed(path, content.data, content.length);
+    string_buffer_free(&content);
+    return ok;
+}
+
+// 解析依赖项并更新CMake.lock(需在项目根目录调用), 解析缓存位于cache_dir中;
+// locked为true时不修改CMake.lock,解析结果与之不一致时失败
+int update_lock_file(struct dependency_list* deps, bool locked, const char* cache_dir) {
+    size_t old_length = 0;
+    char* old_data = read_file_contents(LOCK_FILE, &old_length);
+    if (deps->count == 0 && !old_data) {
+        if (locked) fprintf(stderr, "错误: 未找到%s\n", LOCK_FILE);
+        return !locked;
+    }
+    if (!resolve_dependencies(deps, cache_dir)) {
+        free(old_data);
+        if (locked) {
+            fprintf(stderr, "错误: 依赖项解析失败,无法与%s比较(--locked)\n", LOCK_FILE);
+            return 0;
+        }
+        printf("警告: 未更新%s\n", LOCK_FILE);
+        return 1;
+    }
+
+    struct string_buffer content = {0};
+    format_lock_file(deps, &content);
+    if (old_data && old_length == content.length && !memcmp(old_data, content.data, old_length)) {
+        free(old_data);
+        string_buffer_free(&content);
+        return 1;
+    }
+    if (locked) {
+        if (old_data) {
+            fprintf(stderr, "错误: 依赖项解析结果与%s不一致(--locked):\n", LOCK_FILE);
+            fflush(stderr);
+            report_lock_changes(old_data, old_length, deps);
+        } 
+        else {
+            fprintf(stderr, "错误: 未找到%s(--locked)\n", LOCK_FILE);
+        }
+        free(old_data);
+        string_buffer_free(&content);
+        return 0;
+    }
+
+    printf("%s%s:\n", old_data ? "更新" : "创建", LOCK_FILE);
+    report_lock_changes(old_data, old_length, deps);
+    free(old_data);
+    FILE* file = fopen(LOCK_FILE, "wb");
+    if (!file || fwrite(content.data, 1, content.length, file) != content.length) {
+        perror("写入" LOCK_FILE "失败");
+        if (file) fclose(file);
+        string_buffer_free(&content);
+        return 0;
+    }
+    fclose(file);
+    string_buffer_free(&content);
+    return 1;
+}
+
+// 从CMakeCache.txt读取一个缓存变量的值,例如 CMAKE_GENERATOR
+int read_cmake_cache_value(const char* cache_path, const char* key, char* out, size_t out_size) {
+    FILE* cache_file = fopen(cache_path, "r");
+    if (!cache_file) return 0;
+
+    char line[BUFFER_SIZE];
+    size_t key_len = strlen(key);
+    int found = 0;
+    while (fgets(line, sizeof(line), cache_file)) {
+        // 格式: KEY:TYPE=VALUE
+        if (strncmp(line, key, key_len) != 0 || line[key_len] != ':') continue;
+        char* value = strchr(line, '=');
+        if (!value) continue;
+        value++;
+        value[strcspn(value, "\r\n")] = '\0';
+        snprintf(out, out_size, "%s", value);
+        found = 1;
+        break;
+    }
+    fclose(cache_file);
+    return found;
+}
+
+// 读取缓存中记录的生成器,额外生成器记录为 "CodeBlocks - Unix Makefiles" 的形式
+int read_cached_generator(const char* cache_path, char* out, size_t out_size) {
+    char generator[64] = "";
+    char extra_generator[64] = "";
+    if (!read_cmake_cache_value(cache_path, "CMAKE_GENERATOR", generator, sizeof(generator)) || generator[0] == '\0') {
+        return 0;
+    }
+    read_cmake_cache_value(cache_path, "CMAKE_EXTRA_GENERATOR", extra_generator, sizeof(extra_generator));
+    if (extra_generator[0] != '\0') {
+        snprintf(out, out_size, "%s - %s", extra_generator, generator);
+    } 
+    else {
+        snprintf(out, out_size, "%s", generator);
+    }
+    return 1;
+}
+
+// 选择CMake生成器: CMake.toml中的设置 > 已有缓存中记录的生成器 > ninja > 平台默认
+void select_generator(const struct build_options* opts, const char* cache_path, char* out, size_t out_size) {
+    if (!strcmp(opts->layout, LAYOUT_MULTI_CONFIG)) {
+        snprintf(out, out_size, "Ninja Multi-Config");
+        return;
+    }
+    if (opts->generator[0] != '\0') {
+        snprintf(out, out_size, "%s", opts->generator);
+        return;
+    }
+    // 沿用已记录的生成器,避免ninja安装或卸载后触发生成器不匹配
+    if (read_cached_generator(cache_path, out, out_size)) {
+        return;
+    }
+    char ninja_path[MAX_PATH_LEN];
+    if (find_in_path("ninja", ninja_path, sizeof(ninja_path))) {
+        snprintf(out, out_size, "Ninja");
+        return;
+    }
+#if defined(PLATFORM_WINDOWS)
+    snprintf(out, out_size, "MinGW Makefiles");
+#else
+    snprintf(out, out_size, "Unix Makefiles");
+#endif
+}
+
+// 解析编译器缓存工具,找到时写入完整路径,auto优先使用ccache
+int resolve_compiler_cache(const struct build_options* opts, char* out, size_t out_size) {
+    out[0] = '\0';
+    if (!strcmp(opts->cache, "none")) return 0;
+    if (!strcmp(opts->cache, "auto")) {
+        return find_in_path("ccache", out, out_size) || find_in_path("sccache", out, out_size);
+    }
+    if (!find_in_path(opts->cache, out, out_size)) {
+        printf("警告: 未在PATH中找到编译器缓存 %s,不使用编译器缓存\n", opts->cache);
+        return 0;
+    }
+    return 1;
+}
+
+#if !defined(PLATFORM_WINDOWS)
+// 并行递归删除: 每个目录是一个任务,扫描时直接删除文件并把子目录加入任务栈;
+// 目录的pending计数归零(所有子目录已删除)时删除该目录并通知父目录
+struct delete_node {
+    char* path;                  // 相对于根目录的路径
+    struct delete_node* parent;
+    int pending;                 // 未删除的子目录数 + 1(自身的扫描)
+    struct delete_node* next;
+};
+
+struct delete_tree {
+    int root_fd;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    struct delete_node* stack;   // 待扫描的目录(后进先出,深度优先以减少内存占用)
+    bool done;
+    size_t files;
+    size_t dirs;
+    int errors;
+};
+
+void delete_report_error(struct delete_tree* tree, const char* action, const char* path) {
+    if (errno == ENOENT) return;  // 已被其他进程删除
+    pthread_mutex_lock(&tree->lock);
+    if (tree->errors++ < 10) {
+        fprintf(stderr, "%s失败: %s: %s\n", action, path, strerror(errno));
+    }
+    pthread_mutex_unlock(&tree->lock);
+}
+
+// 完成一次扫描或一个子目录的删除,沿父目录链向上删除已清空的目录
+void delete_node_release(struct delete_tree* tree, struct delete_node* node) {
+    pthread_mutex_lock(&tree->lock);
+    while (--node->pending == 0) {
+        struct delete_node* parent = node->parent;
+        pthread_mutex_unlock(&tree->lock);
+        if (!parent) {
+            // 根目录本身保留
+            free(node->path);
+            free(node);
+            pthread_mutex_lock(&tree->lock);
+            tree->done = true;
+            pthread_cond_broadcast(&tree->cond);
+            break;
+        }
+        bool removed = unlinkat(tree->root_fd, node->path, AT_REMOVEDIR) == 0;
+        if (!removed) delete_report_error(tree, "删除目录", node->path);
+        free(node->path);
+        free(node);
+        pthread_mutex_lock(&tree->lock);
+        if (removed) tree->dirs++;
+        node = parent;
+    }
+    pthread_mutex_unlock(&tree->lock);
+}
+
+void delete_push_dir(struct delete_tree* tree, struct delete_node* parent, const char* name) {
+    struct delete_node* child = calloc(1, sizeof(*child));
+    size_t len = strlen(parent->path) + strlen(name) + 2;
+    if (child) child->path = malloc(len);
+    if (!child || !child->path) {
+        free(child);
+        errno = ENOMEM;
+        delete_report_error(tree, "删除目录", name);
+        return;
+    }
+    if (!strcmp(parent->path, ".")) snprintf(child->path, len, "%s", name);
+    else snprintf(child->path, len, "%s/%s", parent->path, name);
+    child->parent = parent;
+    child->pending = 1;
+
+    pthread_mutex_lock(&tree->lock);
+    parent->pending++;
+    child->next = tree->stack;
+    tree->stack = child;
+    pthread_cond_signal(&tree->cond);
+    pthread_mutex_unlock(&tree->lock);
+}
+
+// 删除目录中的一项: 子目录加入任务栈,其余直接unlinkat
+void delete_entry(struct delete_tree* tree, struct delete_node* node, int dir_fd, const char* name, unsigned char type, size_t* files) {
+    if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) return;
+    if (type == DT_UNKNOWN) {
+        struct stat st;
+        if (fstatat(dir_fd, name, &st, AT_SYMLINK_NOFOLLOW) != 0) return;
+        type = S_ISDIR(st.st_mode) ? DT_DIR : DT_REG;
+    }
+    if (type == DT_DIR) {
+        delete_push_dir(tree, node, name);
+    } 
+    else if (unlinkat(dir_fd, name, 0) == 0) {
+        (*files)++;
+    } 
+    else {
+        delete_report_error(tree, "删除文件", name);
+    }
+}
+
+void delete_scan_dir(struct delete_tree* tree, struct delete_node* node) {
+    size_t files = 0;
+    int dir_fd = openat(tree->root_fd, node->path, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+    if (dir_fd < 0) {
+        delete_report_error(tree, "打开目录", node->path);
+    } 
+    else {
+#if defined(PLATFORM_LINUX)
+        // getdents64一次读取大量目录项,避免readdir的逐项开销
+        char buffer[32 * 1024];
+        for (;;) {
+            long n = syscall(SYS_getdents64, dir_fd, buffer, sizeof(buffer));
+            if (n <= 0) break;
+            for (long offset = 0; offset < n;) {
+                struct linux_dirent64 {
+                    uint64_t d_ino;
+                    int64_t d_off;
+                    unsigned short d_reclen;
+                    unsigned char d_type;
+                    char d_name[];
+                }* entry = (void*)(buffer + offset);
+                delete_entry(tree, node, dir_fd, entry->d_name, entry->d_type, &files);
+                offset += entry->d_reclen;
+            }
+        }
+        close(dir_fd);
+#else
+        DIR* dir = fdopendir(dir_fd);
+        if (dir) {
+            struct dirent* entry;
+            while ((entry = readdir(dir)) != NULL) {
+                delete_entry(tree, node, dirfd(dir), entry->d_name, entry->d_type, &files);
+            }
+            closedir(dir);
+        } 
+        else {
+            close(dir_fd);
+        }
+#endif
+    }
+    pthread_mutex_lock(&tree->lock);
+    tree->files += files;
+    pthread_mutex_unlock(&tree->lock);
+    delete_node_release(tree, node);
+}
+
+void* delete_worker(void* arg) {
+    struct delete_tree* tree = arg;
+    for (;;) {
+        pthread_mutex_lock(&tree->lock);
+        while (!tree->stack && !tree->done) {
+            pthread_cond_wait(&tree->cond, &tree->lock);
+        }
+        if (!tree->stack) {
+            pthread_mutex_unlock(&tree->lock);
+            return NULL;
+        }
+        struct delete_node* node = tree->stack;
+        tree->stack = node->next;
+        pthread_mutex_unlock(&tree->lock);
+        delete_scan_dir(tree, node);
+    }
+}
+#endif
+
+// 删除目录中的全部内容(保留目录本身), 多线程并行删除子目录; 目录不存在视为成功
+int remove_directory_contents(const char* path, bool quiet) {
+#if defined(PLATFORM_WINDOWS)
+    // Windows: 删除整个目录后重新创建
+    char command[MAX_PATH_LEN + 32];
+    snprintf(command, sizeof(command), "rmdir /S /Q \"%s\" 2>NUL", path);
+    (void)quiet;
+    execute_command(command);
+    return create_directory(path);
+#else
+    struct delete_tree tree;
+    memset(&tree, 0, sizeof(tree));
+    tree.root_fd = open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (tree.root_fd < 0) {
+        if (errno == ENOENT) return 1;
+        fprintf(stderr, "无法打开目录 %s: %s\n", path, strerror(errno));
+        return 0;
+    }
+    pthread_mutex_init(&tree.lock, NULL);
+    pthread_cond_init(&tree.cond, NULL);
+
+    struct delete_node* root = calloc(1, sizeof(*root));
+    if (root) root->path = strdup(".");
+    if (!root || !root->path) {
+        free(root);
+        close(tree.root_fd);
+        return 0;
+    }
+    root->pending = 1;
+    tree.stack = root;
+
+    // 删除主要受文件系统元数据操作限制,线程数超过16收益很小
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    int thread_count = cpus < 2 ? 2 : (cpus > 16 ? 16 : (int)cpus);
+    pthread_t threads[16];
+    int started = 0;
+    int64_t start_us = now_us();
+    for (int i = 0; i < thread_count; i++) {
+        if (pthread_create(&threads[started], NULL, delete_worker, &tree) == 0) started++;
+    }
+    if (started == 0) delete_worker(&tree);
+    for (int i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    if (!quiet) {
+        printf("已删除 %zu 个文件和 %zu 个目录,用时 %.2fs\n", tree.files, tree.dirs, (now_us() - start_us) / 1e6);
+    }
+    close(tree.root_fd);
+    pthread_mutex_destroy(&tree.lock);
+    pthread_cond_destroy(&tree.cond);
+    return tree.errors == 0;
+#endif
+}
+
+// 删除整个目录树(包括目录本身)
+int remove_directory_tree(const char* path, bool quiet) {
+    if (!remove_directory_contents(path, quiet)) return 0;
+    if (RMDIR(path) != 0 && errno != ENOENT) {
+        fprintf(stderr, "删除目录失败: %s: %s\n", path, strerror(errno));
+        return 0;
+    }
+    return 1;
+}
+
+// 构建目录中的回收目录: 待删除的内容先移动到这里,再由后台进程删除
+#define TRASH_DIR_NAME ".cbuild-trash"
+
+// 把构建目录中的内容移动到回收目录并在后台删除,本进程立即返回;
+// 同一文件系统内的rename是原子的,后续构建不会看到删除了一半的目录
+int move_to_trash_and_delete(const char* build_dir) {
+#if defined(PLATFORM_WINDOWS)
+    return remove_directory_contents(build_dir, false);
+#else
+    char trash_dir[MAX_PATH_LEN];
+    char batch_dir[MAX_PATH_LEN];
+    snprintf(trash_dir, sizeof(trash_dir), "%s/%s", build_dir, TRASH_DIR_NAME);
+    snprintf(batch_dir, sizeof(batch_dir), "%s/%ld-%lld", trash_dir, (long)getpid(), (long long)now_us());
+    if ((mkdir(trash_dir, 0755) != 0 && errno != EEXIST) || mkdir(batch_dir, 0755) != 0) {
+        return remove_directory_contents(build_dir, false);
+    }
+
+    DIR* dir = opendir(build_dir);
+    if (!dir) {
+        perror("无法打开构建目录");
+        return 0;
+    }
+    int moved = 0;
+    bool failed = false;
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL) {
+        const char* name = entry->d_name;
+        if (!strcmp(name, ".") || !strcmp(name, "..") || !strcmp(name, TRASH_DIR_NAME)) continue;
+        char from[MAX_PATH_LEN];
+        char to[MAX_PATH_LEN];
+        snprintf(from, sizeof(from), "%s/%s", build_dir, name);
+        snprintf(to, sizeof(to), "%s/%s", batch_dir, name);
+        if (rename(from, to) == 0) moved++;
+        else failed = true;
+    }
+    closedir(dir);
+    if (failed) {
+        // 无法移动的内容(例如挂载点)同步删除
+        remove_directory_contents(build_dir, true);
+    }
+
+    // 两次fork让删除进程脱离当前进程,不产生僵尸进程,也不阻塞后续构建
+    fflush(stdout);
+    fflush(stderr);
+    pid_t pid = fork();
+    if (pid < 0) {
+        return remove_directory_tree(trash_dir, false);
+    }
+    if (pid == 0) {
+        setsid();
+        if (fork() == 0) {
+            int null_fd = open("/dev/null", O_RDWR);
+            if (null_fd >= 0) {
+                dup2(null_fd, STDIN_FILENO);
+                dup2(null_fd, STDOUT_FILENO);
+                dup2(null_fd, STDERR_FILENO);
+                close(null_fd);
+            }
+            if (nice(10) == -1) {
+                // 降低优先级失败不影响删除
+            }
+            // 同时清理之前被中断的后台删除留下的内容
+            remove_directory_tree(trash_dir, true);
+            _exit(0);
+        }
+        _exit(0);
+    }
+    waitpid(pid, NULL, 0);
+    printf("已将 %d 项移入 %s,后台删除中\n", moved, trash_dir);
+    return 1;
+#endif
+}
+
+// 清理构建目录中的全部内容,保留构建目录本身;
+// background为true时把内容移入回收目录后立即返回,由后台进程完成删除
+uint8_t clean_project_cache(const char* build_dir, bool background) {
+    struct stat st;
+    if (stat(build_dir, &st) != 0) {
+        // 特殊处理：构建目录不存在时视为已清理
+        if (errno == ENOENT) {
+            printf("%s目录不存在,无需清理\n", build_dir);
+            create_directory(build_dir);
+            return EXIT_SUCCESS;
+        }
+        perror("无法访问构建目录");
+        return EXIT_FAILURE;
+    }
+    if (!S_ISDIR(st.st_mode)) {
+        fprintf(stderr, "%s 不是目录\n", build_dir);
+        return EXIT_FAILURE;
+    }
+
+    int ok = background
+        ? move_to_trash_and_delete(build_dir)
+        : remove_directory_contents(build_dir, false);
+    if (!ok) {
+        printf("清理缓存失败\n");
+        return EXIT_FAILURE;
+    }
+
+    printf("CMake缓存清理成功\n");
+    return EXIT_SUCCESS;
+}
+
+#if defined(PLATFORM_LINUX)
+// 读取文件的第一行
+int read_first_line(const char* path, char* out, size_t out_size) {
+    FILE* file = fopen(path, "r");
+    if (!file) return 0;
+    int ok = fgets(out, (int)out_size, file) != NULL;
+    fclose(file);
+    if (ok) out[strcspn(out, "\r\n")] = '\0';
+    return ok;
+}
+
+// 当前进程所在cgroup的目录, cgroup v2 为 /sys/fs/cgroup/<path>
+void cgroup_v2_dir(char* out, size_t out_size) {
+    snprintf(out, out_size, "/sys/fs/cgroup");
+    FILE* file = fopen("/proc/self/cgroup", "r");
+    if (!file) return;
+    char line[MAX_PATH_LEN];
+    while (fgets(line, sizeof(line), file)) {
+        line[strcspn(line, "\r\n")] = '\0';
+        if (!strncmp(line, "0::", 3)) {
+            char candidate[MAX_PATH_LEN];
+            struct stat st;
+            snprintf(candidate, sizeof(candidate), "/sys/fs/cgroup%s", line + 3);
+            // 容器内通常看不到宿主机的路径,此时使用根目录
+            if (stat(candidate, &st) == 0) snprintf(out, out_size, "%s", candidate);
+            break;
+        }
+    }
+    fclose(file);
+}
+
+// cgroup CPU配额折算的核心数, 无限制时返回0
+int cgroup_cpu_limit() {
+    char dir[MAX_PATH_LEN];
+    char path[MAX_PATH_LEN + 16];
+    char line[128];
+    cgroup_v2_dir(dir, sizeof(dir));
+    snprintf(path, sizeof(path), "%s/cpu.max", dir);
+    if (read_first_line(path, line, sizeof(line))) {
+        // 格式: "<quota> <period>" 或 "max <period>"
+        long long quota = 0, period = 0;
+        if (sscanf(line, "%lld %lld", &quota, &period) == 2 && quota > 0 && period > 0) {
+            return (int)((quota + period - 1) / period);
+        }
+        return 0;
+    }
+    // cgroup v1
+    char quota_line[64], period_line[64];
+    if (read_first_line("/sys/fs/cgroup/cpu/cpu.cfs_quota_us", quota_line, sizeof(quota_line)) &&
+        read_first_line("/sys/fs/cgroup/cpu/cpu.cfs_period_us", period_line, sizeof(period_line))) {
+        long long quota = atoll(quota_line), period = atoll(period_line);
+        if (quota > 0 && period > 0) return (int)((quota + period - 1) / period);
+    }
+    return 0;
+}
+
+// 可用内存(MB): 取系统MemAvailable与cgroup剩余内存中较小的值, 未知时返回0
+long long available_memory_mb() {
+    long long available = 0;
+    FILE* meminfo = fopen("/proc/meminfo", "r");
+    if (meminfo) {
+        char line[256];
+        while (fgets(line, sizeof(line), meminfo)) {
+            long long kb;
+            if (sscanf(line, "MemAvailable: %lld kB", &kb) == 1) {
+                available = kb / 1024;
+                break;
+            }
+        }
+        fclose(meminfo);
+    }
+
+    char dir[MAX_PATH_LEN];
+    char limit_path[MAX_PATH_LEN + 16], usage_path[MAX_PATH_LEN + 24];
+    char limit_line[64], usage_line[64];
+    cgroup_v2_dir(dir, sizeof(dir));
+    snprintf(limit_path, sizeof(limit_path), "%s/memory.max", dir);
+    snprintf(usage_path, sizeof(usage_path), "%s/memory.current", dir);
+    bool have_limit = read_first_line(limit_path, limit_line, sizeof(limit_line)) &&
+                      read_first_line(usage_path, usage_line, sizeof(usage_line));
+    if (!have_limit) {
+        have_limit = read_first_line("/sys/fs/cgroup/memory/memory.limit_in_bytes", limit_line, sizeof(limit_line)) &&
+                     read_first_line("/sys/fs/cgroup/memory/memory.usage_in_bytes", usage_line, sizeof(usage_line));
+    }
+    // v2无限制时为"max", v1无限制时为一个接近LLONG_MAX的值
+    if (have_limit && isdigit((unsigned char)limit_line[0])) {
+        long long limit = atoll(limit_line), usage = atoll(usage_line);
+        if (limit > 0 && limit < (1LL << 60)) {
+            long long cgroup_available = (limit - usage) / (1024 * 1024);
+            if (cgroup_available < 0) cgroup_available = 0;
+            if (available == 0 || cgroup_available < available) available = cgroup_available;
+        }
+    }
+    return available;
+}
+#endif
+
+// 根据CPU亲和性、cgroup配额和可用内存计算并行任务数
+int compute_job_count(const struct build_options* opts) {
+#if defined(PLATFORM_WINDOWS)
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    int jobs = (int)info.dwNumberOfProcessors;
+#else
+    int jobs = (int)sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+    if (jobs < 1) jobs = 1;
+
+#if defined(PLATFORM_LINUX)
+    cpu_set_t cpu_set;
+    if (sched_getaffinity(0, sizeof(cpu_set), &cpu_set) == 0 && CPU_COUNT(&cpu_set) > 0 && CPU_COUNT(&cpu_set) < jobs) {
+        jobs = CPU_COUNT(&cpu_set);
+    }
+    int cpu_limit = cgroup_cpu_limit();
+    if (cpu_limit > 0 && cpu_limit < jobs) {
+        printf("cgroup CPU配额限制为 %d 核\n", cpu_limit);
+        jobs = cpu_limit;
+    }
+    long long memory = available_memory_mb();
+    if (memory > 0 && opts->mem_per_job > 0) {
+        long long memory_jobs = memory / opts->mem_per_job;
+        if (memory_jobs < 1) memory_jobs = 1;
+        if (memory_jobs < jobs) {
+            printf("可用内存 %lldMB, 按每个任务 %dMB 限制为 %lld 个任务\n", memory, opts->mem_per_job, memory_jobs);
+            jobs = (int)memory_jobs;
+        }
+    }
+#endif
+
+    if (opts->max_jobs > 0 && opts->max_jobs < jobs) {
+        jobs = opts->max_jobs;
+    }
+    return jobs;
+}
+
+// 构建追踪输出文件(位于构建目录中)
+#define TRACE_JSON_FILE "cbuild_trace.json"
+#define TRACE_TEXT_FILE "cbuild_trace.txt"
+#define TRACE_TOP_COUNT 15
+
+// 一个追踪事件,对应Chrome trace中的 "X" 事件
+struct trace_event {
+    char* name;
+    const char* category;   // configure | generate | compile | pch | link | cmake
+    int64_t start_us;
+    int64_t dur_us;         // -1 表示尚未结束
+};
+
+struct build_trace {
+    struct trace_event* events;
+    size_t count;
+    size_t capacity;
+    int64_t configure_done_us;  // "-- Configuring done" 出现的时间
+    int64_t generate_done_us;   // "-- Generating done" 出现的时间
+};
+
+struct trace_event* trace_add(struct build_trace* trace, const char* name, const char* category, int64_t start_us, int64_t dur_us) {
+    if (trace->count == trace->capacity) {
+        size_t capacity = trace->capacity ? trace->capacity * 2 : 64;
+        struct trace_event* events = realloc(trace->events, capacity * sizeof(*events));
+        if (!events) return NULL;
+        trace->events = events;
+        trace->capacity = capacity;
+    }
+    struct trace_event* event = &trace->events[trace->count];
+    event->name = strdup(name);
+    if (!event->name) return NULL;
+    event->category = category;
+    event->start_us = start_us;
+    event->dur_us = dur_us;
+    trace->count++;
+    return event;
+}
+
+void trace_free(struct build_trace* trace) {
+    for (size_t i = 0; i < trace->count; i++) free(trace->events[i].name);
+    free(trace->events);
+    memset(trace, 0, sizeof(*trace));
+}
+
+bool has_suffix(const char* str, const char* suffix) {
+    size_t len = strlen(str), suffix_len = strlen(suffix);
+    return len >= suffix_len && !strcmp(str + len - suffix_len, suffix);
+}
+
+// 根据输出文件判断事件类别
+const char* classify_output(const char* output) {
+    if (has_suffix(output, ".o") || has_suffix(output, ".obj")) return "compile";
+    if (has_suffix(output, ".gch") || has_suffix(output, ".pch")) return "pch";
+    if (has_suffix(output, "build.ninja")) return "cmake";
+    return "link";
+}
+
+// 配置阶段的输出: 记录配置与生成完成的时间点
+void trace_configure_line(const char* line, void* ctx) {
+    struct build_trace* trace = ctx;
+    if (strstr(line, "-- Configuring done")) trace->configure_done_us = now_us();
+    else if (strstr(line, "-- Generating done")) trace->generate_done_us = now_us();
+}
+
+// Makefiles构建的输出: "Building CXX object <obj>" 和 "Linking CXX executable <path>" 标记任务开始
+// (C源文件为 "Building C object" / "Linking C"), 结束时间在构建完成后取输出文件的修改时间
+void trace_make_line(const char* line, void* ctx) {
+    struct build_trace* trace = ctx;
+    static const char* const building_prefixes[] = { "Building CXX object ", "Building C object " };
+    for (size_t i = 0; i < sizeof(building_prefixes) / sizeof(building_prefixes[0]); i++) {
+        const char* building = strstr(line, building_prefixes[i]);
+        if (!building) continue;
+        const char* output = building + strlen(building_prefixes[i]);
+        trace_add(trace, output, classify_output(output), now_us(), -1);
+        return;
+    }
+    const char* linking = strstr(line, "Linking CXX ");
+    if (!linking) linking = strstr(line, "Linking C ");
+    if (linking) {
+        // "Linking CXX executable x" / "Linking CXX static library x" / "Linking CXX shared library x"
+        const char* output = strrchr(linking, ' ');
+        if (output) trace_add(trace, output + 1, "link", now_us(), -1);
+    }
+}
+
+// 读取.ninja_log中offset之后新增的记录, 格式: start\tend\tmtime\toutput\thash (毫秒)
+void trace_read_ninja_log(struct build_trace* trace, long offset, int64_t build_start_us) {
+    FILE* log = fopen(".ninja_log", "r");
+    if (!log) return;
+    fseek(log, 0, SEEK_END);
+    // ninja会在日志过大时重写文件,此时从头读取
+    if (ftell(log) < offset) offset = 0;
+    fseek(log, offset, SEEK_SET);
+
+    char line[BUFFER_SIZE * 4];
+    while (fgets(line, sizeof(line), log)) {
+        if (line[0] == '#') continue;
+        long long start_ms, end_ms, mtime;
+        char output[BUFFER_SIZE * 4];
+        if (sscanf(line, "%lld\t%lld\t%lld\t%[^\t]", &start_ms, &end_ms, &mtime, output) != 4) continue;
+        trace_add(trace, output, classify_output(output), build_start_us + start_ms * 1000, (end_ms - start_ms) * 1000);
+    }
+    fclose(log);
+}
+
+// 把目标文件路径转换为源文件显示名: CMakeFiles/app.dir/src/main.cpp.o -> src/main.cpp
+void tu_display_name(const char* output, char* out, size_t out_size) {
+    const char* dir = strstr(output, ".dir/");
+    const char* start = dir ? dir + strlen(".dir/") : output;
+    snprintf(out, out_size, "%s", start);
+    size_t len = strlen(out);
+    if (len > 2 && !strcmp(out + len - 2, ".o")) out[len - 2] = '\0';
+    else if (len > 4 && !strcmp(out + len - 4, ".obj")) out[len - 4] = '\0';
+}
+
+// 头文件统计: 包含该头文件的翻译单元数量以及这些翻译单元的累计编译时间
+struct header_stat {
+    char* path;
+    int count;
+    int64_t total_us;
+};
+
+struct header_table {
+    struct header_stat* slots;
+    size_t capacity;
+    size_t count;
+};
+
+void header_table_add(struct header_table* table, const char* path, int64_t tu_us) {
+    if (table->count * 2 >= table->capacity) {
+        size_t capacity = table->capacity ? table->capacity * 2 : 1024;
+        struct header_stat* slots = calloc(capacity, sizeof(*slots));
+        if (!slots) return;
+        for (size_t i = 0; i < table->capacity; i++) {
+            if (!table->slots[i].path) continue;
+            size_t j = hash_string(FNV1A_OFFSET, table->slots[i].path) & (capacity - 1);
+            while (slots[j].path) j = (j + 1) & (capacity - 1);
+            slots[j] = table->slots[i];
+        }
+        free(table->slots);
+        table->slots = slots;
+        table->capacity = capacity;
+    }
+    size_t i = hash_string(FNV1A_OFFSET, path) & (table->capacity - 1);
+    while (table->slots[i].path && strcmp(table->slots[i].path, path) != 0) {
+        i = (i + 1) & (table->capacity - 1);
+    }
+    if (!table->slots[i].path) {
+        table->slots[i].path = strdup(path);
+        if (!table->slots[i].path) return;
+        table->count++;
+    }
+    table->slots[i].count++;
+    table->slots[i].total_us += tu_us;
+}
+
+// 解析gcc生成的.d依赖文件,第一个依赖是源文件本身
+void trace_add_depfile(struct header_table* table, const char* depfile, int64_t tu_us) {
+    char* data = read_file_contents(depfile, NULL);
+    if (!data) return;
+    char* p = strchr(data, ':');
+    int index = 0;
+    while (p && *p) {
+        p++;
+        while (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r' || (*p == '\\' && (p[1] == '\n' || p[1] == '\r'))) p++;
+        if (!*p) break;
+        char path[MAX_PATH_LEN];
+        size_t len = 0;
+        while (*p && !isspace((unsigned char)*p)) {
+            if (*p == '\\' && p[1] == ' ') p++;  // 转义的空格
+            if (len + 1 < sizeof(path)) path[len++] = *p;
+            p++;
+        }
+        path[len] = '\0';
+        // 遇到下一条规则(例如 -MP 生成的空规则)时停止
+        if (len > 0 && path[len - 1] == ':') break;
+        if (len > 0 && index++ > 0) header_table_add(table, path, tu_us);
+        p--;
+    }
+    free(data);
+}
+
+// 通过 ninja -t deps 获取依赖,输出格式为 "<target>: #deps N ..." 后跟缩进的依赖列表
+void trace_add_ninja_deps(struct header_table* table, const struct build_trace* trace) {
+    FILE* pipe = popen("ninja -t deps 2>/dev/null", "r");
+    if (!pipe) return;
+    char line[BUFFER_SIZE * 4];
+    int64_t tu_us = -1;
+    int index = 0;
+    while (fgets(line, sizeof(line), pipe)) {
+        line[strcspn(line, "\r\n")] = '\0';
+        if (line[0] != ' ' && line[0] != '\0') {
+            // 新的目标: 查找本次构建中该目标的编译耗时
+            char* colon = strstr(line, ": #deps");
+            tu_us = -1;
+            index = 0;
+            if (!colon) continue;
+            *colon = '\0';
+            for (size_t i = 0; i < trace->count; i++) {
+                if (!strcmp(trace->events[i].name, line) && !strcmp(trace->events[i].category, "compile")) {
+                    tu_us = trace->events[i].dur_us;
+                }
+            }
+        } 
+        else if (line[0] == ' ' && tu_us >= 0) {
+            char* path = line;
+            while (*path == ' ') path++;
+            if (index++ > 0) header_table_add(table, path, tu_us);
+        }
+    }
+    pclose(pipe);
+}
+
+int compare_events_by_duration(const void* a, const void* b) {
+    const struct trace_event* ea = *(const struct trace_event* const*)a;
+    const struct trace_event* eb = *(const struct trace_event* const*)b;
+    return (eb->dur_us > ea->dur_us) - (eb->dur_us < ea->dur_us);
+}
+
+int compare_headers_by_total(const void* a, const void* b) {
+    const struct header_stat* ha = *(const struct header_stat* const*)a;
+    const struct header_stat* hb = *(const struct header_stat* const*)b;
+    if (hb->total_us != ha->total_us) return (hb->total_us > ha->total_us) - (hb->total_us < ha->total_us);
+    return strcmp(ha->path, hb->path);
+}
+
+// 输出带引号和转义的JSON字符串
+void json_write_string(FILE* file, const char* value) {
+    fputc('"', file);
+    for (const unsigned char* c = (const unsigned char*)value; *c; c++) {
+        if (*c == '"' || *c == '\\') fprintf(file, "\\%c", *c);
+        else if (*c < 0x20) fprintf(file, "\\u%04x", *c);
+        else fputc(*c, file);
+    }
+    fputc('"', file);
+}
+
+// 写出Chrome trace JSON, 同一类别中时间重叠的任务分配到不同的线程轨道
+int write_chrome_trace(const struct build_trace* trace, int64_t origin_us, const char* path) {
+    FILE* file = fopen(path, "w");
+    if (!file) {
+        perror("写入构建追踪文件失败");
+        return 0;
+    }
+    int64_t lane_end[256] = {0};
+    int lanes = 0;
+    fprintf(file, "{\"traceEvents\":[\n");
+    for (size_t i = 0; i < trace->count; i++) {
+        const struct trace_event* event = &trace->events[i];
+        if (event->dur_us < 0) continue;
+        int tid = 0;
+        bool is_phase = !strcmp(event->category, "configure") || !strcmp(event->category, "generate");
+        if (!is_phase) {
+            // 阶段事件使用轨道0, 编译和链接任务从轨道1开始
+            for (tid = 0; tid < lanes && lane_end[tid] > event->start_us; tid++);
+            if (tid == lanes && lanes < 255) lanes++;
+            lane_end[tid] = event->start_us + event->dur_us;
+            tid++;
+        }
+        fprintf(file, "%s{\"name\":", i > 0 ? ",\n" : "");
+        json_write_string(file, event->name);
+        fprintf(file, ",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%lld,\"dur\":%lld,\"pid\":1,\"tid\":%d}",
+                event->category, (long long)(event->start_us - origin_us), (long long)event->dur_us, tid);
+    }
+    fprintf(file, "\n],\"displayTimeUnit\":\"ms\"}\n");
+    fclose(file);
+    return 1;
+}
+
+// 同时输出到终端和文本报告
+void trace_print(FILE* report, const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+    if (report) {
+        va_start(args, format);
+        vfprintf(report, format, args);
+        va_end(args);
+    }
+}
+
+// 输出各阶段耗时、最慢的翻译单元和开销最大的头文件,需要在构建目录中调用
+void trace_report(struct build_trace* trace, int64_t origin_us, bool ninja) {
+    // 汇总各类别的时间跨度和累计时间
+    int64_t compile_first = INT64_MAX, compile_last = 0, compile_sum = 0;
+    int64_t link_first = INT64_MAX, link_last = 0;
+    int64_t configure_us = 0, generate_us = 0;
+    size_t tu_count = 0;
+    struct trace_event** tus = malloc((trace->count + 1) * sizeof(*tus));
+    if (!tus) return;
+    for (size_t i = 0; i < trace->count; i++) {
+        struct trace_event* event = &trace->events[i];
+        if (event->dur_us < 0) continue;
+        int64_t end = event->start_us + event->dur_us;
+        if (!strcmp(event->category, "configure")) configure_us += event->dur_us;
+        else if (!strcmp(event->category, "generate")) generate_us += event->dur_us;
+        else if (!strcmp(event->category, "compile") || !strcmp(event->category, "pch")) {
+            if (event->start_us < compile_first) compile_first = event->start_us;
+            if (end > compile_last) compile_last = end;
+            compile_sum += event->dur_us;
+            if (!strcmp(event->category, "compile")) tus[tu_count++] = event;
+        } 
+        else if (!strcmp(event->category, "link")) {
+            if (event->start_us < link_first) link_first = event->start_us;
+            if (end > link_last) link_last = end;
+        }
+    }
+
+    FILE* report = fopen(TRACE_TEXT_FILE, "w");
+    trace_print(report, "\n==== 构建耗时 ====\n");
+    trace_print(report, "  配置   %8.2fs\n", configure_us / 1e6);
+    trace_print(report, "  生成   %8.2fs\n", generate_us / 1e6);
+    trace_print(report, "  编译   %8.2fs (墙钟), %.2fs (累计, %zu 个翻译单元)\n",
+                compile_last > compile_first ? (compile_last - compile_first) / 1e6 : 0.0, compile_sum / 1e6, tu_count);
+    trace_print(report, "  链接   %8.2fs\n", link_last > link_first ? (link_last - link_first) / 1e6 : 0.0);
+    trace_print(report, "  总计   %8.2fs\n", (now_us() - origin_us) / 1e6);
+
+    qsort(tus, tu_count, sizeof(*tus), compare_events_by_duration);
+    if (tu_count > 0) {
+        trace_print(report, "\n最慢的翻译单元:\n");
+        for (size_t i = 0; i < tu_count && i < TRACE_TOP_COUNT; i++) {
+            char name[MAX_PATH_LEN];
+            tu_display_name(tus[i]->name, name, sizeof(name));
+            trace_print(report, "  %8.2fs  %s\n", tus[i]->dur_us / 1e6, name);
+        }
+    }
+
+    // 头文件开销: 包含它的翻译单元越多、越慢,拆分或移入预编译头的收益越大
+    struct header_table headers = {0};
+    if (ninja) {
+        trace_add_ninja_deps(&headers, trace);
+    } 
+    else {
+        for (size_t i = 0; i < tu_count; i++) {
+            char depfile[MAX_PATH_LEN];
+            snprintf(depfile, sizeof(depfile), "%s.d", tus[i]->name);
+            trace_add_depfile(&headers, depfile, tus[i]->dur_us);
+        }
+    }
+    if (headers.count > 0) {
+        struct header_stat** sorted = malloc(headers.count * sizeof(*sorted));
+        size_t n = 0;
+        for (size_t i = 0; sorted && i < headers.capacity; i++) {
+            if (headers.slots[i].path) sorted[n++] = &headers.slots[i];
+        }
+        if (sorted) {
+            qsort(sorted, n, sizeof(*sorted), compare_headers_by_total);
+            trace_print(report, "\n开销最大的头文件(包含它的翻译单元累计编译时间):\n");
+            for (size_t i = 0; i < n && i < TRACE_TOP_COUNT; i++) {
+                trace_print(report, "  %8.2fs  %4d次  %s\n", sorted[i]->total_us / 1e6, sorted[i]->count, sorted[i]->path);
+            }
+            free(sorted);
+        }
+        for (size_t i = 0; i < headers.capacity; i++) free(headers.slots[i].path);
+        free(headers.slots);
+    }
+    free(tus);
+    if (report) fclose(report);
+
+    if (write_chrome_trace(trace, origin_us, TRACE_JSON_FILE)) {
+        printf("\nChrome trace: %s (使用 chrome://tracing 或 https://ui.perfetto.dev 打开)\n", TRACE_JSON_FILE);
+    }
+    printf("文本报告: %s\n", TRACE_TEXT_FILE);
+}
+
+// PGO模式
+#define PGO_NONE     0
+#define PGO_GENERATE 1  // 构建插桩程序并运行训练命令
+#define PGO_USE      2  // 使用收集到的profile重新构建
+
+#define PGO_STAMP_FILE ".cbuild_pgo_stamp"
+
+// 递归计算目录树中所有文件内容的哈希,按文件名排序保证结果稳定
+uint64_t hash_tree(uint64_t hash, const char* dir_path) {
+    DIR* dir = opendir(dir_path);
+    if (!dir) return hash;
+
+    char* names[4096];
+    int count = 0;
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL && count < (int)(sizeof(names) / sizeof(names[0]))) {
+        if (!strcmp(entry->d_name, ".") || !strcmp(entry->d_name, "..")) continue;
+        names[count] = strdup(entry->d_name);
+        if (names[count]) count++;
+    }
+    closedir(dir);
+    qsort(names, count, sizeof(names[0]), compare_strings);
+
+    for (int i = 0; i < count; i++) {
+        char path[MAX_PATH_LEN];
+        struct stat st;
+        snprintf(path, sizeof(path), "%s%c%s", dir_path, PATH_SEP, names[i]);
+        if (stat(path, &st) == 0) {
+            if (S_ISDIR(st.st_mode)) {
+                hash = hash_tree(hash, path);
+            } 
+            else {
+                hash = hash_file(hash, path);
+            }
+        }
+        free(names[i]);
+    }
+    return hash;
+}
+
+// 统计目录中以suffix结尾的文件数量,remove为true时同时删除这些文件
+int scan_files_with_suffix(const char* dir_path, const char* suffix, bool remove_files) {
+    DIR* dir = opendir(dir_path);
+    if (!dir) return 0;
+    int count = 0;
+    size_t suffix_len = strlen(suffix);
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (!strcmp(entry->d_name, ".") || !strcmp(entry->d_name, "..")) continue;
+        char path[MAX_PATH_LEN];
+        struct stat st;
+        snprintf(path, sizeof(path), "%s%c%s", dir_path, PATH_SEP, entry->d_name);
+        if (stat(path, &st) != 0) continue;
+        if (S_ISDIR(st.st_mode)) {
+            count += scan_files_with_suffix(path, suffix, remove_files);
+            continue;
+        }
+        size_t len = strlen(entry->d_name);
+        if (len >= suffix_len && !strcmp(entry->d_name + len - suffix_len, suffix)) {
+            count++;
+            if (remove_files) remove(path);
+        }
+    }
+    closedir(dir);
+    return count;
+}
+
+// 源码指纹,用于判断profile是否在源码修改之前生成
+void compute_pgo_stamp(char* out, size_t out_size) {
+    uint64_t hash = FNV1A_OFFSET;
+    hash = hash_file(hash, "CMake.toml");
+    hash = hash_tree(hash, "src");
+    hash = hash_tree(hash, "include");
+    snprintf(out, out_size, "%016llx", (unsigned long long)hash);
+}
+
+// 查找构建目录下所有的CMake二进制目录: 构建目录本身以及per-type/PGO布局的子目录
+size_t find_binary_dirs(const char* build_dir, struct string_list* dirs) {
+    char path[MAX_PATH_LEN];
+    struct stat st;
+    snprintf(path, sizeof(path), "%s%cCMakeCache.txt", build_dir, PATH_SEP);
+    if (stat(path, &st) == 0) {
+        string_list_push(dirs, build_dir);
+    }
+    DIR* dir = opendir(build_dir);
+    if (!dir) return dirs->count;
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (entry->d_name[0] == '.' || !strcmp(entry->d_name, "CMakeFiles")) continue;
+        snprintf(path, sizeof(path), "%s%c%s%cCMakeCache.txt", build_dir, PATH_SEP, entry->d_name, PATH_SEP);
+        if (stat(path, &st) == 0) {
+            string_list_pushf(dirs, "%s%c%s", build_dir, PATH_SEP, entry->d_name);
+        }
+    }
+    closedir(dir);
+    return dirs->count;
+}
+
+// 查找install/uninstall使用的CMake二进制目录, 兼容构建目录布局:
+// single和multi-config布局为构建目录本身, per-type布局为<构建目录>/<构建类型>;
+// build_type为NULL时使用build的默认类型Debug, per-type布局下只有一个构建类型时使用它;
+// 多配置生成器需要的--config写入config, 单配置时为空字符串
+int find_install_binary_dir(const char* build_dir, const char* build_type, char* out, size_t out_size, char* config, size_t config_size) {
+    char cache_path[MAX_PATH_LEN + 16];
+    char configurations[BUFFER_SIZE] = "";
+    struct stat st;
+    config[0] = '\0';
+    snprintf(cache_path, sizeof(cache_path), "%s%cCMakeCache.txt", build_dir, PATH_SEP);
+    if (stat(cache_path, &st) == 0) {
+        snprintf(out, out_size, "%s", build_dir);
+        if (read_cmake_cache_value(cache_path, "CMAKE_CONFIGURATION_TYPES", configurations, sizeof(configurations)) && configurations[0]) {
+            snprintf(config, config_size, "%s", build_type ? build_type : "Debug");
+        }
+        return 1;
+    }
+    snprintf(out, out_size, "%s%c%s", build_dir, PATH_SEP, build_type ? build_type : "Debug");
+    snprintf(cache_path, sizeof(cache_path), "%s%cCMakeCache.txt", out, PATH_SEP);
+    if (stat(cache_path, &st) == 0) return 1;
+    if (!build_type) {
+        struct string_list dirs = {0};
+        size_t count = find_binary_dirs(build_dir, &dirs);
+        if (count == 1) snprintf(out, out_size, "%s", dirs.items[0]);
+        string_list_free(&dirs);
+        if (count == 1) return 1;
+        if (count > 1) {
+            fprintf(stderr, "错误: %s 中有多个构建类型的构建目录,请使用 -t 指定构建类型\n", build_dir);
+            return 0;
+        }
+    }
+    fprintf(stderr, "错误: 找不到构建目录 %s,请先构建项目\n", out);
+    return 0;
+}
+
+// 删除配置结果: CMakeCache.txt、CMakeFiles/<版本号>中的编译器检测结果和配置指纹,保留目标文件
+int clean_configure_metadata(const char* binary_dir) {
+    static const char* files[] = { "CMakeCache.txt", FINGERPRINT_FILE, "CMakeFiles/cmake.check_cache" };
+    char path[MAX_PATH_LEN];
+    int removed = 0;
+    for (size_t i = 0; i < sizeof(files) / sizeof(files[0]); i++) {
+        snprintf(path, sizeof(path), "%s%c%s", binary_dir, PATH_SEP, files[i]);
+        if (remove(path) == 0) removed++;
+    }
+    snprintf(path, sizeof(path), "%s%cCMakeFiles", binary_dir, PATH_SEP);
+    DIR* dir = opendir(path);
+    if (!dir) return removed;
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL) {
+        // 例如 CMakeFiles/3.25.1
+        if (!isdigit((unsigned char)entry->d_name[0])) continue;
+        char version_dir[MAX_PATH_LEN];
+        snprintf(version_dir, sizeof(version_dir), "%s%c%s", path, PATH_SEP, entry->d_name);
+        if (remove_directory_tree(version_dir, true)) removed++;
+    }
+    closedir(dir);
+    return removed;
+}
+
+// 删除一个目标的目标文件和依赖文件,保留CMake生成的构建规则,下次构建时该目标完整重新编译
+int clean_target_objects(const char* binary_dir, const char* target) {
+    char target_dir[MAX_PATH_LEN];
+    struct stat st;
+    snprintf(target_dir, sizeof(target_dir), "%s%cCMakeFiles%c%s.dir", binary_dir, PATH_SEP, PATH_SEP, target);
+    if (stat(target_dir, &st) != 0 || !S_ISDIR(st.st_mode)) return -1;
+    return scan_files_with_suffix(target_dir, ".o", true)
+         + scan_files_with_suffix(target_dir, ".obj", true)
+         + scan_files_with_suffix(target_dir, ".o.d", true)
+         + scan_files_with_suffix(target_dir, ".obj.d", true);
+}
+
+// 删除预编译头(cmake_pch.hxx.gch / .pch),保留生成的cmake_pch.hxx
+int clean_precompiled_headers(const char* binary_dir) {
+    char path[MAX_PATH_LEN];
+    snprintf(path, sizeof(path), "%s%cCMakeFiles", binary_dir, PATH_SEP);
+    return scan_files_with_suffix(path, ".gch", true) + scan_files_with_suffix(path, ".pch", true);
+}
+
+// cbuild clean [构建目录] [--async] [--configure] [--objects <目标>] [--pch]
+uint8_t clean_command(int argc, char* argv[]) {
+    const char* build_dir = "build";
+    bool background = false;
+    bool configure = false;
+    bool pch = false;
+    struct string_list targets = {0};
+    for (int i = 2; i < argc; i++) {
+        if (!strcmp(argv[i], "--async") || !strcmp(argv[i], "-a")) {
+            background = true;
+        } 
+        else if (!strcmp(argv[i], "--configure")) {
+            configure = true;
+        } 
+        else if (!strcmp(argv[i], "--pch")) {
+            pch = true;
+        } 
+        else if (!strcmp(argv[i], "--objects")) {
+            if (i + 1 >= argc || argv[i + 1][0] == '-' || strchr(argv[i + 1], '/') || strchr(argv[i + 1], '\\')) {
+                fprintf(stderr, "错误：--objects 需要一个目标名\n");
+                string_list_free(&targets);
+                return EXIT_FAILURE;
+            }
+            string_list_push(&targets, argv[++i]);
+        } 
+        else if (argv[i][0] != '-') {
+            build_dir = argv[i];
+        } 
+        else {
+            fprintf(stderr, "未知的clean选项: %s\n", argv[i]);
+            string_list_free(&targets);
+            return EXIT_FAILURE;
+        }
+    }
+    if (!configure && !pch && targets.count == 0) {
+        return clean_project_cache(build_dir, background);
+    }
+
+    // 选择性清理作用于构建目录下的每个二进制目录(per-type、PGO等布局)
+    struct string_list binary_dirs = {0};
+    if (find_binary_dirs(build_dir, &binary_dirs) == 0) {
+        printf("%s 中没有CMake构建目录,无需清理\n", build_dir);
+        string_list_free(&targets);
+        return EXIT_SUCCESS;
+    }
+
+    bool failed = false;
+    for (size_t t = 0; t < targets.count; t++) {
+        bool found = false;
+        for (size_t i = 0; i < binary_dirs.count; i++) {
+            int removed = clean_target_objects(binary_dirs.items[i], targets.items[t]);
+            if (removed < 0) continue;
+            found = true;
+            printf("%s: 已删除目标 %s 的 %d 个目标文件\n", binary_dirs.items[i], targets.items[t], removed);
+        }
+        if (!found) {
+            fprintf(stderr, "未找到目标 %s (CMakeFiles/%s.dir)\n", targets.items[t], targets.items[t]);
+            failed = true;
+        }
+    }
+    for (size_t i = 0; pch && i < binary_dirs.count; i++) {
+        printf("%s: 已删除 %d 个预编译头\n", binary_dirs.items[i], clean_precompiled_headers(binary_dirs.items[i]));
+    }
+    for (size_t i = 0; configure && i < binary_dirs.count; i++) {
+        int removed = clean_configure_metadata(binary_dirs.items[i]);
+        printf("%s: 已删除 %d 项配置缓存,下次构建将重新配置\n", binary_dirs.items[i], removed);
+    }
+    string_list_free(&binary_dirs);
+    string_list_free(&targets);
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+// 使用已加载的构建选项执行构建, 命令行参数覆盖CMake.toml中的设置
+uint8_t build_with_options(int argc, char* argv[], struct build_options* build_opts, struct dependency_list* deps) {
+    char cmake_build_type[16] = "Debug"; // 使用更安全的长度
+    char make_install_prefix[MAX_PATH_LEN] = ""; // 跨平台前缀初始化
+    char build_dir[MAX_PATH_LEN] = "build";
+    bool configure_only = false;
+    bool clean_cache = false;
+    bool build_type_set = false;
+    int pgo_mode = PGO_NONE;
+    int jobs = 0; // 0 表示自动计算
+    bool trace_enabled = false;
+    bool timestamps = false;
+    bool locked = false; // 要求依赖项的解析结果与CMake.lock一致
+    struct build_trace trace = {0};
+    int64_t trace_origin_us = now_us();
+
+    // 设置默认安装路径
+#if PLATFORM_WINDOWS
+    strcpy(make_install_prefix, ".\\install"); // Windows默认安装路径
+#else
+    strcpy(make_install_prefix, "/usr/local");
+#endif
+
+    // 增强的参数解析
+    for (int i = 2; i < argc; i++) {
+        if (!strcmp(argv[i], "-d") || !strcmp(argv[i], "--debug")) {
+            strcpy(cmake_build_type, "Debug");
+            build_type_set = true;
+        } 
+        else if (!strcmp(argv[i], "-r") || !strcmp(argv[i], "--release")) {
+            strcpy(cmake_build_type, "Release");
+            build_type_set = true;
+        } 
+        else if (!strcmp(argv[i], "-t") || !strcmp(argv[i], "--build-type")) {
+            if (i + 1 >= argc || !is_valid_build_type(argv[i + 1])) {
+                fprintf(stderr, "错误：构建类型必须是 Debug、Release、RelWithDebInfo 或 MinSizeRel\n");
+                return EXIT_FAILURE;
+            }
+            strcpy(cmake_build_type, argv[++i]);
+            build_type_set = true;
+        }
+        else if (!strcmp(argv[i], "-j") || !strcmp(argv[i], "--jobs")) {
+            if (i + 1 >= argc || atoi(argv[i + 1]) <= 0) {
+                fprintf(stderr, "错误：-j 需要一个正整数\n");
+                return EXIT_FAILURE;
+            }
+            jobs = atoi(argv[++i]);
+        }
+        else if (!strncmp(argv[i], "-j", 2) && atoi(argv[i] + 2) > 0) {
+            jobs = atoi(argv[i] + 2);
+        }
+        else if (!strcmp(argv[i], "--trace")) {
+            trace_enabled = true;
+        }
+        else if (!strcmp(argv[i], "--timestamps")) {
+            timestamps = true;
+        }
+        else if (!strcmp(argv[i], "--pgo-generate")) {
+            pgo_mode = PGO_GENERATE;
+        }
+        else if (!strcmp(argv[i], "--pgo-use")) {
+            pgo_mode = PGO_USE;
+        }
+        else if (!strcmp(argv[i], "--locked")) {
+            locked = true;
+        }
+        else if (!strcmp(argv[i], "--no-daemon")) {
+            // 已在main中处理
+        }
+        else if (!strcmp(argv[i], "-L") || !strcmp(argv[i], "--layout")) {
+            if (i + 1 >= argc || !is_valid_layout(argv[i + 1])) {
+                fprintf(stderr, "错误：构建目录布局必须是 single、per-type 或 multi-config\n");
+                return EXIT_FAILURE;
+            }
+            strcpy(build_opts->layout, argv[++i]);
+        }
+        else if (!strcmp(argv[i], "-p") || !strcmp(argv[i], "--prefix")) {
+#if PLATFORM_WINDOWS
+            if (i + 1 >= argc) {
+                fprintf(stderr, "错误：未指定安装目录,使用默认安装目录\n");
+                strcpy(make_install_prefix,".\\install");
+                continue;
+            }
+            if(argv[i+1][0]=='-'){
+                fprintf(stderr, "错误：未指定安装目录,使用默认安装目录\n");
+                strcpy(make_install_prefix,".\\install");
+                continue;
+            }
+#else
+            if (i + 1 >= argc) {
+                fprintf(stderr, "错误：未指定安装目录,使用默认安装目录\n");
+                strcpy(make_install_prefix,"/usr/local");
+                continue;
+            }
+            if(argv[i+1][0]=='-'){
+                fprintf(stderr, "错误：未指定安装目录,使用默认安装目录\n");
+                strcpy(make_install_prefix,"/usr/local");
+                continue;
+            }
+#endif
+            strcpy(make_install_prefix, argv[++i]);
+            make_install_prefix[MAX_PATH_LEN - 1] = '\0';
+        } 
+        else if (!strcmp(argv[i], "--configure-only") || !strcmp(argv[i], "-c")) {
+            configure_only = true;
+        } 
+        else if (!strcmp(argv[i], "-b") || !strcmp(argv[i], "--build-dir")) {
+            if (i + 1 >= argc) {
+                fprintf(stderr, "错误：未指定构建目录\n");
+                return EXIT_FAILURE;
+            }
+            strncpy(build_dir, argv[++i], MAX_PATH_LEN - 1);
+            build_dir[MAX_PATH_LEN - 1] = '\0';
+        }
+        else if(!strcmp(argv[i],"-C") || !strcmp(argv[i],"--clean-cache")){
+            clean_cache = true;
+        }
+        else {
+            // 收集额外的CMake参数
+            string_list_push(&build_opts->cmake_args, argv[i]);
+        }
+    }
+
+    // PGO的两个阶段各自使用独立的单配置构建目录,默认使用Release
+    if (pgo_mode != PGO_NONE) {
+        if (!build_type_set) strcpy(cmake_build_type, "Release");
+        strcpy(build_opts->layout, LAYOUT_SINGLE);
+    }
+
+    // Ninja Multi-Config 是唯一可用的多配置生成器
+    if (!strcmp(build_opts->layout, LAYOUT_MULTI_CONFIG)) {
+        char ninja_path[MAX_PATH_LEN];
+        if (!find_in_path("ninja", ninja_path, sizeof(ninja_path))) {
+            printf("警告: 未找到ninja,multi-config布局回退为per-type布局\n");
+            strcpy(build_opts->layout, LAYOUT_PER_TYPE);
+        }
+    }
+    bool multi_config = !strcmp(build_opts->layout, LAYOUT_MULTI_CONFIG);
+    bool per_type = !strcmp(build_opts->layout, LAYOUT_PER_TYPE);
+
+    printf("构建模式: %s | 安装路径: %s | 目录布局: %s\n", cmake_build_type, make_install_prefix, build_opts->layout);
+
+    if(clean_cache){
+        printf("清理缓存\n");
+        // 旧内容移入回收目录后在后台删除,构建可以立即开始
+        if(clean_project_cache(build_dir, true)!=EXIT_SUCCESS){
+            fprintf(stderr, "清理缓存失败\n");
+            return EXIT_FAILURE;
+        }
+    }
+
+    // sources模式由cbuild展开, 源文件列表变化时重新生成CMakeLists.txt
+    if (!refresh_cmakelists(build_dir, build_opts, deps)) {
+        return EXIT_FAILURE;
+    }
+
+    // 保存当前目录(即项目源码目录)
+    char cwd[MAX_PATH_LEN];
+    if (!getcwd(cwd, sizeof(cwd))) {
+        perror("无法获取当前目录");
+        return EXIT_FAILURE;
+    }
+
+    // per-type布局下每种构建类型使用独立的子目录
+    const char* pgo_subdir = pgo_mode == PGO_GENERATE ? "pgo-generate" : "pgo-use";
+    char binary_dir[MAX_PATH_LEN];
+    if (pgo_mode != PGO_NONE) {
+        snprintf(binary_dir, sizeof(binary_dir), "%s%c%s", build_dir, PATH_SEP, pgo_subdir);
+    }
+    else if (per_type) {
+        snprintf(binary_dir, sizeof(binary_dir), "%s%c%s", build_dir, PATH_SEP, cmake_build_type);
+    } 
+    else {
+        snprintf(binary_dir, sizeof(binary_dir), "%s", build_dir);
+    }
+
+    // 选择生成器,并与构建目录中已记录的生成器比较
+    char cache_path[MAX_PATH_LEN];
+    char generator[64];
+    char cached_generator[64] = "";
+    snprintf(cache_path, sizeof(cache_path), "%s%cCMakeCache.txt", binary_dir, PATH_SEP);
+    select_generator(build_opts, cache_path, generator, sizeof(generator));
+    read_cached_generator(cache_path, cached_generator, sizeof(cached_generator));
+    bool generator_changed = cached_generator[0] != '\0' && strcmp(cached_generator, generator) != 0;
+    printf("CMake生成器: %s\n", generator);
+
+    // 编译器缓存通过CMAKE_CXX_COMPILER_LAUNCHER接入
+    char cache_tool[MAX_PATH_LEN];
+    char launcher_flag[MAX_PATH_LEN + 64] = "";
+    if (resolve_compiler_cache(build_opts, cache_tool, sizeof(cache_tool))) {
+        printf("编译器缓存: %s\n", cache_tool);
+        snprintf(launcher_flag, sizeof(launcher_flag), "-DCMAKE_CXX_COMPILER_LAUNCHER=%s", cache_tool);
+    }
+
+    // PGO编译参数: -fprofile-prefix-path让两个阶段不同构建目录下的profile文件名一致
+    char pgo_dir[MAX_PATH_LEN] = "";
+    char pgo_cxx_flags[MAX_PATH_LEN * 4] = "";
+    if (pgo_mode != PGO_NONE) {
+        if (is_absolute_path(build_opts->pgo_profile_dir)) {
+            snprintf(pgo_dir, sizeof(pgo_dir), "%s", build_opts->pgo_profile_dir);
+        } 
+        else {
+            snprintf(pgo_dir, sizeof(pgo_dir), "%s%c%s", cwd, PATH_SEP, build_opts->pgo_profile_dir);
+        }
+        // 必须是目标文件绝对路径的前缀, 构建目录(-b)可能是绝对路径
+        char prefix_path[MAX_PATH_LEN];
+        if (is_absolute_path(binary_dir)) {
+            snprintf(prefix_path, sizeof(prefix_path), "%s", binary_dir);
+        } 
+        else {
+            snprintf(prefix_path, sizeof(prefix_path), "%s%c%s", cwd, PATH_SEP, binary_dir);
+        }
+
+        if (pgo_mode == PGO_GENERATE) {
+            snprintf(pgo_cxx_flags, sizeof(pgo_cxx_flags),
+                "-fprofile-generate=%s -fprofile-update=atomic -fprofile-prefix-path=%s", pgo_dir, prefix_path);
+        } 
+        else {
+            // 检查profile是否存在以及是否过期
+            int profile_count = scan_files_with_suffix(pgo_dir, ".gcda", false);
+            if (profile_count == 0) {
+                fprintf(stderr, "错误: %s 中没有profile数据,请先运行 cbuild build --pgo-generate 并执行训练\n", pgo_dir);
+                return EXIT_FAILURE;
+            }
+            char stamp_path[MAX_PATH_LEN];
+            char saved_stamp[32] = "";
+            char current_stamp[32];
+            snprintf(stamp_path, sizeof(stamp_path), "%s%c%s", pgo_dir, PATH_SEP, PGO_STAMP_FILE);
+            compute_pgo_stamp(current_stamp, sizeof(current_stamp));
+            if (!read_configure_fingerprint(stamp_path, saved_stamp, sizeof(saved_stamp)) || strcmp(saved_stamp, current_stamp) != 0) {
+                printf("警告: 源码在生成profile之后已修改,profile可能已过期,建议重新运行 --pgo-generate\n");
+            }
+            printf("使用 %d 个profile文件: %s\n", profile_count, pgo_dir);
+            // 未被训练覆盖的代码仍按普通优化编译,过期的profile只给出警告而不中断构建
+            snprintf(pgo_cxx_flags, sizeof(pgo_cxx_flags),
+                "-fprofile-use=%s -fprofile-partial-training -fprofile-prefix-path=%s -Wno-missing-profile -Wno-error=coverage-mismatch",
+                pgo_dir, prefix_path);
+        }
+    }
+
+    // 构建配置命令(参数数组,不经过shell),源码目录使用绝对路径以支持任意深度的构建目录
+    struct string_list cmake_args = {0};
+    string_list_push(&cmake_args, "cmake");
+    string_list_push(&cmake_args, cwd);
+    string_list_push(&cmake_args, "-G");
+    string_list_push(&cmake_args, generator);
+    if (multi_config) {
+        string_list_push(&cmake_args, "-DCMAKE_CONFIGURATION_TYPES=Debug;Release;RelWithDebInfo;MinSizeRel");
+    } 
+    else {
+        string_list_pushf(&cmake_args, "-DCMAKE_BUILD_TYPE=%s", cmake_build_type);
+        if (per_type) {
+            string_list_pushf(&cmake_args, "-DCBUILD_OUTPUT_SUBDIR=%s", cmake_build_type);
+        } 
+        else if (pgo_mode != PGO_NONE) {
+            string_list_pushf(&cmake_args, "-DCBUILD_OUTPUT_SUBDIR=%s", pgo_subdir);
+        }
+    }
+#if PLATFORM_WINDOWS
+    // Windows路径需要特殊处理反斜杠
+    char escaped_prefix[MAX_PATH_LEN * 2] = {0};
+    char* pos = make_install_prefix;
+    char* dest = escaped_prefix;
+    while (*pos && (dest - escaped_prefix) < sizeof(escaped_prefix) - 2) {
+        if (*pos == '\\') *dest++ = '\\'; // 对反斜杠进行转义
+        *dest++ = *pos++;
+    }
+    *dest = '\0';
+    string_list_pushf(&cmake_args, "-DCMAKE_INSTALL_PREFIX=%s", escaped_prefix);
+#else
+    string_list_pushf(&cmake_args, "-DCMAKE_INSTALL_PREFIX=%s", make_install_prefix);
+#endif
+    string_list_push(&cmake_args, "-DCMAKE_C_COMPILER=gcc");
+    string_list_push(&cmake_args, "-DCMAKE_CXX_COMPILER=g++");
+    if (launcher_flag[0] != '\0') {
+        string_list_push(&cmake_args, launcher_flag);
+    }
+    if (pgo_cxx_flags[0] != '\0') {
+        string_list_pushf(&cmake_args, "-DCMAKE_CXX_FLAGS=%s", pgo_cxx_flags);
+    }
+    if (pgo_mode == PGO_GENERATE) {
+        string_list_push(&cmake_args, "-DCMAKE_EXE_LINKER_FLAGS=-fprofile-generate");
+        string_list_push(&cmake_args, "-DCMAKE_SHARED_LINKER_FLAGS=-fprofile-generate");
+    }
+    // 依赖项的IMPORTED目标定义, 构建目录可能是相对路径, 传给CMake的是绝对路径;
+    // CMakeLists.txt只在有通过pkg-config查找的依赖项时引用该变量, 否则CMake会警告变量未使用
+    size_t pkg_config_count = 0;
+    for (size_t i = 0; i < deps->count; i++) {
+        if (uses_pkg_config(&deps->items[i])) pkg_config_count++;
+    }
+    if (pkg_config_count > 0) {
+        bool absolute = build_dir[0] == '/' || build_dir[0] == '\\' || (build_dir[0] && build_dir[1] == ':');
+        string_list_pushf(&cmake_args, "-DCBUILD_DEPS_FILE=%s%s%s%c%s", absolute ? "" : cwd, absolute ? "" : "/",
+                          build_dir, PATH_SEP, DEPS_CMAKE_FILE);
+    }
+    for (size_t i = 0; i < build_opts->cmake_args.count; i++) {
+        string_list_push(&cmake_args, build_opts->cmake_args.items[i]);
+    }
+    // 完整的配置命令参与指纹计算,不能截断; 复制到cmake_args的内存池中,随cmake_args一起释放
+    char* formatted_command = format_command(cmake_args.items);
+    char* cmake_command = formatted_command ? arena_strdup(&cmake_args.arena, formatted_command) : NULL;
+    free(formatted_command);
+    if (!cmake_command) {
+        string_list_free(&cmake_args);
+        return EXIT_FAILURE;
+    }
+
+    // 依赖项的解析结果写入CMake.lock,版本或参数变化时指纹随之变化并触发重新配置;
+    // 解析结果缓存在构建目录中,未变化的依赖项不再运行pkg-config
+    if (!update_lock_file(deps, locked, build_dir)) {
+        string_list_free(&cmake_args);
+        return EXIT_FAILURE;
+    }
+    if (deps->count > 0 && !write_dependency_targets(deps, build_dir)) {
+        printf("警告: 依赖项未全部解析,CMake将通过pkg-config查找依赖项\n");
+    }
+
+    // 配置指纹覆盖CMake.toml、CMakeLists.txt、CMake.lock、工具链和配置参数,需在项目根目录计算
+    char fingerprint[32];
+    compute_configure_fingerprint(cmake_command, fingerprint, sizeof(fingerprint));
+
+    // 处理构建目录
+    struct stat st;
+    memset(&st, 0, sizeof(st));
+    if (stat(build_dir, &st) == -1 && !create_directory(build_dir)) {
+        fprintf(stderr, "创建构建目录失败: %s\n", build_dir);
+        string_list_free(&cmake_args);
+        return EXIT_FAILURE;
+    }
+    if (stat(binary_dir, &st) == -1 && !create_directory(binary_dir)) {
+        fprintf(stderr, "创建构建目录失败: %s\n", binary_dir);
+        string_list_free(&cmake_args);
+        return EXIT_FAILURE;
+    }
+
+    // 进入构建目录
+    if (CHDIR(binary_dir) != 0) {
+        perror("无法进入构建目录");
+        fprintf(stderr, "目标目录: %s\n", binary_dir);
+        string_list_free(&cmake_args);
+        return EXIT_FAILURE;
+    }
+
+    bool need_configure = true;
+
+    // 切换生成器时CMake要求删除旧的缓存和CMakeFiles
+    if (generator_changed) {
+        printf("生成器从 %s 变为 %s,清除旧的CMake缓存\n", cached_generator, generator);
+        remove("CMakeCache.txt");
+        remove_directory_tree("CMakeFiles", true);
+    }
+    
+    // 只有CMake缓存存在且配置指纹一致时才跳过配置
+    if (stat("CMakeCache.txt", &st) == 0) {
+        char existing_fingerprint[32] = "";
+        if (read_configure_fingerprint(FINGERPRINT_FILE, existing_fingerprint, sizeof(existing_fingerprint))
+            && strcmp(existing_fingerprint, fingerprint) == 0) {
+            need_configure = false;
+            printf("配置指纹未变化(%s),跳过配置阶段\n", fingerprint);
+        } 
+        else {
+            printf("配置指纹已变化,需要重新配置\n");
+        }
+    } 
+    else {
+        printf("未找到CMake缓存,需要进行配置\n");
+    }
+
+    // 配置阶段
+    if (need_configure) {
+        // 配置失败时不能保留旧指纹
+        remove(FINGERPRINT_FILE);
+        printf("配置CMake: %s\n", cmake_command);
+        int64_t configure_start_us = now_us();
+        struct run_options configure_output = { NULL, timestamps, trace_enabled ? trace_configure_line : NULL, &trace, false, NULL, false, false };
+        if (!run_process(cmake_args.items, &configure_output)) {
+            fprintf(stderr, "CMake配置失败\n");
+            string_list_free(&cmake_args);
+            trace_free(&trace);
+            CHDIR(cwd); // 恢复原始目录
+            return EXIT_FAILURE;
+        }
+        write_configure_fingerprint(FINGERPRINT_FILE, fingerprint);
+        if (trace_enabled) {
+            // "-- Configuring done" 之前为配置阶段, 之后到 "-- Generating done" 为生成阶段
+            int64_t configure_end_us = trace.configure_done_us ? trace.configure_done_us : now_us();
+            int64_t generate_end_us = trace.generate_done_us ? trace.generate_done_us : configure_end_us;
+            trace_add(&trace, "configure", "configure", configure_start_us, configure_end_us - configure_start_us);
+            trace_add(&trace, "generate", "generate", configure_end_us, generate_end_us - configure_end_us);
+        }
+    }
+    string_list_free(&cmake_args);
+
+    // 构建阶段
+    if (!configure_only) {
+        // 并行任务数: 命令行 -j 优先, 否则根据CPU配额和可用内存计算
+        if (jobs <= 0) {
+            jobs = compute_job_count(build_opts);
+        }
+        printf("并行任务数: %d\n", jobs);
+        char jobs_arg[16];
+        snprintf(jobs_arg, sizeof(jobs_arg), "%d", jobs);
+        char* build_args[] = { "cmake", "--build", ".", "--parallel", jobs_arg, NULL, NULL, NULL };
+        // 多配置生成器在构建时选择构建类型
+        if (multi_config) {
+            build_args[5] = "--config";
+            build_args[6] = cmake_build_type;
+        }
+        bool ninja = strstr(generator, "Ninja") != NULL;
+        long ninja_log_offset = 0;
+        if (trace_enabled && ninja && stat(".ninja_log", &st) == 0) {
+            ninja_log_offset = (long)st.st_size;
+        }
+        int64_t build_start_us = now_us();
+        struct run_options build_output = { NULL, timestamps, trace_enabled && !ninja ? trace_make_line : NULL, &trace, false, NULL, false, false };
+        if (!run_process(build_args, &build_output)) {
+            fprintf(stderr, "构建失败\n");
+            trace_free(&trace);
+            CHDIR(cwd); // 恢复原始目录
+            return EXIT_FAILURE;
+        }
+        if (trace_enabled) {
+            if (ninja) {
+                trace_read_ninja_log(&trace, ninja_log_offset, build_start_us);
+            } 
+            else {
+                // Makefiles只输出任务开始, 以输出文件的修改时间作为结束时间
+                for (size_t i = 0; i < trace.count; i++) {
+                    struct trace_event* event = &trace.events[i];
+                    if (event->dur_us >= 0) continue;
+                    int64_t end_us = file_mtime_us(event->name);
+                    event->dur_us = end_us > event->start_us ? end_us - event->start_us : 0;
+                }
+            }
+        }
+    }
+
+    if (trace_enabled) {
+        trace_report(&trace, trace_origin_us, strstr(generator, "Ninja") != NULL);
+        trace_free(&trace);
+    }
+
+    // 返回原始目录
+    if (CHDIR(cwd) != 0) {
+        perror("返回原始目录失败");
+        return EXIT_FAILURE;
+    }
+
+    // 插桩构建完成后清除旧profile,记录源码指纹并运行训练命令
+    if (pgo_mode == PGO_GENERATE && !configure_only) {
+        if (!create_directory(pgo_dir)) {
+            return EXIT_FAILURE;
+        }
+        int stale_count = scan_files_with_suffix(pgo_dir, ".gcda", true);
+        if (stale_count > 0) {
+            printf("已删除 %d 个旧的profile文件\n", stale_count);
+        }
+        char stamp_path[MAX_PATH_LEN];
+        char stamp[32];
+        snprintf(stamp_path, sizeof(stamp_path), "%s%c%s", pgo_dir, PATH_SEP, PGO_STAMP_FILE);
+        compute_pgo_stamp(stamp, sizeof(stamp));
+        write_configure_fingerprint(stamp_path, stamp);
+
+        // 训练命令通过CBUILD_BIN_DIR找到插桩后的程序
+        char bin_dir[MAX_PATH_LEN];
+        snprintf(bin_dir, sizeof(bin_dir), "%s%cbin%c%s", cwd, PATH_SEP, PATH_SEP, pgo_subdir);
+#if defined(PLATFORM_WINDOWS)
+        _putenv_s("CBUILD_BIN_DIR", bin_dir);
+#else
+        setenv("CBUILD_BIN_DIR", bin_dir, 1);
+#endif
+        if (build_opts->pgo_train[0] != '\0') {
+            printf("运行训练命令: %s\n", build_opts->pgo_train);
+            if (!execute_command(build_opts->pgo_train)) {
+                fprintf(stderr, "训练命令执行失败\n");
+                return EXIT_FAILURE;
+            }
+            printf("已收集 %d 个profile文件,运行 cbuild build --pgo-use 生成优化版本\n",
+                   scan_files_with_suffix(pgo_dir, ".gcda", false));
+        } 
+        else {
+            printf("未配置[pgo] train,请手动运行 %s 中的程序后执行 cbuild build --pgo-use\n", bin_dir);
+        }
+    }
+
+    printf("\n构建%s成功!\n", configure_only ? "配置" : "");
+    return EXIT_SUCCESS;
+}
+
+uint8_t build_project(int argc, char* argv[]) {
+    // 从CMake.toml读取[build]区块,命令行参数优先
+    struct build_options build_opts;
+    struct dependency_list deps = {0};
+    uint8_t result = load_build_options(&build_opts, &deps) ? build_with_options(argc, argv, &build_opts, &deps) : EXIT_FAILURE;
+    dependency_list_free(&deps);
+    free_build_options(&build_opts);
+    return result;
+}
+
+// 解析JSON字符串, p指向开头的引号,返回结尾引号之后的位置,失败返回NULL
+const char* json_parse_string(const char* p, char* out, size_t out_size) {
+    if (*p != '"') return NULL;
+    p++;
+    size_t len = 0;
+    while (*p && *p != '"') {
+        char c = *p++;
+        if (c == '\\') {
+            char e = *p++;
+            switch (e) {
+                case 'n': c = '\n'; break;
+                case 't': c = '\t'; break;
+                case 'r': c = '\r'; break;
+                case 'b': c = '\b'; break;
+                case 'f': c = '\f'; break;
+                case 'u': c = '?'; p += strlen(p) >= 4 ? 4 : strlen(p); break; // 编译数据库中不会出现非ASCII转义
+                case '\0': return NULL;
+                default: c = e; break;
+            }
+        }
+        if (len + 1 < out_size) out[len++] = c;
+    }
+    if (*p != '"') return NULL;
+    out[len] = '\0';
+    return p + 1;
+}
+
+// 查找编译数据库所在的构建目录,兼容per-type布局
+int find_compile_database(const char* build_dir, char* out, size_t out_size) {
+    static const char* build_types[] = { "", "Debug", "Release", "RelWithDebInfo", "MinSizeRel" };
+    struct stat st;
+    for (size_t i = 0; i < sizeof(build_types) / sizeof(build_types[0]); i++) {
+        if (build_types[i][0] == '\0') {
+            snprintf(out, out_size, "%s%ccompile_commands.json", build_dir, PATH_SEP);
+        } 
+        else {
+            snprintf(out, out_size, "%s%c%s%ccompile_commands.json", build_dir, PATH_SEP, build_types[i], PATH_SEP);
+        }
+        if (stat(out, &st) == 0) return 1;
+    }
+    return 0;
+}
+
+// 检查一个翻译单元是否真正使用了预编译头: 1 已使用, 0 未使用
+int check_tu_pch(const char* directory, const char* command, char* reason, size_t reason_size) {
+    if (!strstr(command, "cmake_pch")) {
+        snprintf(reason, reason_size, "编译命令中没有预编译头");
+        return 0;
+    }
+    // Clang通过-include-pch显式加载,PCH无效时编译直接失败
+    if (strstr(command, "-include-pch")) {
+        snprintf(reason, reason_size, "clang -include-pch");
+        return 1;
+    }
+
+    // GCC: -H 输出中 "! xxx.gch" 表示使用了PCH, "x xxx.gch" 表示PCH被拒绝
+    size_t size = strlen(command) + 64;
+    char* check_command = malloc(size);
+    if (!check_command) return 0;
+    snprintf(check_command, size, "%s -fsyntax-only -H 2>&1", command);
+
+    char cwd[MAX_PATH_LEN];
+    if (!getcwd(cwd, sizeof(cwd)) || CHDIR(directory) != 0) {
+        snprintf(reason, reason_size, "无法进入目录 %s", directory);
+        free(check_command);
+        return 0;
+    }
+    FILE* pipe = popen(check_command, "r");
+    free(check_command);
+    int used = 0;
+    snprintf(reason, reason_size, "未找到.gch文件,请先构建项目");
+    if (pipe) {
+        char line[BUFFER_SIZE];
+        while (fgets(line, sizeof(line), pipe)) {
+            if (!strstr(line, ".gch")) continue;
+            line[strcspn(line, "\r\n")] = '\0';
+            if (line[0] == '!') {
+                used = 1;
+                snprintf(reason, reason_size, "%s", line + 2);
+            } 
+            else if (line[0] == 'x' && !used) {
+                snprintf(reason, reason_size, "PCH被编译器拒绝(编译参数不一致): %s", line + 2);
+            }
+        }
+        pclose(pipe);
+    }
+    CHDIR(cwd);
+    return used;
+}
+
+// 根据编译数据库逐个检查翻译单元是否使用了预编译头: cbuild pch-check [构建目录]
+uint8_t pch_check(int argc, char* argv[]) {
+    const char* build_dir = argc > 2 ? argv[2] : "build";
+    char database_path[MAX_PATH_LEN];
+    if (!find_compile_database(build_dir, database_path, sizeof(database_path))) {
+        fprintf(stderr, "未在 %s 中找到compile_commands.json,请先运行 cbuild build\n", build_dir);
+        return EXIT_FAILURE;
+    }
+    size_t len = 0;
+    char* data = read_file_contents(database_path, &len);
+    if (!data) {
+        perror("读取compile_commands.json失败");
+        return EXIT_FAILURE;
+    }
+    printf("编译数据库: %s\n", database_path);
+
+    // 每个字段最长不超过整个文件
+    char* key = malloc(len + 1);
+    char* value = malloc(len + 1);
+    char* directory = malloc(len + 1);
+    char* command = malloc(len + 1);
+    char* file = malloc(len + 1);
+    if (!key || !value || !directory || !command || !file) {
+        fprintf(stderr, "内存不足\n");
+        free(data); free(key); free(value); free(directory); free(command); free(file);
+        return EXIT_FAILURE;
+    }
+
+    int total = 0;
+    int used_count = 0;
+    const char* p = data;
+    directory[0] = command[0] = file[0] = '\0';
+    while (*p) {
+        if (*p == '}') {
+            // 一个条目结束,跳过生成PCH本身的cmake_pch.hxx.cxx
+            if (command[0] != '\0' && file[0] != '\0' && !strstr(file, "cmake_pch")) {
+                char reason[MAX_PATH_LEN];
+                int used = check_tu_pch(directory, command, reason, sizeof(reason));
+                total++;
+                used_count += used;
+                printf("  [%s] %s\n        %s\n", used ? "已使用" : "未使用", file, reason);
+            }
+            directory[0] = command[0] = file[0] = '\0';
+            p++;
+            continue;
+        }
+        if (*p != '"') {
+            p++;
+            continue;
+        }
+        // "key": "value"
+        const char* next = json_parse_string(p, key, len + 1);
+        if (!next) break;
+        while (isspace((unsigned char)*next)) next++;
+        if (*next != ':') {
+            p = next;
+            continue;
+        }
+        next++;
+        while (isspace((unsigned char)*next)) next++;
+        if (*next != '"') {
+            p = next;
+            continue;
+        }
+        next = json_parse_string(next, value, len + 1);
+        if (!next) break;
+        if (!strcmp(key, "directory")) strcpy(directory, value);
+        else if (!strcmp(key, "command")) strcpy(command, value);
+        else if (!strcmp(key, "file")) strcpy(file, value);
+        p = next;
+    }
+
+    printf("\n预编译头使用情况: %d/%d 个翻译单元\n", used_count, total);
+    free(data); free(key); free(value); free(directory); free(command); free(file);
+    return used_count == total ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// 编译器缓存管理: cbuild cache stats | zero
+uint8_t cache_command(int argc, char* argv[]) {
+    const char* action = argc > 2 ? argv[2] : "stats";
+    struct build_options build_opts;
+    if (!load_build_options(&build_opts, NULL)) {
+        free_build_options(&build_opts);
+        return EXIT_FAILURE;
+    }
+    // 未配置缓存时也允许查看本机可用的缓存工具
+    if (!strcmp(build_opts.cache, "none")) {
+        strcpy(build_opts.cache, "auto");
+    }
+
+    char cache_tool[MAX_PATH_LEN];
+    if (!resolve_compiler_cache(&build_opts, cache_tool, sizeof(cache_tool))) {
+        fprintf(stderr, "未找到编译器缓存工具(ccache/sccache)\n");
+        return EXIT_FAILURE;
+    }
+
+    // ccache和sccache的统计参数相同,输出中包含命中率
+    char* cache_args[] = { cache_tool, NULL, NULL };
+    if (!strcmp(action, "stats")) {
+        cache_args[1] = "--show-stats";
+    } 
+    else if (!strcmp(action, "zero")) {
+        cache_args[1] = "--zero-stats";
+    } 
+    else {
+        fprintf(stderr, "未知的cache操作: %s (可用: stats, zero)\n", action);
+        return EXIT_FAILURE;
+    }
+    return run_process(cache_args, NULL) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// 解析依赖项: 更新CMake.lock, 并在构建目录中生成解析缓存和IMPORTED目标定义
+uint8_t deps_command(int argc, char* argv[]) {
+    const char* action = argc > 2 ? argv[2] : "resolve";
+    if (strcmp(action, "resolve") != 0) {
+        fprintf(stderr, "未知的deps操作: %s (可用: resolve)\n", action);
+        return EXIT_FAILURE;
+    }
+    char build_dir[MAX_PATH_LEN] = "build";
+    bool locked = false;
+    for (int i = 3; i < argc; i++) {
+        if (!strcmp(argv[i], "-b") || !strcmp(argv[i], "--build-dir")) {
+            if (i + 1 >= argc) {
+                fprintf(stderr, "错误：未指定构建目录\n");
+                return EXIT_FAILURE;
+            }
+            snprintf(build_dir, sizeof(build_dir), "%s", argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--locked")) {
+            locked = true;
+        }
+        else {
+            fprintf(stderr, "无效参数: %s\n", argv[i]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (access("CMake.toml", F_OK) != 0) {
+        fprintf(stderr, "错误: 当前目录下没有CMake.toml\n");
+        return EXIT_FAILURE;
+    }
+
+    struct build_options build_opts;
+    struct dependency_list deps = {0};
+    if (!load_build_options(&build_opts, &deps)) {
+        dependency_list_free(&deps);
+        free_build_options(&build_opts);
+        return EXIT_FAILURE;
+    }
+    int64_t start_us = now_us();
+    bool ok = update_lock_file(&deps, locked, build_dir) && write_dependency_targets(&deps, build_dir);
+    size_t cached = 0;
+    for (size_t i = 0; i < deps.count; i++) {
+        const struct dependency* dep = &deps.items[i];
+        if (dep->cached) cached++;
+        if (!dep->resolved) ok = false;
+        if (dep->path) {
+            printf("  %-24s %-12s (工作区成员 %s)\n", dep->name, dep->resolved ? dep->resolved_version : "未解析", dep->path);
+            continue;
+        }
+        if (dep->cmake_package) {
+            printf("  %-24s %-12s (CMake配置包 %s: %s)\n", dep->name, dep->resolved ? dep->resolved_version : "未解析",
+                   dep->cmake_package, dep->target_count > 0 ? dep->targets[0] : "");
+            continue;
+        }
+        printf("  %-24s %-12s %s\n", dep->name, dep->resolved ? dep->resolved_version : "未解析",
+               !dep->resolved ? "" : dep->cached ? "(缓存)" : "(pkg-config)");
+    }
+    printf("%zu 个依赖项, %zu 个命中缓存, 耗时 %.1f ms\n", deps.count, cached, (now_us() - start_us) / 1000.0);
+    dependency_list_free(&deps);
+    free_build_options(&build_opts);
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// 卸载清单中的一个文件及其处理结果
+struct uninstall_entry {
+    char* path;
+    const char* status;  // removed | missing | failed | would-remove
+    int error;
+};
+
+// 目录是否可以在卸载后删除: 只删除安装前缀下至少两级的目录(例如 <prefix>/include/mylib),
+// 不会删除 <prefix>/include、<prefix>/lib 等共享目录
+bool is_prunable_directory(const char* dir, const char* prefix) {
+    size_t prefix_len = strlen(prefix);
+    while (prefix_len > 1 && (prefix[prefix_len - 1] == '/' || prefix[prefix_len - 1] == PATH_SEP)) prefix_len--;
+    if (prefix_len == 0 || strncmp(dir, prefix, prefix_len) != 0 || dir[prefix_len] != PATH_SEP) return false;
+    const char* rest = dir + prefix_len + 1;
+    return rest[0] != '\0' && strchr(rest, PATH_SEP) != NULL;
+}
+
+// 截断到父目录,已经是根目录时返回false
+bool parent_directory(char* path) {
+    char* sep = strrchr(path, PATH_SEP);
+    if (!sep || sep == path) return false;
+    *sep = '\0';
+    return true;
+}
+
+// 获取cbuild自身的路径,用于通过sudo重新运行以及在工作区成员中运行
+int self_executable_path(const char* argv0, char* out, size_t out_size) {
+#if defined(PLATFORM_WINDOWS)
+    (void)argv0;
+    DWORD len = GetModuleFileNameA(NULL, out, (DWORD)out_size);
+    return len > 0 && len < out_size;
+#else
+#if defined(PLATFORM_LINUX)
+    ssize_t len = readlink("/proc/self/exe", out, out_size - 1);
+    if (len > 0) {
+        out[len] = '\0';
+        return 1;
+    }
+#endif
+    if (strchr(argv0, '/')) {
+        return realpath(argv0, out) != NULL;
+    }
+    return find_in_path(argv0, out, out_size);
+#endif
+}
+
+// 工作区: 顶层CMake.toml的[workspace] members列出成员项目的目录,
+// 成员之间的路径依赖({ path = "../core" })构成依赖图, 按拓扑顺序并行运行各成员的构建
+#define WORKSPACE_MAX_PARALLEL 4
+
+enum workspace_state { MEMBER_PENDING, MEMBER_RUNNING, MEMBER_SUCCEEDED, MEMBER_FAILED, MEMBER_SKIPPED };
+
+struct workspace_member {
+    const char* dir;
+    enum workspace_state state;
+    int64_t start_us;
+    int64_t end_us;
+    struct run_options opts;
+    struct child_process child;
+    char* const* argv;
+#if !defined(PLATFORM_WINDOWS)
+    pthread_t thread;
+    bool has_thread;
+    pthread_mutex_t* lock;
+    pthread_cond_t* done;
+#endif
+};
+
+// 读取[workspace] members; 当前目录的CMake.toml没有[workspace]时返回0
+int load_workspace_members(struct string_list* members) {
+    char error[BUFFER_SIZE];
+    struct toml_document* doc = toml_parse_file("CMake.toml", error, sizeof(error), NULL);
+    if (!doc) return 0;
+    const struct toml_table* workspace = toml_get_table(doc->root, "workspace");
+    const struct toml_value* list = workspace ? toml_table_get(workspace, "members") : NULL;
+    if (list) toml_string_array(list, "workspace", "members", members);
+    toml_free(doc);
+    return workspace != NULL;
+}
+
+// 成员之间的依赖: edges[i * count + j]表示成员i依赖成员j
+int load_workspace_edges(const struct string_list* members, bool* edges) {
+    size_t count = members->count;
+    for (size_t i = 0; i < count; i++) {
+        char toml_path[MAX_PATH_LEN];
+        char error[BUFFER_SIZE];
+        snprintf(toml_path, sizeof(toml_path), "%s%cCMake.toml", members->items[i], PATH_SEP);
+        struct toml_document* doc = toml_parse_file(toml_path, error, sizeof(error), NULL);
+        if (!doc) {
+            fprintf(stderr, "错误: 工作区成员 %s: %s\n", members->items[i], error);
+            return 0;
+        }
+        const struct toml_table* deps = toml_get_table(doc->root, "dependencies");
+        for (size_t k = 0; deps && k < deps->count; k++) {
+            const struct toml_value* value = deps->values[k];
+            const struct toml_value* path = value->type == TOML_TABLE ? toml_table_get(value->as.table, "path") : NULL;
+            if (!path || path->type != TOML_STRING) continue;
+            char dep_dir[MAX_PATH_LEN];
+            if (is_absolute_path(path->as.string)) {
+                snprintf(dep_dir, sizeof(dep_dir), "%s", path->as.string);
+            } 
+            else {
+                snprintf(dep_dir, sizeof(dep_dir), "%s%c%s", members->items[i], PATH_SEP, path->as.string);
+            }
+            bool found = false;
+            for (size_t j = 0; j < count && !found; j++) {
+                if (j != i && same_directory(dep_dir, members->items[j])) {
+                    edges[i * count + j] = true;
+                    found = true;
+                }
+            }
+            if (!found) {
+                printf("警告: 成员 %s 的路径依赖 %s 不是工作区成员,需要预先构建\n", members->items[i], path->as.string);
+            }
+        }
+        toml_free(doc);
+    }
+    return 1;
+}
+
+// Kahn算法求拓扑顺序, 同一层按members中的顺序; 返回排好的成员数, 小于count表示有循环依赖
+size_t workspace_order(const bool* edges, size_t count, size_t* order) {
+    size_t* pending = calloc(count + 1, sizeof(*pending));
+    bool* placed = calloc(count + 1, sizeof(*placed));
+    if (!pending || !placed) {
+        free(pending);
+        free(placed);
+        return 0;
+    }
+    for (size_t i = 0; i < count; i++) {
+        for (size_t j = 0; j < count; j++) {
+            if (edges[i * count + j]) pending[i]++;
+        }
+    }
+    size_t placed_count = 0;
+    bool progress = true;
+    while (placed_count < count && progress) {
+        progress = false;
+        for (size_t i = 0; i < count; i++) {
+            if (placed[i] || pending[i] > 0) continue;
+            placed[i] = true;
+            order[placed_count++] = i;
+            progress = true;
+            for (size_t k = 0; k < count; k++) {
+                if (edges[k * count + i]) pending[k]--;
+            }
+        }
+    }
+    free(pending);
+    free(placed);
+    return placed_count;
+}
+
+#if !defined(PLATFORM_WINDOWS)
+// 每个运行中的成员由一个线程转发输出并等待结束
+void* workspace_wait_thread(void* arg) {
+    struct workspace_member* member = arg;
+    bool ok = wait_process(&member->child, member->argv, &member->opts);
+    pthread_mutex_lock(member->lock);
+    member->state = ok ? MEMBER_SUCCEEDED : MEMBER_FAILED;
+    member->end_us = now_us();
+    pthread_cond_signal(member->done);
+    pthread_mutex_unlock(member->lock);
+    return NULL;
+}
+#endif
+
+// 依赖的成员都已成功时返回1, 有依赖的成员失败或被跳过时返回-1, 否则返回0
+int workspace_member_ready(const struct workspace_member* members, const bool* edges, size_t count, size_t i) {
+    int ready = 1;
+    for (size_t j = 0; j < count; j++) {
+        if (!edges[i * count + j]) continue;
+        if (members[j].state == MEMBER_FAILED || members[j].state == MEMBER_SKIPPED) return -1;
+        if (members[j].state != MEMBER_SUCCEEDED) ready = 0;
+    }
+    return ready;
+}
+
+// 读取成员之间的依赖并求拓扑顺序, 有循环依赖时报告涉及的成员
+int workspace_plan(const struct string_list* dirs, bool* edges, size_t* order) {
+    size_t count = dirs->count;
+    if (!load_workspace_edges(dirs, edges)) return 0;
+    size_t ordered = workspace_order(edges, count, order);
+    if (ordered == count) return 1;
+    fprintf(stderr, "错误: 工作区成员之间存在循环依赖:");
+    for (size_t i = 0; i < count; i++) {
+        bool placed = false;
+        for (size_t k = 0; k < ordered && !placed; k++) placed = order[k] == i;
+        if (!placed) fprintf(stderr, " %s", dirs->items[i]);
+    }
+    fprintf(stderr, "\n");
+    return 0;
+}
+
+// 在工作区的每个成员中运行 cbuild <command> <参数>, 成员在它依赖的成员成功后启动;
+// build命令的并行任务数在同时运行的成员之间平分
+uint8_t run_workspace_members(int argc, char* argv[], const char* self, const struct string_list* dirs,
+                              const bool* edges, const size_t* order, struct workspace_member* members) {
+    size_t count = dirs->count;
+    bool build = !strcmp(argv[1], "build");
+    struct string_list args = {0};
+    struct string_list prefixes = {0};
+    // 并行任务数: 命令行的-j, 否则按工作区根目录的[build]选项自动计算
+    int jobs = 0;
+    string_list_push(&args, self);
+    string_list_push(&args, argv[1]);
+    for (int i = 2; i < argc; i++) {
+        if (build && (!strcmp(argv[i], "-j") || !strcmp(argv[i], "--jobs")) && i + 1 < argc) {
+            jobs = atoi(argv[++i]);
+        }
+        else if (build && !strncmp(argv[i], "-j", 2) && atoi(argv[i] + 2) > 0) {
+            jobs = atoi(argv[i] + 2);
+        }
+        else {
+            string_list_push(&args, argv[i]);
+        }
+    }
+    size_t max_parallel = count < WORKSPACE_MAX_PARALLEL ? count : WORKSPACE_MAX_PARALLEL;
+    if (build) {
+        if (jobs <= 0) {
+            struct build_options root_opts;
+            load_build_options(&root_opts, NULL);
+            jobs = compute_job_count(&root_opts);
+            free_build_options(&root_opts);
+        }
+        if ((size_t)jobs < max_parallel) max_parallel = (size_t)jobs;
+        int member_jobs = jobs / (int)max_parallel;
+        string_list_push(&args, "-j");
+        string_list_pushf(&args, "%d", member_jobs);
+        printf("工作区: %zu 个成员, 最多同时构建 %zu 个, 每个成员 %d 个并行任务\n", count, max_parallel, member_jobs);
+    }
+
+    // 编译器缓存按相对于工作区根目录的路径计算缓存键, 成员之间共享相同源文件和头文件的缓存结果
+    char root[MAX_PATH_LEN];
+    if (!getenv("CCACHE_BASEDIR") && getcwd(root, sizeof(root))) {
+#if defined(PLATFORM_WINDOWS)
+        _putenv_s("CCACHE_BASEDIR", root);
+#else
+        setenv("CCACHE_BASEDIR", root, 1);
+#endif
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        string_list_pushf(&prefixes, "[%s] ", dirs->items[i]);
+    }
+    for (size_t i = 0; i < count; i++) {
+        members[i].dir = dirs->items[i];
+        members[i].argv = args.items;
+        members[i].opts.cwd = dirs->items[i];
+        members[i].opts.prefix = prefixes.items[i];
+    }
+
+    int64_t start_us = now_us();
+#if defined(PLATFORM_WINDOWS)
+    // Windows下按拓扑顺序逐个运行
+    for (size_t k = 0; k < count; k++) {
+        struct workspace_member* member = &members[order[k]];
+        if (workspace_member_ready(members, edges, count, order[k]) < 0) {
+            member->state = MEMBER_SKIPPED;
+            continue;
+        }
+        member->start_us = now_us();
+        bool ok = spawn_process(member->argv, &member->opts, &member->child) &&
+                  wait_process(&member->child, member->argv, &member->opts);
+        member->state = ok ? MEMBER_SUCCEEDED : MEMBER_FAILED;
+        member->end_us = now_us();
+    }
+#else
+    pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+    pthread_cond_t done = PTHREAD_COND_INITIALIZER;
+    pthread_mutex_lock(&lock);
+    for (;;) {
+        size_t running = 0;
+        size_t finished = 0;
+        for (size_t i = 0; i < count; i++) {
+            if (members[i].state == MEMBER_RUNNING) running++;
+            else if (members[i].state != MEMBER_PENDING) finished++;
+        }
+        // 按拓扑顺序启动就绪的成员, 依赖的成员失败时跳过
+        for (size_t k = 0; k < count && running < max_parallel; k++) {
+            struct workspace_member* member = &members[order[k]];
+            if (member->state != MEMBER_PENDING) continue;
+            int ready = workspace_member_ready(members, edges, count, order[k]);
+            if (ready < 0) {
+                member->state = MEMBER_SKIPPED;
+                finished++;
+                continue;
+            }
+            if (!ready) continue;
+            member->start_us = now_us();
+            member->lock = &lock;
+            member->done = &done;
+            if (!spawn_process(member->argv, &member->opts, &member->child)) {
+                member->state = MEMBER_FAILED;
+                member->end_us = now_us();
+                finished++;
+                continue;
+            }
+            member->state = MEMBER_RUNNING;
+            running++;
+            member->has_thread = pthread_create(&member->thread, NULL, workspace_wait_thread, member) == 0;
+            if (!member->has_thread) {
+                // 无法创建线程时在当前线程等待
+                pthread_mutex_unlock(&lock);
+                workspace_wait_thread(member);
+                pthread_mutex_lock(&lock);
+            }
+        }
+        if (finished == count || running == 0) break;
+        pthread_cond_wait(&done, &lock);
+    }
+    pthread_mutex_unlock(&lock);
+    for (size_t i = 0; i < count; i++) {
+        if (members[i].has_thread) pthread_join(members[i].thread, NULL);
+    }
+#endif
+
+    printf("\n工作区%s结果:\n", build ? "构建" : "初始化");
+    uint8_t result = EXIT_SUCCESS;
+    for (size_t k = 0; k < count; k++) {
+        const struct workspace_member* member = &members[order[k]];
+        if (member->state == MEMBER_SUCCEEDED) {
+            printf("  %-24s 成功   %8.2f s\n", member->dir, (member->end_us - member->start_us) / 1e6);
+            continue;
+        }
+        result = EXIT_FAILURE;
+        if (member->state == MEMBER_FAILED) {
+            printf("  %-24s 失败   %8.2f s\n", member->dir, (member->end_us - member->start_us) / 1e6);
+        } 
+        else {
+            printf("  %-24s 跳过   (依赖的成员未成功)\n", member->dir);
+        }
+    }
+    printf("总耗时 %.2f s\n", (now_us() - start_us) / 1e6);
+
+    string_list_free(&args);
+    string_list_free(&prefixes);
+    return result;
+}
+
+// 在工作区根目录运行的build和init转到各成员中运行
+uint8_t workspace_command(int argc, char* argv[], const struct string_list* dirs) {
+    if (dirs->count == 0) {
+        fprintf(stderr, "错误: [workspace]的members为空\n");
+        return EXIT_FAILURE;
+    }
+    char self[MAX_PATH_LEN];
+    if (!self_executable_path(argv[0], self, sizeof(self))) {
+        fprintf(stderr, "错误: 无法确定cbuild的路径\n");
+        return EXIT_FAILURE;
+    }
+    bool* edges = calloc(dirs->count * dirs->count + 1, sizeof(*edges));
+    size_t* order = calloc(dirs->count + 1, sizeof(*order));
+    struct workspace_member* members = calloc(dirs->count + 1, sizeof(*members));
+    uint8_t result = EXIT_FAILURE;
+    if (!edges || !order || !members) {
+        fprintf(stderr, "内存不足\n");
+    } 
+    else if (workspace_plan(dirs, edges, order)) {
+        result = run_workspace_members(argc, argv, self, dirs, edges, order, members);
+    }
+    free(edges);
+    free(order);
+    free(members);
+    return result;
+}
+
+// watch: 监视源文件和CMake.toml, 修改停止一段时间后只运行需要的步骤:
+// CMake.toml修改时重新生成CMakeLists.txt再构建, 源文件修改时增量构建, 构建成功后可以运行一个命令
+#define WATCH_POLL_MS 500                 // 没有inotify时轮询修改时间的间隔
+#define WATCH_CANCEL_TIMEOUT_US 3000000   // 取消时等待子进程退出的时间, 超时后强制终止
+
+enum watch_step { WATCH_IDLE, WATCH_INIT, WATCH_BUILD, WATCH_RUN };
+
+// 监视的目录
+struct watch_dir {
+    char* path;
+    bool recursive;   // 同时监视子目录
+    bool manifest;    // 目录中的CMake.toml是项目清单
+    bool output;      // 构建输出目录(build、bin、lib): 其中的任何修改都记为输出变化
+};
+
+struct watch_context {
+    struct watch_dir* roots;      // 项目根目录、src、include以及sources模式所在的目录
+    size_t root_count;
+    struct watch_dir* watches;    // inotify: 按watch描述符索引
+    size_t watch_capacity;
+    struct string_list excluded;  // 构建目录
+    int fd;                       // inotify描述符, 轮询时为-1
+    uint64_t manifest_hash;       // 轮询: CMake.toml的修改时间
+    uint64_t source_hash;         // 轮询: 源文件的路径和修改时间
+    uint64_t output_hash;         // 轮询: 输出目录中文件的路径和修改时间
+    bool manifest_changed;
+    bool sources_changed;
+    bool outputs_changed;
+    int64_t last_event_us;
+};
+
+// 正在运行的步骤
+struct watch_session {
+    char* const* init_argv;
+    char* const* build_argv;
+    char* const* run_argv;        // 没有配置命令时为NULL
+    enum watch_step step;
+    struct child_process child;
+    int64_t start_us;
+};
+
+static volatile sig_atomic_t watch_interrupted = 0;
+
+void watch_interrupt(int sig) {
+    (void)sig;
+    watch_interrupted = 1;
+}
+
+// 只有源文件和头文件触发构建, 编辑器的临时文件和备份文件被忽略
+bool watch_is_source_file(const char* name) {
+    static const char* const extensions[] = {
+        ".c", ".cc", ".cpp", ".cxx", ".c++", ".h", ".hh", ".hpp", ".hxx", ".h++",
+        ".inl", ".ipp", ".tpp", ".inc", ".ixx", ".cppm", NULL
+    };
+    if (name[0] == '.') return false;
+    for (size_t i = 0; extensions[i]; i++) {
+        if (has_suffix(name, extensions[i])) return true;
+    }
+    return false;
+}
+
+// 拼接目录和文件名, 目录为"."时只保留文件名
+void watch_join(char* out, size_t out_size, const char* dir, const char* name) {
+    if (!strcmp(dir, ".")) snprintf(out, out_size, "%s", name);
+    else snprintf(out, out_size, "%s%c%s", dir, PATH_SEP, name);
+}
+
+// 隐藏目录和构建目录(含有CMakeCache.txt)不监视
+bool watch_skip_dir(const struct watch_context* ctx, const char* path, const char* name) {
+    if (name[0] == '.') return true;
+    for (size_t i = 0; i < ctx->excluded.count; i++) {
+        if (!strcmp(ctx->excluded.items[i], path)) return true;
+    }
+    char cache_path[MAX_PATH_LEN + 16];
+    struct stat st;
+    snprintf(cache_path, sizeof(cache_path), "%s%cCMakeCache.txt", path, PATH_SEP);
+    return stat(cache_path, &st) == 0;
+}
+
+// 输出目录中只跳过隐藏目录(回收目录); 指向目录的符号链接不进入, include/<lib> -> . 会无限递归
+bool watch_skip_child(const struct watch_context* ctx, const char* path, const char* name, bool output) {
+    if (is_symlink(path)) return true;
+    return output ? name[0] == '.' : watch_skip_dir(ctx, path, name);
+}
+
+void watch_exclude(struct watch_context* ctx, const char* path) {
+    for (size_t i = 0; i < ctx->excluded.count; i++) {
+        if (!strcmp(ctx->excluded.items[i], path)) return;
+    }
+    string_list_push(&ctx->excluded, path);
+}
+
+void watch_add_root(struct watch_context* ctx, const char* path, bool recursive, bool manifest, bool output) {
+    struct stat st;
+    if (stat(path, &st) != 0 || !S_ISDIR(st.st_mode)) return;
+    for (size_t i = 0; i < ctx->root_count; i++) {
+        if (!strcmp(ctx->roots[i].path, path)) {
+            ctx->roots[i].recursive |= recursive;
+            ctx->roots[i].manifest |= manifest;
+            ctx->roots[i].output |= output;
+            return;
+        }
+    }
+    struct watch_dir* roots = realloc(ctx->roots, (ctx->root_count + 1) * sizeof(*roots));
+    if (!roots) return;
+    ctx->roots = roots;
+    roots[ctx->root_count].path = strdup(path);
+    roots[ctx->root_count].recursive = recursive;
+    roots[ctx->root_count].manifest = manifest;
+    roots[ctx->root_count].output = output;
+    if (roots[ctx->root_count].path) ctx->root_count++;
+}
+
+// sources模式中通配符之前的目录部分, 含有**或通配符之后还有子目录时监视整个子树
+void watch_add_pattern(struct watch_context* ctx, const char* base, const char* pattern) {
+    const char* wildcard = pattern + strcspn(pattern, "*?[");
+    const char* slash = NULL;
+    for (const char* c = pattern; c < wildcard; c++) {
+        if (*c == '/' || *c == '\\') slash = c;
+    }
+    bool recursive = strchr(wildcard, '/') != NULL || strstr(wildcard, "**") != NULL;
+    char dir[MAX_PATH_LEN];
+    char path[MAX_PATH_LEN];
+    if (!slash) {
+        snprintf(path, sizeof(path), "%s", base);
+    }
+    else {
+        snprintf(dir, sizeof(dir), "%.*s", (int)(slash - pattern), pattern);
+        if (is_absolute_path(dir)) snprintf(path, sizeof(path), "%s", dir);
+        else watch_join(path, sizeof(path), base, dir);
+    }
+    watch_add_root(ctx, path, recursive, false, false);
+}
+
+// 一个项目的监视目录: 项目根目录(CMake.toml和根目录中的源文件)、src、include和sources模式的目录
+// opts为NULL时从base中读取CMake.toml
+void watch_collect_project(struct watch_context* ctx, const char* base, const char* build_dir, const struct build_options* opts) {
+    char path[MAX_PATH_LEN];
+    watch_add_root(ctx, base, false, true, false);
+    watch_join(path, sizeof(path), base, "src");
+    watch_add_root(ctx, path, true, false, false);
+    watch_join(path, sizeof(path), base, "include");
+    watch_add_root(ctx, path, true, false, false);
+    watch_join(path, sizeof(path), base, build_dir);
+    watch_exclude(ctx, path);
+
+    // CMake.toml按当前目录读取
+    struct build_options loaded;
+    if (!opts) {
+        char saved_cwd[MAX_PATH_LEN];
+        if (!getcwd(saved_cwd, sizeof(saved_cwd)) || CHDIR(base) != 0) return;
+        load_build_options(&loaded, NULL);
+        if (CHDIR(saved_cwd) != 0) perror("恢复工作目录失败");
+    }
+    const struct build_options* project = opts ? opts : &loaded;
+    for (size_t i = 0; i < project->sources.count; i++) {
+        watch_add_pattern(ctx, base, project->sources.items[i]);
+    }
+    for (size_t t = 0; t < project->targets.count; t++) {
+        for (size_t i = 0; i < project->targets.items[t].sources.count; i++) {
+            watch_add_pattern(ctx, base, project->targets.items[t].sources.items[i]);
+        }
+    }
+    if (!opts) free_build_options(&loaded);
+}
+
+void watch_note_change(struct watch_context* ctx, bool manifest) {
+    if (manifest) ctx->manifest_changed = true;
+    else ctx->sources_changed = true;
+    ctx->last_event_us = now_us();
+}
+
+// 没有inotify时比较修改时间; 每个文件的哈希相加, 与目录的读取顺序无关
+uint64_t watch_hash_dir(const struct watch_context* ctx, const char* path, bool recursive, bool output) {
+    uint64_t sum = 0;
+    DIR* dir = opendir(path);
+    if (!dir) return sum;
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL) {
+        char child[MAX_PATH_LEN];
+        struct stat st;
+        watch_join(child, sizeof(child), path, entry->d_name);
+        if (entry->d_name[0] == '.' || stat(child, &st) != 0) continue;
+        if (S_ISDIR(st.st_mode)) {
+            if (recursive && !watch_skip_child(ctx, child, entry->d_name, output)) sum += watch_hash_dir(ctx, child, true, output);
+        }
+        else if (output || watch_is_source_file(entry->d_name)) {
+            int64_t mtime = file_mtime_us(child);
+            sum += hash_bytes(hash_string(FNV1A_OFFSET, child), &mtime, sizeof(mtime));
+        }
+    }
+    closedir(dir);
+    return sum;
+}
+
+void watch_poll_changes(struct watch_context* ctx) {
+    uint64_t manifest_hash = 0;
+    uint64_t source_hash = 0;
+    uint64_t output_hash = 0;
+    for (size_t i = 0; i < ctx->root_count; i++) {
+        const struct watch_dir* root = &ctx->roots[i];
+        if (root->output) {
+            output_hash += watch_hash_dir(ctx, root->path, true, true);
+            continue;
+        }
+        if (root->manifest) {
+            char path[MAX_PATH_LEN];
+            watch_join(path, sizeof(path), root->path, "CMake.toml");
+            int64_t mtime = file_mtime_us(path);
+            manifest_hash += hash_bytes(hash_string(FNV1A_OFFSET, path), &mtime, sizeof(mtime));
+        }
+        source_hash += watch_hash_dir(ctx, root->path, root->recursive, false);
+    }
+    if (manifest_hash != ctx->manifest_hash) watch_note_change(ctx, true);
+    if (source_hash != ctx->source_hash) watch_note_change(ctx, false);
+    if (output_hash != ctx->output_hash) ctx->outputs_changed = true;
+    ctx->manifest_hash = manifest_hash;
+    ctx->source_hash = source_hash;
+    ctx->output_hash = output_hash;
+}
+
+#if defined(PLATFORM_LINUX)
+#define WATCH_EVENTS (IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_ONLYDIR)
+
+// 监视目录, recursive时同时监视所有子目录
+void watch_add_tree(struct watch_context* ctx, const char* path, bool recursive, bool manifest, bool output) {
+    int wd = inotify_add_watch(ctx->fd, path, WATCH_EVENTS);
+    if (wd < 0) {
+        fprintf(stderr, "无法监视 %s: %s\n", path, strerror(errno));
+        return;
+    }
+    if ((size_t)wd >= ctx->watch_capacity) {
+        size_t capacity = ctx->watch_capacity ? ctx->watch_capacity : 64;
+        while (capacity <= (size_t)wd) capacity *= 2;
+        struct watch_dir* watches = realloc(ctx->watches, capacity * sizeof(*watches));
+        if (!watches) return;
+        memset(watches + ctx->watch_capacity, 0, (capacity - ctx->watch_capacity) * sizeof(*watches));
+        ctx->watches = watches;
+        ctx->watch_capacity = capacity;
+    }
+    struct watch_dir* watch = &ctx->watches[wd];
+    if (!watch->path) watch->path = strdup(path);
+    watch->recursive |= recursive;
+    watch->manifest |= manifest;
+    watch->output |= output;
+    if (!recursive) return;
+
+    DIR* dir = opendir(path);
+    if (!dir) return;
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL) {
+        char child[MAX_PATH_LEN];
+        struct stat st;
+        watch_join(child, sizeof(child), path, entry->d_name);
+        if (stat(child, &st) == 0 && S_ISDIR(st.st_mode) && !watch_skip_child(ctx, child, entry->d_name, output)) {
+            watch_add_tree(ctx, child, true, false, output);
+        }
+    }
+    closedir(dir);
+}
+
+// 读取所有待处理的inotify事件
+void watch_read_events(struct watch_context* ctx) {
+    _Alignas(struct inotify_event) char buffer[64 * 1024];
+    ssize_t n;
+    while ((n = read(ctx->fd, buffer, sizeof(buffer))) > 0) {
+        for (char* p = buffer; p < buffer + n; ) {
+            const struct inotify_event* event = (const struct inotify_event*)p;
+            p += sizeof(*event) + event->len;
+            if (event->mask & IN_Q_OVERFLOW) {
+                // 事件队列溢出, 无法确定修改了哪些文件
+                watch_note_change(ctx, false);
+                continue;
+            }
+            if (event->wd < 0 || (size_t)event->wd >= ctx->watch_capacity || !ctx->watches[event->wd].path) continue;
+            struct watch_dir* watch = &ctx->watches[event->wd];
+            if (event->mask & IN_IGNORED) {
+                // 目录已被删除
+                free(watch->path);
+                memset(watch, 0, sizeof(*watch));
+                continue;
+            }
+            if (event->len == 0) continue;
+            if (event->mask & IN_ISDIR) {
+                char path[MAX_PATH_LEN];
+                bool output = watch->output;
+                watch_join(path, sizeof(path), watch->path, event->name);
+                if (!watch->recursive || watch_skip_child(ctx, path, event->name, output)) continue;
+                // 新建或移入的子目录加入监视, 其中的源文件也需要构建
+                if (event->mask & (IN_CREATE | IN_MOVED_TO)) watch_add_tree(ctx, path, true, false, output);
+                if (output) ctx->outputs_changed = true;
+                else watch_note_change(ctx, false);
+            }
+            else if (watch->output) {
+                if (event->name[0] != '.') ctx->outputs_changed = true;
+            }
+            else if (watch->manifest && !strcmp(event->name, "CMake.toml")) {
+                watch_note_change(ctx, true);
+            }
+            else if (watch_is_source_file(event->name)) {
+                watch_note_change(ctx, false);
+            }
+        }
+    }
+}
+#endif
+
+const char* watch_step_name(enum watch_step step) {
+    return step == WATCH_INIT ? "重新生成" : step == WATCH_BUILD ? "构建" : "命令";
+}
+
+// 一步结束后的下一步: 重新生成成功后构建, 构建成功后运行命令
+enum watch_step watch_next_step(const struct watch_session* session, enum watch_step step, bool ok) {
+    if (!ok) return WATCH_IDLE;
+    if (step == WATCH_INIT) return WATCH_BUILD;
+    if (step == WATCH_BUILD && session->run_argv) return WATCH_RUN;
+    return WATCH_IDLE;
+}
+
+void watch_report(const struct watch_session* session, enum watch_step step, bool ok) {
+    if (step != WATCH_INIT || !ok) {
+        printf("\n[watch] %s%s (%.2f s)\n", watch_step_name(step), ok ? "成功" : "失败", (now_us() - session->start_us) / 1e6);
+    }
+    if (watch_next_step(session, step, ok) == WATCH_IDLE) {
+        printf("[watch] 等待修改...\n");
+    }
+    fflush(stdout);
+}
+
+#if !defined(PLATFORM_WINDOWS)
+// 在新的进程组中启动一步, 取消时可以终止其中的CMake、make和编译器
+void watch_start(struct watch_session* session, enum watch_step step) {
+    char* const* argv = step == WATCH_INIT ? session->init_argv : step == WATCH_BUILD ? session->build_argv : session->run_argv;
+    struct run_options opts = {0};
+    opts.process_group = true;
+    session->start_us = now_us();
+    session->step = spawn_process(argv, &opts, &session->child) ? step : WATCH_IDLE;
+    if (session->step == WATCH_IDLE) watch_report(session, step, false);
+}
+
+// 终止子进程所在的整个进程组并等待进程组组长退出
+void cancel_process_group(struct child_process* child) {
+    kill(-(pid_t)child->pid, SIGTERM);
+    int64_t deadline = now_us() + WATCH_CANCEL_TIMEOUT_US;
+    int status;
+    pid_t result;
+    while ((result = waitpid((pid_t)child->pid, &status, WNOHANG)) == 0 || (result == -1 && errno == EINTR)) {
+        if (now_us() > deadline) {
+            kill(-(pid_t)child->pid, SIGKILL);
+            while (waitpid((pid_t)child->pid, &status, 0) == -1 && errno == EINTR) {}
+            break;
+        }
+        poll(NULL, 0, 20);
+    }
+    child->pid = -1;
+}
+
+// 子进程结束时报告结果并启动下一步
+void watch_reap(struct watch_session* session) {
+    int status;
+    pid_t result = waitpid((pid_t)session->child.pid, &status, WNOHANG);
+    if (result == 0 || (result == -1 && errno == EINTR)) return;
+    bool ok = result != -1 && check_exit_status(&session->child, status, NULL);
+    enum watch_step finished = session->step;
+    session->step = WATCH_IDLE;
+    watch_report(session, finished, ok);
+    enum watch_step next = watch_next_step(session, finished, ok);
+    if (next != WATCH_IDLE) watch_start(session, next);
+}
+#endif
+
+void watch_free(struct watch_context* ctx) {
+    for (size_t i = 0; i < ctx->root_count; i++) free(ctx->roots[i].path);
+    for (size_t i = 0; i < ctx->watch_capacity; i++) free(ctx->watches[i].path);
+    free(ctx->roots);
+    free(ctx->watches);
+    string_list_free(&ctx->excluded);
+#if defined(PLATFORM_LINUX)
+    if (ctx->fd >= 0) close(ctx->fd);
+#endif
+}
+
+// 监视修改并自动构建, 直到Ctrl-C
+void watch_loop(struct watch_context* ctx, struct watch_session* session, int debounce_ms) {
+    bool started = false;
+    while (!watch_interrupted) {
+        int64_t now = now_us();
+        int64_t due = ctx->last_event_us + (int64_t)debounce_ms * 1000;
+        bool pending = ctx->manifest_changed || ctx->sources_changed;
+        if (pending && now >= due) {
+            enum watch_step step = ctx->manifest_changed ? WATCH_INIT : WATCH_BUILD;
+            ctx->manifest_changed = false;
+            ctx->sources_changed = false;
+            printf("\n[watch] %s\n", !started ? "开始构建" : step == WATCH_INIT ? "CMake.toml已修改, 重新生成并构建" : "源文件已修改, 增量构建");
+            started = true;
+#if defined(PLATFORM_WINDOWS)
+            // Windows下每一步同步运行, 运行期间的修改在结束后处理
+            session->start_us = now_us();
+            bool ok = step != WATCH_INIT || run_process(session->init_argv, NULL);
+            if (!ok) {
+                watch_report(session, WATCH_INIT, false);
+                continue;
+            }
+            session->start_us = now_us();
+            ok = run_process(session->build_argv, NULL);
+            watch_report(session, WATCH_BUILD, ok);
+            if (ok && session->run_argv) {
+                session->start_us = now_us();
+                watch_report(session, WATCH_RUN, execute_command(session->run_argv[0]));
+            }
+#else
+            if (session->step != WATCH_IDLE) {
+                printf("[watch] 取消正在运行的%s\n", watch_step_name(session->step));
+                cancel_process_group(&session->child);
+                session->step = WATCH_IDLE;
+            }
+            fflush(stdout);
+            watch_start(session, step);
+#endif
+            continue;
+        }
+
+        // 有子进程运行时定期检查是否结束, 否则等待文件修改
+        int timeout = -1;
+#if !defined(PLATFORM_WINDOWS)
+        if (session->step != WATCH_IDLE) {
+            watch_reap(session);
+            timeout = 50;
+        }
+#endif
+        if (pending) {
+            int remaining = (int)((due - now) / 1000) + 1;
+            if (timeout < 0 || remaining < timeout) timeout = remaining;
+        }
+        if (ctx->fd < 0 && (timeout < 0 || timeout > WATCH_POLL_MS)) timeout = WATCH_POLL_MS;
+#if defined(PLATFORM_WINDOWS)
+        Sleep((DWORD)timeout);
+#else
+        struct pollfd pfd = { ctx->fd, POLLIN, 0 };
+        int ready = poll(&pfd, ctx->fd >= 0 ? 1 : 0, timeout);
+#if defined(PLATFORM_LINUX)
+        if (ready > 0) watch_read_events(ctx);
+#else
+        (void)ready;
+#endif
+#endif
+        if (ctx->fd < 0) watch_poll_changes(ctx);
+    }
+
+#if !defined(PLATFORM_WINDOWS)
+    if (session->step != WATCH_IDLE) cancel_process_group(&session->child);
+#endif
+}
+
+uint8_t watch_command(int argc, char* argv[]) {
+    char self[MAX_PATH_LEN];
+    if (!self_executable_path(argv[0], self, sizeof(self))) {
+        fprintf(stderr, "错误: 无法确定cbuild的路径\n");
+        return EXIT_FAILURE;
+    }
+    struct build_options opts;
+    if (!load_build_options(&opts, NULL)) {
+        free_build_options(&opts);
+        return EXIT_FAILURE;
+    }
+    char run_command[MAX_PATH_LEN];
+    snprintf(run_command, sizeof(run_command), "%s", opts.watch_run);
+    int debounce_ms = opts.watch_debounce_ms;
+    free_build_options(&opts);
+
+    // --run和--debounce由watch处理, 其余参数传给每次的build
+    char build_dir[MAX_PATH_LEN] = "build";
+    struct string_list build_args = {0};
+    struct string_list init_args = {0};
+    struct string_list run_args = {0};
+    string_list_push(&build_args, self);
+    string_list_push(&build_args, "build");
+    string_list_push(&init_args, self);
+    string_list_push(&init_args, "init");
+    for (int i = 2; i < argc; i++) {
+        if (!strcmp(argv[i], "--run")) {
+            if (i + 1 >= argc) {
+                fprintf(stderr, "错误: --run 需要一个命令\n");
+                string_list_free(&build_args);
+                string_list_free(&init_args);
+                return EXIT_FAILURE;
+            }
+            snprintf(run_command, sizeof(run_command), "%s", argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--debounce")) {
+            if (i + 1 >= argc || !isdigit((unsigned char)argv[i + 1][0])) {
+                fprintf(stderr, "错误: --debounce 需要一个毫秒数\n");
+                string_list_free(&build_args);
+                string_list_free(&init_args);
+                return EXIT_FAILURE;
+            }
+            debounce_ms = atoi(argv[++i]);
+        }
+        else {
+            if ((!strcmp(argv[i], "-b") || !strcmp(argv[i], "--build-dir")) && i + 1 < argc) {
+                snprintf(build_dir, sizeof(build_dir), "%s", argv[i + 1]);
+            }
+            string_list_push(&build_args, argv[i]);
+        }
+    }
+#if defined(PLATFORM_WINDOWS)
+    string_list_push(&run_args, run_command);
+#else
+    string_list_push(&run_args, "/bin/sh");
+    string_list_push(&run_args, "-c");
+    string_list_push(&run_args, run_command);
+#endif
+
+    // 工作区根目录: 监视每个成员, 构建仍由build按工作区运行
+    struct watch_context ctx;
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.fd = -1;
+    struct string_list members = {0};
+    bool workspace = load_workspace_members(&members);
+    if (workspace) {
+        watch_add_root(&ctx, ".", false, true, false);
+        for (size_t i = 0; i < members.count; i++) {
+            watch_collect_project(&ctx, members.items[i], build_dir, NULL);
+        }
+    }
+    else {
+        watch_collect_project(&ctx, ".", build_dir, NULL);
+    }
+    string_list_free(&members);
+
+#if defined(PLATFORM_LINUX)
+    ctx.fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (ctx.fd < 0) perror("inotify不可用,改为轮询修改时间");
+    for (size_t i = 0; ctx.fd >= 0 && i < ctx.root_count; i++) {
+        watch_add_tree(&ctx, ctx.roots[i].path, ctx.roots[i].recursive, ctx.roots[i].manifest, ctx.roots[i].output);
+    }
+#endif
+    if (ctx.fd < 0) watch_poll_changes(&ctx);
+    // 启动时先构建一次, 还没有CMakeLists.txt时先生成
+    struct stat st;
+    ctx.manifest_changed = !workspace && stat("CMakeLists.txt", &st) != 0;
+    ctx.sources_changed = true;
+    ctx.last_event_us = 0;
+    printf("[watch] 监视 %zu 个目录(%s), 修改后自动构建%s%s, 按Ctrl-C退出\n", ctx.root_count,
+           ctx.fd >= 0 ? "inotify" : "轮询", run_command[0] ? "并运行: " : "", run_command);
+
+    struct watch_session session;
+    memset(&session, 0, sizeof(session));
+    session.init_argv = init_args.items;
+    session.build_argv = build_args.items;
+    session.run_argv = run_command[0] ? run_args.items : NULL;
+
+#if defined(PLATFORM_WINDOWS)
+    watch_loop(&ctx, &session, debounce_ms);
+#else
+    // 子进程在自己的进程组中, 终端的Ctrl-C只发给watch, 由watch终止正在运行的步骤
+    struct sigaction action, previous_int, previous_term;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = watch_interrupt;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGINT, &action, &previous_int);
+    sigaction(SIGTERM, &action, &previous_term);
+    watch_loop(&ctx, &session, debounce_ms);
+    sigaction(SIGINT, &previous_int, NULL);
+    sigaction(SIGTERM, &previous_term, NULL);
+#endif
+    printf("\n[watch] 已退出\n");
+
+    watch_free(&ctx);
+    string_list_free(&build_args);
+    string_list_free(&init_args);
+    string_list_free(&run_args);
+    return EXIT_SUCCESS;
+}
+
+#if !defined(PLATFORM_WINDOWS)
+// 构建守护进程: 在项目根目录的Unix套接字上监听, 常驻内存保存解析好的CMake.toml和文件监视状态.
+// 自上次成功构建以来源文件、CMake.toml和构建输出都没有修改, 参数和环境变量也相同时直接返回,
+// 不再启动CMake和生成器; 否则在fork出的子进程中使用已解析的配置构建, 输出通过套接字转发给客户端
+#define DAEMON_SOCKET_FILE ".cbuild-daemon.sock"
+#define DAEMON_MAX_REQUEST (16 * 1024 * 1024)
+
+// 守护进程发给客户端的消息: 1字节类型 + 4字节长度 + 内容
+#define DAEMON_FRAME_OUTPUT 'O'   // 输出
+#define DAEMON_FRAME_EXIT   'X'   // 退出代码, 最后一条消息
+
+struct daemon_state {
+    char self[MAX_PATH_LEN];
+    int listen_fd;
+    struct watch_context ctx;
+    struct string_list build_dirs;  // 请求中用到的构建目录
+    bool workspace;
+    struct string_list members;
+    struct build_options opts;      // 已解析的CMake.toml
+    struct dependency_list deps;
+    bool loaded;
+    bool manifest_ok;               // 上次读取CMake.toml成功
+    bool clean;                     // 上次构建成功, 之后没有任何修改
+    uint64_t clean_key;             // 上次成功构建的参数和环境变量
+    size_t builds;
+    size_t skipped;
+};
+
+// 对端关闭连接时返回0, 不产生SIGPIPE
+int daemon_write_all(int fd, const void* data, size_t length) {
+    const char* p = data;
+    while (length > 0) {
+        ssize_t n = send(fd, p, length, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return 0;
+        p += n;
+        length -= (size_t)n;
+    }
+    return 1;
+}
+
+int daemon_read_all(int fd, void* data, size_t length) {
+    char* p = data;
+    while (length > 0) {
+        ssize_t n = read(fd, p, length);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return 0;
+        p += n;
+        length -= (size_t)n;
+    }
+    return 1;
+}
+
+int daemon_send_frame(int fd, char type, const void* data, uint32_t length) {
+    char header[5];
+    header[0] = type;
+    memcpy(header + 1, &length, sizeof(length));
+    return daemon_write_all(fd, header, sizeof(header)) && daemon_write_all(fd, data, length);
+}
+
+int daemon_send_exit(int fd, int code) {
+    int32_t value = code;
+    return daemon_send_frame(fd, DAEMON_FRAME_EXIT, &value, sizeof(value));
+}
+
+void daemon_send_text(int fd, const char* format, ...) {
+    char text[BUFFER_SIZE * 2];
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(text, sizeof(text), format, args);
+    va_end(args);
+    if (length < 0) return;
+    if ((size_t)length >= sizeof(text)) length = sizeof(text) - 1;
+    daemon_send_frame(fd, DAEMON_FRAME_OUTPUT, text, (uint32_t)length);
+}
+
+// 套接字使用相对路径, 不受sockaddr_un路径长度的限制
+int daemon_connect() {
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", DAEMON_SOCKET_FILE);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// 请求: 4字节长度 + 以'\0'分隔的字符串: 命令、参数个数、参数、环境变量
+int daemon_send_request(int fd, const char* command, int arg_count, char* const* args, bool with_env) {
+    struct string_buffer request = {0};
+    string_buffer_append(&request, command, strlen(command) + 1);
+    string_buffer_appendf(&request, "%d", arg_count);
+    string_buffer_append(&request, "", 1);
+    for (int i = 0; i < arg_count; i++) {
+        string_buffer_append(&request, args[i], strlen(args[i]) + 1);
+    }
+    for (char** env = environ; with_env && *env; env++) {
+        string_buffer_append(&request, *env, strlen(*env) + 1);
+    }
+    uint32_t length = (uint32_t)request.length;
+    int ok = daemon_write_all(fd, &length, sizeof(length)) && daemon_write_all(fd, request.data, request.length);
+    string_buffer_free(&request);
+    return ok;
+}
+
+int daemon_read_request(int fd, struct string_list* items) {
+    uint32_t length;
+    if (!daemon_read_all(fd, &length, sizeof(length)) || length == 0 || length > DAEMON_MAX_REQUEST) return 0;
+    char* data = malloc(length);
+    if (!data || !daemon_read_all(fd, data, length) || data[length - 1] != '\0') {
+        free(data);
+        return 0;
+    }
+    for (size_t i = 0; i < length; i += strlen(data + i) + 1) {
+        string_list_push(items, data + i);
+    }
+    free(data);
+    return 1;
+}
+
+// 转发守护进程的输出, 返回退出代码, 连接中断时返回-1
+int daemon_receive(int fd) {
+    char header[5];
+    while (daemon_read_all(fd, header, sizeof(header))) {
+        uint32_t length;
+        memcpy(&length, header + 1, sizeof(length));
+        char* data = malloc(length + 1);
+        if (!data || !daemon_read_all(fd, data, length)) {
+            free(data);
+            return -1;
+        }
+        if (header[0] == DAEMON_FRAME_EXIT && length == sizeof(int32_t)) {
+            int32_t code;
+            memcpy(&code, data, sizeof(code));
+            free(data);
+            return code;
+        }
+        fwrite(data, 1, length, stdout);
+        fflush(stdout);
+        free(data);
     }
+    return -1;
+}
 
-    if(!project_name_set){
-        printf("未设置项目名称,使用默认名称%s\n",project_name);
-    }
-    printf("项目名称为 : %s\n",project_name);
-    printf("项目类型为 : %s (%s)\n",project_name, 
-           strcmp(project_type, "executable") == 0 ? "可执行文件" :
-           strcmp(project_type, "static") == 0 ? "静态库" : "动态库");
-    
-    // 显示命令行添加的依赖项
-    if(num_deps_cli > 0) {
-        printf("命令行添加的依赖项: ");
-        for(int i = 0; i < num_deps_cli; i++) {
-            printf("%s ", deps_from_cli[i]);
-        }
-        printf("\n");
+// build转发给当前目录中运行的守护进程; 没有守护进程时返回-1, 由调用方直接构建
+int daemon_forward_build(int argc, char* argv[]) {
+    struct stat st;
+    for (int i = 2; i < argc; i++) {
+        if (!strcmp(argv[i], "--no-daemon")) return -1;
     }
-    
-    if(!create_directory(project_name)){
+    if (stat(DAEMON_SOCKET_FILE, &st) != 0) return -1;
+    int fd = daemon_connect();
+    if (fd < 0) return -1;
+    printf("转发到守护进程 (%s)\n", DAEMON_SOCKET_FILE);
+    fflush(stdout);
+    int result = daemon_send_request(fd, "build", argc - 2, argv + 2, true) ? daemon_receive(fd) : -1;
+    close(fd);
+    if (result < 0) {
+        fprintf(stderr, "错误: 与守护进程的连接中断\n");
         return EXIT_FAILURE;
     }
+    return result;
+}
 
-    if(CHDIR(project_name)!=0){
-        perror("无法进入项目目录");
-        return EXIT_FAILURE;
+// 参数和环境变量的哈希; 环境变量按条目相加, 与顺序无关, 忽略shell自动维护的变量
+uint64_t daemon_request_key(char* const* args, size_t arg_count, char* const* env) {
+    static const char* const ignored[] = { "_=", "PWD=", "OLDPWD=", "SHLVL=", NULL };
+    uint64_t hash = FNV1A_OFFSET;
+    for (size_t i = 0; i < arg_count; i++) {
+        hash = hash_string(hash, args[i]);
     }
-
-    if (!create_directory("src") || 
-        !create_directory("include") || 
-        !create_directory("build")) {
-        return EXIT_FAILURE;
+    uint64_t env_sum = 0;
+    for (size_t i = 0; env[i]; i++) {
+        bool skip = false;
+        for (size_t k = 0; ignored[k] && !skip; k++) {
+            skip = !strncmp(env[i], ignored[k], strlen(ignored[k]));
+        }
+        if (!skip) env_sum += hash_string(FNV1A_OFFSET, env[i]);
     }
+    return hash_bytes(hash, &env_sum, sizeof(env_sum));
+}
 
-    // 创建CMake.toml文件（包含命令行依赖项）
-    if (!create_cmake_toml(project_name, project_type, deps_from_cli, num_deps_cli, add_precompile_headers)) {
-        return EXIT_FAILURE;
+// 把不在监视范围内的配置输入加入hash: 工具链、CMake.lock以及pkg-config依赖项的.pc文件
+// 与构建一样按客户端的环境变量(PATH、PKG_CONFIG_PATH等)查找
+uint64_t daemon_inputs_key(const struct daemon_state* state, uint64_t hash, const char* build_dir, char** env) {
+    char** saved = environ;
+    environ = env;
+    if (state->workspace) {
+        for (size_t i = 0; i < state->members.count; i++) {
+            hash = hash_configure_inputs(hash, state->members.items[i]);
+        }
     }
-    
-    // 解析CMake.toml获取依赖项（包括命令行添加的）
-    char deps[MAX_DEPS][MAX_PATH_LEN];
-    int num_deps = 0;
-    if (!parse_cmake_toml(project_name, project_type, deps, &num_deps, &add_precompile_headers)) {
-        printf("警告 : 未能完全解析CMake.toml,使用默认配置\n");
+    else {
+        hash = hash_configure_inputs(hash, NULL);
+        uint64_t deps_key = pkg_config_dependencies_key(&state->deps, build_dir);
+        hash = hash_bytes(hash, &deps_key, sizeof(deps_key));
     }
-    else if (num_deps > 0) {
-        printf("检测到依赖项: ");
-        for (int i = 0; i < num_deps; i++) {
-            printf("%s ", deps[i]);
+    environ = saved;
+    return hash;
+}
+
+// 这些参数每次都要实际运行(清理缓存、PGO训练、记录耗时)
+bool daemon_can_skip(char* const* args, size_t arg_count) {
+    for (size_t i = 0; i < arg_count; i++) {
+        if (!strcmp(args[i], "-C") || !strcmp(args[i], "--clean-cache") || !strcmp(args[i], "--trace") ||
+            !strcmp(args[i], "--pgo-generate") || !strcmp(args[i], "--pgo-use")) {
+            return false;
         }
-        printf("\n");
     }
+    return true;
+}
 
-    // 创建CMakeLists.txt文件（带依赖处理）
-    if(!create_cmakelists(project_name, project_type, deps, num_deps, add_precompile_headers)){
-        return EXIT_FAILURE;
+// 读取CMake.toml; 工作区根目录的构建由各成员的cbuild进程完成
+// 解析CMake.toml; 失败时manifest_ok为false, 构建改为在子进程中重新读取CMake.toml并报告错误
+int daemon_load(struct daemon_state* state) {
+    if (state->loaded) {
+        dependency_list_free(&state->deps);
+        free_build_options(&state->opts);
+        string_list_free(&state->members);
     }
-    
-    if (strcmp(project_type, "executable") == 0) {
-        if (!create_main_cpp_file(add_precompile_headers)) {
-            return EXIT_FAILURE;
+    memset(&state->deps, 0, sizeof(state->deps));
+    state->workspace = load_workspace_members(&state->members);
+    state->manifest_ok = load_build_options(&state->opts, state->workspace ? NULL : &state->deps);
+    state->loaded = true;
+    return state->manifest_ok;
+}
+
+// 输出目录: 构建目录以及项目根目录下的bin和lib
+void daemon_collect_outputs(struct daemon_state* state, const char* base) {
+    static const char* const outputs[] = { "bin", "lib", NULL };
+    char path[MAX_PATH_LEN];
+    for (size_t i = 0; i < state->build_dirs.count; i++) {
+        watch_join(path, sizeof(path), base, state->build_dirs.items[i]);
+        watch_add_root(&state->ctx, path, true, false, true);
+    }
+    for (size_t i = 0; outputs[i]; i++) {
+        watch_join(path, sizeof(path), base, outputs[i]);
+        watch_add_root(&state->ctx, path, true, false, true);
+    }
+}
+
+// 加入构建创建的输出目录, 只遍历尚未监视的根目录(首次创建或删除后重新创建);
+// 已监视目录中新建的子目录由watch_read_events加入
+void daemon_watch_outputs(struct daemon_state* state) {
+    if (state->workspace) {
+        for (size_t i = 0; i < state->members.count; i++) {
+            daemon_collect_outputs(state, state->members.items[i]);
         }
-    } 
+    }
     else {
-        if (!create_library_files(project_name,add_precompile_headers)) {
-            return EXIT_FAILURE;
+        daemon_collect_outputs(state, ".");
+        // 路径依赖的成员的库
+        for (size_t i = 0; i < state->deps.count; i++) {
+            const struct dependency* dep = &state->deps.items[i];
+            if (!dep->path) continue;
+            char lib_dir[MAX_PATH_LEN];
+            watch_join(lib_dir, sizeof(lib_dir), dep->path, "lib");
+            watch_add_root(&state->ctx, lib_dir, true, false, true);
         }
     }
-    if(add_precompile_headers){
-        if(!create_precompile_headers(add_precompile_headers)){
-            return EXIT_FAILURE;
+    for (size_t i = 1; i < state->build_dirs.count; i++) {
+        watch_exclude(&state->ctx, state->build_dirs.items[i]);
+    }
+#if defined(PLATFORM_LINUX)
+    for (size_t i = 0; state->ctx.fd >= 0 && i < state->ctx.root_count; i++) {
+        const struct watch_dir* root = &state->ctx.roots[i];
+        int wd = inotify_add_watch(state->ctx.fd, root->path, WATCH_EVENTS);
+        if (wd < 0 || ((size_t)wd < state->ctx.watch_capacity && state->ctx.watches[wd].path)) continue;
+        watch_add_tree(&state->ctx, root->path, root->recursive, root->manifest, root->output);
+    }
+#endif
+}
+
+// 收集监视的目录并加入inotify, 在启动和重新读取CMake.toml时调用; 项目本身的CMake.toml使用已解析的state->opts
+void daemon_watch(struct daemon_state* state) {
+    if (state->workspace) {
+        watch_add_root(&state->ctx, ".", false, true, false);
+        for (size_t i = 0; i < state->members.count; i++) {
+            watch_collect_project(&state->ctx, state->members.items[i], state->build_dirs.items[0], NULL);
         }
     }
-    // 输出成功信息
-    printf("\n项目创建成功! 结构如下:\n");
-    printf("%s%c\n", project_name, PATH_SEP);
-    printf("├── CMakeLists.txt\n");
-    printf("├── CMake.toml\n");
-    printf("├── build%c\n", PATH_SEP);
-    printf("├── include%c\n", PATH_SEP);
-    if (strcmp(project_type, "static") == 0 || strcmp(project_type, "shared") == 0) {
-        printf("│   └── %s.h\n", project_name);
+    else {
+        watch_collect_project(&state->ctx, ".", state->build_dirs.items[0], state->manifest_ok ? &state->opts : NULL);
+        // 路径依赖的成员的源文件
+        for (size_t i = 0; i < state->deps.count; i++) {
+            if (state->deps.items[i].path) watch_collect_project(&state->ctx, state->deps.items[i].path, state->build_dirs.items[0], NULL);
+        }
     }
-    printf("└── src%c\n", PATH_SEP);
-    
-    if (strcmp(project_type, "executable") == 0) {
-        printf("    └── main.cpp\n");
-    } else {
-        printf("    └── %s.cpp\n", project_name);
+    daemon_watch_outputs(state);
+}
+
+// 读取积压的修改事件, 没有inotify时比较修改时间
+void daemon_drain_events(struct daemon_state* state) {
+#if defined(PLATFORM_LINUX)
+    if (state->ctx.fd >= 0) {
+        watch_read_events(&state->ctx);
+        return;
     }
+#endif
+    watch_poll_changes(&state->ctx);
+}
 
-    printf("\n构建指南:\n");
-    printf("  cd %s\n", project_name);
-    printf("  cd build\n");
-    
-    if (strcmp(project_type, "executable") == 0) {
-        printf("  cmake ..\n");
-        printf("  cmake --build .\n");
-        printf("  .%c%s%s\n", PATH_SEP, project_name, EXE_EXT);
-    } 
-    else if (strcmp(project_type, "static") == 0) {
-        printf("  cmake ..\n");
-        printf("  cmake --build .\n");
-        printf("  # 静态库文件: build%clib%cstatic%c%s%s\n", 
-               PATH_SEP, PATH_SEP, PATH_SEP, project_name, STATIC_LIB_EXT);
-    } 
-    else {
-        printf("  cmake ..\n");
-        printf("  cmake --build .\n");
-        printf("  # 动态库文件: build%cbin%c%s%s (Windows) 或 build%clib%cshared%c%s\n", 
-               PATH_SEP, PATH_SEP, project_name, SHARED_LIB_EXT, 
-               PATH_SEP, PATH_SEP, PATH_SEP, SHARED_LIB_EXT);
+// 在fork出的子进程中构建, 子进程位于新的进程组中, 客户端断开时终止整个进程组
+int daemon_run_build(struct daemon_state* state, int client_fd, struct string_list* build_argv, char** env) {
+    int pipe_fds[2];
+    if (pipe(pipe_fds) != 0) {
+        daemon_send_text(client_fd, "守护进程: 创建管道失败: %s\n", strerror(errno));
+        return EXIT_FAILURE;
     }
-    
-    if (num_deps > 0) {
-        printf("\n注意 : 本项目的依赖项需要通过系统包管理器安装\n");
-#if defined(PLATFORM_WINDOWS)
-        printf("      请使用 vcpkg 安装依赖项\n");
-#elif defined(PLATFORM_MACOS)
-        printf("      请使用 Homebrew 安装依赖项\n");
-#else
-        printf("      请使用 apt-get/yum 安装依赖项\n");
+    fflush(stdout);
+    fflush(stderr);
+    pid_t pid = fork();
+    if (pid < 0) {
+        daemon_send_text(client_fd, "守护进程: fork失败: %s\n", strerror(errno));
+        close(pipe_fds[0]);
+        close(pipe_fds[1]);
+        return EXIT_FAILURE;
+    }
+    if (pid == 0) {
+        setpgid(0, 0);
+        dup2(pipe_fds[1], STDOUT_FILENO);
+        dup2(pipe_fds[1], STDERR_FILENO);
+        close(pipe_fds[0]);
+        close(pipe_fds[1]);
+        close(client_fd);
+        close(state->listen_fd);
+        if (state->ctx.fd >= 0) close(state->ctx.fd);
+        signal(SIGINT, SIG_DFL);
+        signal(SIGTERM, SIG_DFL);
+        signal(SIGPIPE, SIG_DFL);
+        setvbuf(stdout, NULL, _IOLBF, 0);
+        // 使用客户端的环境变量
+        environ = env;
+        int argc = (int)build_argv->count;
+        uint8_t result = state->workspace ? workspace_command(argc, build_argv->items, &state->members)
+                       : state->manifest_ok ? build_with_options(argc, build_argv->items, &state->opts, &state->deps)
+                       : build_project(argc, build_argv->items);
+        fflush(stdout);
+        fflush(stderr);
+        _exit(result);
+    }
+    setpgid(pid, pid);
+    close(pipe_fds[1]);
+
+    bool client_gone = false;
+    char buffer[BUFFER_SIZE * 8];
+    for (;;) {
+        // 请求已经读完, 客户端的连接只在断开时可读
+        struct pollfd fds[3] = {
+            { pipe_fds[0], POLLIN, 0 },
+            { client_gone ? -1 : client_fd, POLLIN, 0 },
+            { state->ctx.fd, POLLIN, 0 },
+        };
+        if (poll(fds, 3, -1) < 0) {
+            if (errno != EINTR) break;
+            if (watch_interrupted && !client_gone) {
+                client_gone = true;
+                kill(-pid, SIGTERM);
+            }
+            continue;
+        }
+#if defined(PLATFORM_LINUX)
+        if (fds[2].revents & POLLIN) watch_read_events(&state->ctx);
 #endif
+        if (fds[1].revents & (POLLIN | POLLHUP | POLLERR)) {
+            client_gone = true;
+            kill(-pid, SIGTERM);
+        }
+        if (fds[0].revents & (POLLIN | POLLHUP)) {
+            ssize_t n = read(pipe_fds[0], buffer, sizeof(buffer));
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) break;
+            if (!client_gone && !daemon_send_frame(client_fd, DAEMON_FRAME_OUTPUT, buffer, (uint32_t)n)) {
+                client_gone = true;
+                kill(-pid, SIGTERM);
+            }
+        }
     }
-    
-    return EXIT_SUCCESS;
+    close(pipe_fds[0]);
 
+    int status = 0;
+    while (waitpid(pid, &status, 0) == -1 && errno == EINTR) {}
+    if (client_gone) printf("守护进程: 客户端已断开, 构建被取消\n");
+    return WIFEXITED(status) ? WEXITSTATUS(status) : EXIT_FAILURE;
 }
 
-uint8_t init_project(int argc,char*argv[]){
-    char project_name[MAX_PATH_LEN] = "my_project";
-    char project_type[15] = "executable";
-    char deps[MAX_DEPS][MAX_PATH_LEN];
-    int num_deps = 0;
-    bool add_precompile_headers = false;
+void daemon_handle_build(struct daemon_state* state, int client_fd, const struct string_list* items) {
+    int64_t start_us = now_us();
+    size_t arg_count = (size_t)atoi(items->items[1]);
+    if (arg_count > items->count - 2) arg_count = items->count - 2;
+    char* const* args = items->items + 2;
+    char** env = items->items + 2 + arg_count;
 
-    // 尝试从CMake.toml获取项目名称
-    if (parse_cmake_toml(project_name, project_type, deps, &num_deps, &add_precompile_headers)) {
-        printf("从CMake.toml获取项目名称: %s\n", project_name);
-        printf("从CMake.toml获取项目类型: %s\n", project_type);
-        if (num_deps > 0) {
-            printf("检测到依赖项: ");
-            for (int i = 0; i < num_deps; i++) {
-                printf("%s ", deps[i]);
-            }
-            printf("\n");
+    // 先处理积压的修改, CMake.toml修改或上次解析失败时重新解析
+    daemon_drain_events(state);
+    if (state->ctx.manifest_changed || !state->manifest_ok) {
+        printf("守护进程: CMake.toml已修改, 重新读取\n");
+        daemon_load(state);
+        daemon_watch(state);
+    }
+    // 构建目录不是build时同样监视其中的修改
+    const char* build_dir = state->build_dirs.items[0];
+    for (size_t i = 0; i + 1 < arg_count; i++) {
+        if (strcmp(args[i], "-b") && strcmp(args[i], "--build-dir")) continue;
+        build_dir = args[i + 1];
+        bool known = false;
+        for (size_t k = 0; k < state->build_dirs.count && !known; k++) {
+            known = !strcmp(state->build_dirs.items[k], build_dir);
         }
-    } 
-    else {
-        printf("无法打开CMake.toml或解析失败\n");
-        return EXIT_FAILURE;
+        if (!known) string_list_push(&state->build_dirs, build_dir);
+    }
+    uint64_t request_key = daemon_request_key(args, arg_count, env);
+    uint64_t key = daemon_inputs_key(state, request_key, build_dir, env);
+    bool changed = state->ctx.manifest_changed || state->ctx.sources_changed || state->ctx.outputs_changed;
+    if (state->clean && state->manifest_ok && !changed && key == state->clean_key && daemon_can_skip(args, arg_count)) {
+        state->skipped++;
+        double ms = (now_us() - start_us) / 1e3;
+        daemon_send_text(client_fd, "守护进程: 自上次构建以来没有修改, 跳过构建 (%.1f ms)\n构建成功!\n", ms);
+        daemon_send_exit(client_fd, EXIT_SUCCESS);
+        printf("守护进程: 没有修改, 跳过构建 (%.1f ms)\n", ms);
+        fflush(stdout);
+        return;
     }
 
-    printf("\n在当前目录初始化项目: %s (%s)\n", project_name, 
-           strcmp(project_type, "executable") == 0 ? "可执行文件" :
-           strcmp(project_type, "static") == 0 ? "静态库" : "动态库");
+    struct string_list build_argv = {0};
+    string_list_push(&build_argv, state->self);
+    string_list_push(&build_argv, "build");
+    for (size_t i = 0; i < arg_count; i++) {
+        string_list_push(&build_argv, args[i]);
+    }
+    state->ctx.manifest_changed = false;
+    state->ctx.sources_changed = false;
+    state->clean = false;
+    printf("守护进程: 开始构建\n");
+    fflush(stdout);
+    int code = daemon_run_build(state, client_fd, &build_argv, env);
+    string_list_free(&build_argv);
 
-    // 创建必要的子目录
+    // 构建期间输出目录的修改来自本次构建; 源文件或CMake.toml有修改时下次仍需构建
+    daemon_drain_events(state);
+    daemon_watch_outputs(state);
+    if (state->ctx.fd < 0) watch_poll_changes(&state->ctx);
+    state->ctx.outputs_changed = false;
+    state->clean = code == EXIT_SUCCESS && !state->ctx.manifest_changed && !state->ctx.sources_changed;
+    // 构建本身可能更新CMake.lock和依赖项缓存
+    state->clean_key = daemon_inputs_key(state, request_key, build_dir, env);
+    state->builds++;
+    daemon_send_exit(client_fd, code);
+    printf("守护进程: 构建%s (%.2f s)\n", code == EXIT_SUCCESS ? "成功" : "失败", (now_us() - start_us) / 1e6);
+    fflush(stdout);
+}
+
+// 处理一个客户端请求, 返回false表示守护进程应当退出
+bool daemon_handle_client(struct daemon_state* state, int client_fd) {
+    struct string_list items = {0};
+    bool keep_running = true;
+    if (daemon_read_request(client_fd, &items) && items.count >= 2) {
+        const char* command = items.items[0];
+        if (!strcmp(command, "build")) {
+            daemon_handle_build(state, client_fd, &items);
+        }
+        else if (!strcmp(command, "status")) {
+            char cwd[MAX_PATH_LEN] = "";
+            if (!getcwd(cwd, sizeof(cwd))) strcpy(cwd, ".");
+            daemon_drain_events(state);
+            bool changed = state->ctx.manifest_changed || state->ctx.sources_changed || state->ctx.outputs_changed;
+            daemon_send_text(client_fd, "守护进程: %s (pid %ld)\n监视: %zu 个目录(%s)\n构建: %zu 次, 跳过: %zu 次\n状态: %s\n",
+                             cwd, (long)getpid(), state->ctx.root_count, state->ctx.fd >= 0 ? "inotify" : "轮询",
+                             state->builds, state->skipped, state->clean && !changed ? "已是最新" : "需要构建");
+            daemon_send_exit(client_fd, EXIT_SUCCESS);
+        }
+        else if (!strcmp(command, "stop")) {
+            daemon_send_text(client_fd, "守护进程已停止\n");
+            daemon_send_exit(client_fd, EXIT_SUCCESS);
+            keep_running = false;
+        }
+        else {
+            daemon_send_text(client_fd, "守护进程: 未知请求 %s\n", command);
+            daemon_send_exit(client_fd, EXIT_FAILURE);
+        }
+    }
+    string_list_free(&items);
+    return keep_running;
+}
+
+void daemon_free(struct daemon_state* state) {
+    watch_free(&state->ctx);
+    string_list_free(&state->build_dirs);
+    dependency_list_free(&state->deps);
+    free_build_options(&state->opts);
+    string_list_free(&state->members);
+}
+
+// 只接受与守护进程同一用户的客户端: 请求中的环境变量(LD_PRELOAD、CC等)会被用于构建
+bool daemon_peer_allowed(int client_fd) {
+#if defined(PLATFORM_LINUX)
+    struct ucred cred;
+    socklen_t length = sizeof(cred);
+    return getsockopt(client_fd, SOL_SOCKET, SO_PEERCRED, &cred, &length) == 0 && cred.uid == getuid();
+#else
+    uid_t uid;
+    gid_t gid;
+    return getpeereid(client_fd, &uid, &gid) == 0 && uid == getuid();
+#endif
+}
+
+// 在当前目录启动守护进程(前台运行, Ctrl-C或cbuild daemon stop停止)
+uint8_t daemon_serve(int argc, char* argv[]) {
+    (void)argc;
     struct stat st;
-    memset(&st, 0, sizeof(st)); // 修复初始化方式
-    
-    if (stat("src", &st) == -1 && !create_directory("src")) {
+    if (stat("CMake.toml", &st) != 0) {
+        fprintf(stderr, "错误: 当前目录没有CMake.toml\n");
         return EXIT_FAILURE;
     }
-    if (stat("include", &st) == -1 && !create_directory("include")) {
+    int existing = daemon_connect();
+    if (existing >= 0) {
+        close(existing);
+        fprintf(stderr, "错误: 当前目录已有运行中的守护进程\n");
         return EXIT_FAILURE;
     }
-    if (stat("build", &st) == -1 && !create_directory("build")) {
+    // 上次异常退出留下的套接字文件
+    unlink(DAEMON_SOCKET_FILE);
+
+    struct daemon_state state;
+    memset(&state, 0, sizeof(state));
+    state.ctx.fd = -1;
+    if (!self_executable_path(argv[0], state.self, sizeof(state.self))) {
+        fprintf(stderr, "错误: 无法确定cbuild的路径\n");
         return EXIT_FAILURE;
     }
-
-    // 创建CMakeLists.txt文件（带依赖处理）
-    if (!create_cmakelists(project_name, project_type, deps, num_deps, add_precompile_headers)) {
+    // CMake.toml有错误时不启动, 否则会带着默认选项构建
+    if (!daemon_load(&state)) {
+        daemon_free(&state);
+        return EXIT_FAILURE;
+    }
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", DAEMON_SOCKET_FILE);
+    state.listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    // 套接字只允许所有者连接, 不受umask影响
+    if (state.listen_fd < 0 || bind(state.listen_fd, (struct sockaddr*)&addr, sizeof(addr)) != 0 ||
+        chmod(DAEMON_SOCKET_FILE, 0600) != 0 || listen(state.listen_fd, 16) != 0) {
+        fprintf(stderr, "错误: 无法监听 %s: %s\n", DAEMON_SOCKET_FILE, strerror(errno));
+        if (state.listen_fd >= 0) close(state.listen_fd);
+        unlink(DAEMON_SOCKET_FILE);
+        daemon_free(&state);
         return EXIT_FAILURE;
     }
+    fcntl(state.listen_fd, F_SETFD, FD_CLOEXEC);
 
-    // 创建源文件（如果不存在）
-    if (strcmp(project_type, "executable") == 0) {
-        if (stat("src/main.cpp", &st) == -1 && !create_main_cpp_file(add_precompile_headers)) {
-            return EXIT_FAILURE;
-        }
-    } 
-    else {
-        char src_file[MAX_PATH_LEN];
-        snprintf(src_file, MAX_PATH_LEN, "src/%s.cpp", project_name);
-        if (stat(src_file, &st) == -1 && !create_library_files(project_name,add_precompile_headers)) {
-            return EXIT_FAILURE;
+    string_list_push(&state.build_dirs, "build");
+#if defined(PLATFORM_LINUX)
+    state.ctx.fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (state.ctx.fd < 0) perror("inotify不可用,改为在每次请求时比较修改时间");
+#endif
+    daemon_watch(&state);
+    if (state.ctx.fd < 0) watch_poll_changes(&state.ctx);
+
+    struct sigaction action, previous_int, previous_term, previous_pipe;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = watch_interrupt;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGINT, &action, &previous_int);
+    sigaction(SIGTERM, &action, &previous_term);
+    action.sa_handler = SIG_IGN;
+    sigaction(SIGPIPE, &action, &previous_pipe);
+
+    printf("守护进程已启动: %s, 监视 %zu 个目录(%s), 按Ctrl-C停止\n", DAEMON_SOCKET_FILE, state.ctx.root_count,
+           state.ctx.fd >= 0 ? "inotify" : "轮询");
+    fflush(stdout);
+    bool running = true;
+    while (running && !watch_interrupted) {
+        struct pollfd fds[2] = { { state.listen_fd, POLLIN, 0 }, { state.ctx.fd, POLLIN, 0 } };
+        if (poll(fds, 2, -1) < 0) continue;
+#if defined(PLATFORM_LINUX)
+        // 及时读取事件, 避免inotify队列溢出
+        if (fds[1].revents & POLLIN) watch_read_events(&state.ctx);
+#endif
+        if (!(fds[0].revents & POLLIN)) continue;
+        int client_fd = accept(state.listen_fd, NULL, NULL);
+        if (client_fd < 0) continue;
+        if (!daemon_peer_allowed(client_fd)) {
+            fprintf(stderr, "守护进程: 拒绝其他用户的连接\n");
+            close(client_fd);
+            continue;
         }
+        struct timeval timeout = { 5, 0 };
+        setsockopt(client_fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        running = daemon_handle_client(&state, client_fd);
+        close(client_fd);
     }
-    if(add_precompile_headers){
-        if(!create_precompile_headers(add_precompile_headers)){
-            return EXIT_FAILURE;
-        }
+
+    sigaction(SIGINT, &previous_int, NULL);
+    sigaction(SIGTERM, &previous_term, NULL);
+    sigaction(SIGPIPE, &previous_pipe, NULL);
+    close(state.listen_fd);
+    unlink(DAEMON_SOCKET_FILE);
+    daemon_free(&state);
+    printf("守护进程已停止 (构建 %zu 次, 跳过 %zu 次)\n", state.builds, state.skipped);
+    return EXIT_SUCCESS;
+}
+
+uint8_t daemon_command(int argc, char* argv[]) {
+    const char* action = argc > 2 ? argv[2] : "start";
+    if (!strcmp(action, "start")) {
+        return daemon_serve(argc, argv);
     }
-    // 输出成功信息
-    printf("\n项目初始化成功!\n");
-    printf("已创建/更新以下文件:\n");
-    printf("  CMakeLists.txt\n");
-    if (stat("CMake.toml", &st) == -1) {
-        printf("  CMake.toml (已创建)\n");
-        create_cmake_toml(project_name, project_type, deps, num_deps, add_precompile_headers);
-    } 
-    else {
-        printf("  CMake.toml (已更新)\n");
+    if (strcmp(action, "stop") && strcmp(action, "status")) {
+        fprintf(stderr, "错误: daemon 只支持 start、stop 和 status\n");
+        return EXIT_FAILURE;
     }
-    
-    if (strcmp(project_type, "static") == 0 || strcmp(project_type, "shared") == 0) {
-        printf("  include/%s.h\n", project_name);
-        printf("  src/%s.cpp\n", project_name);
-    } 
-    else {
-        printf("  src/main.cpp\n");
+    int fd = daemon_connect();
+    if (fd < 0) {
+        printf("当前目录没有运行中的守护进程\n");
+        return strcmp(action, "stop") ? EXIT_FAILURE : EXIT_SUCCESS;
     }
-    
-    if (num_deps > 0) {
-        printf("\n注意 : 本项目的依赖项需要通过系统包管理器安装\n");
-#if defined(PLATFORM_WINDOWS)
-        printf("      请使用 vcpkg 安装依赖项\n");
-#elif defined(PLATFORM_MACOS)
-        printf("      请使用 Homebrew 安装依赖项\n");
+    int result = daemon_send_request(fd, action, 0, NULL, false) ? daemon_receive(fd) : -1;
+    close(fd);
+    return result == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
 #else
-        printf("      请使用 apt-get/yum 安装依赖项\n");
+uint8_t daemon_command(int argc, char* argv[]) {
+    (void)argc;
+    (void)argv;
+    fprintf(stderr, "错误: 守护进程使用Unix套接字, Windows下不支持\n");
+    return EXIT_FAILURE;
+}
+#endif
+
+#if !defined(PLATFORM_WINDOWS)
+// 增量安装的暂存目录和状态文件(位于构建目录中)
+#define INSTALL_STAGE_DIR ".cbuild-stage"
+#define INSTALL_STATE_FILE ".cbuild_install_state"
+
+#ifndef FICLONE
+#define FICLONE _IOW(0x94, 9, int)
 #endif
+
+// 上一次安装时每个文件的记录: 内容哈希以及暂存文件和目标文件的大小、修改时间
+struct install_record {
+    char* path;
+    uint64_t hash;
+    long long src_size;
+    long long src_mtime;
+    long long dst_size;
+    long long dst_mtime;
+};
+
+int compare_install_records(const void* a, const void* b) {
+    return strcmp(((const struct install_record*)a)->path, ((const struct install_record*)b)->path);
+}
+
+// 读取状态文件, 每行: <哈希> <暂存大小> <暂存mtime> <目标大小> <目标mtime> <路径>
+struct install_record* load_install_state(const char* path, size_t* out_count) {
+    *out_count = 0;
+    FILE* file = fopen(path, "r");
+    if (!file) return NULL;
+    struct install_record* records = NULL;
+    size_t count = 0, capacity = 0;
+    char line[MAX_PATH_LEN + 128];
+    while (fgets(line, sizeof(line), file)) {
+        line[strcspn(line, "\r\n")] = '\0';
+        struct install_record record;
+        unsigned long long hash;
+        int offset = 0;
+        if (sscanf(line, "%llx %lld %lld %lld %lld %n", &hash, &record.src_size, &record.src_mtime,
+                   &record.dst_size, &record.dst_mtime, &offset) != 5 || line[offset] == '\0') {
+            continue;
+        }
+        if (count == capacity) {
+            capacity = capacity ? capacity * 2 : 256;
+            struct install_record* grown = realloc(records, capacity * sizeof(*records));
+            if (!grown) break;
+            records = grown;
+        }
+        record.hash = hash;
+        record.path = strdup(line + offset);
+        if (!record.path) break;
+        records[count++] = record;
     }
-    
-    return EXIT_SUCCESS;
+    fclose(file);
+    qsort(records, count, sizeof(*records), compare_install_records);
+    *out_count = count;
+    return records;
 }
 
-// 执行命令并检查状态
-int execute_command(const char* command) {
-    printf("执行命令: %s\n", command);
-    
-#if defined(PLATFORM_WINDOWS)
-    // Windows下需要将参数传递给cmd
-    char cmd[MAX_PATH_LEN * 3];
-    snprintf(cmd, sizeof(cmd), "cmd /c \"%s\"", command);
-    int status = system(cmd);
-#else
-    int status = system(command);
-#endif
-    
-    if (status == -1) {
-        perror("命令执行失败");
-        return 0;
+// 递归创建目录(mkdir -p)
+int create_directories(const char* path) {
+    char buffer[MAX_PATH_LEN];
+    snprintf(buffer, sizeof(buffer), "%s", path);
+    for (char* p = buffer + 1; *p; p++) {
+        if (*p != '/') continue;
+        *p = '\0';
+        if (mkdir(buffer, 0755) != 0 && errno != EEXIST) return 0;
+        *p = '/';
     }
-    
-#if !defined(PLATFORM_WINDOWS)
-    if (WIFEXITED(status)) {
-        int exit_status = WEXITSTATUS(status);
-        if (exit_status != 0) {
-            fprintf(stderr, "命令退出代码: %d\n", exit_status);
-            return 0;
-        }
-    } 
-    else {
-        fprintf(stderr, "命令异常终止\n");
-        return 0;
+    return mkdir(buffer, 0755) == 0 || errno == EEXIST;
+}
+
+// 复制文件内容: 优先使用reflink(FICLONE,共享数据块),其次copy_file_range(内核内复制),最后read/write
+int copy_file_contents(int src_fd, int dst_fd, off_t size) {
+#if defined(PLATFORM_LINUX)
+    if (ioctl(dst_fd, FICLONE, src_fd) == 0) return 1;
+    off_t copied = 0;
+    while (copied < size) {
+        ssize_t n = copy_file_range(src_fd, NULL, dst_fd, NULL, (size_t)(size - copied), 0);
+        if (n <= 0) break;
+        copied += n;
     }
+    if (copied == size) return 1;
+    // 跨文件系统或内核不支持时回退到普通复制
+    if (lseek(src_fd, copied, SEEK_SET) < 0 || lseek(dst_fd, copied, SEEK_SET) < 0) return 0;
+#else
+    (void)size;
 #endif
-    
-    return 1;
+    char buffer[64 * 1024];
+    for (;;) {
+        ssize_t n = read(src_fd, buffer, sizeof(buffer));
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) return 0;
+        if (n == 0) return 1;
+        for (ssize_t written = 0; written < n;) {
+            ssize_t w = write(dst_fd, buffer + written, (size_t)(n - written));
+            if (w < 0 && errno == EINTR) continue;
+            if (w < 0) return 0;
+            written += w;
+        }
+    }
 }
 
-uint8_t clean_project_cache() {
-    char original_dir[4096];
-    
-    // 保存当前目录
-    if (!getcwd(original_dir, sizeof(original_dir))) {
-        perror("无法获取当前工作目录");
-        return EXIT_FAILURE;
+// 把暂存文件复制到目标位置: 先写入同目录下的临时文件再rename,目标文件不会出现写了一半的状态
+int install_file_atomically(const char* src, const char* dst, const struct stat* src_st) {
+    char dir[MAX_PATH_LEN];
+    char tmp[MAX_PATH_LEN + 16];
+    snprintf(dir, sizeof(dir), "%s", dst);
+    if (parent_directory(dir) && !create_directories(dir)) {
+        fprintf(stderr, "创建目录失败 %s: %s\n", dir, strerror(errno));
+        return 0;
     }
+    snprintf(tmp, sizeof(tmp), "%s.cbuild-tmp", dst);
+    unlink(tmp);
 
-    // 进入 build 目录
-    if (CHDIR("build") != 0) {
-        // 特殊处理：build目录不存在时视为已清理
-        if (errno == ENOENT) {
-            printf("build目录不存在,无需清理\n");
-            create_directory("build");
-            return EXIT_SUCCESS;
+    if (S_ISLNK(src_st->st_mode)) {
+        char target[MAX_PATH_LEN];
+        ssize_t len = readlink(src, target, sizeof(target) - 1);
+        if (len < 0) return 0;
+        target[len] = '\0';
+        if (symlink(target, tmp) != 0 || rename(tmp, dst) != 0) {
+            fprintf(stderr, "安装符号链接失败 %s: %s\n", dst, strerror(errno));
+            unlink(tmp);
+            return 0;
         }
-        perror("无法进入build目录");
-        return EXIT_FAILURE;
+        return 1;
     }
 
-    // 清理操作
-#if defined(PLATFORM_WINDOWS)
-    // Windows: 返回上级目录后删除整个build
-    CHDIR("..");
-    if (!execute_command("rmdir /S /Q build 2>NUL")) {
-        printf("清理缓存失败\n");
-        CHDIR(original_dir);  // 失败时恢复原始目录
-        return EXIT_FAILURE;
-    }
-    if(!create_directory("build")){
-        printf("创建build目录失败\n");
-        return EXIT_FAILURE;
+    int src_fd = open(src, O_RDONLY | O_CLOEXEC);
+    if (src_fd < 0) {
+        fprintf(stderr, "无法读取 %s: %s\n", src, strerror(errno));
+        return 0;
     }
-#else
-    // POSIX: 使用更可靠的递归删除命令
-    if (!execute_command("find . -delete 2>/dev/null || { rm -rf ./* && rm -rf .[!.]*; }")) {
-        printf("清理缓存失败\n");
-        CHDIR(original_dir);  // 失败时恢复原始目录
-        return EXIT_FAILURE;
+    int dst_fd = open(tmp, O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, src_st->st_mode & 07777);
+    if (dst_fd < 0) {
+        fprintf(stderr, "无法写入 %s: %s\n", tmp, strerror(errno));
+        close(src_fd);
+        return 0;
     }
-    // 返回原始目录
-    if (CHDIR(original_dir) != 0) {
-        perror("无法返回工作目录");
-        return EXIT_FAILURE;
+    int ok = copy_file_contents(src_fd, dst_fd, src_st->st_size);
+    // 与cmake --install一致,保留源文件的权限和修改时间
+    struct timespec times[2] = { src_st->st_atim, src_st->st_mtim };
+    if (ok) ok = fchmod(dst_fd, src_st->st_mode & 07777) == 0 && futimens(dst_fd, times) == 0;
+    if (close(dst_fd) != 0) ok = 0;
+    close(src_fd);
+    if (!ok || rename(tmp, dst) != 0) {
+        fprintf(stderr, "安装文件失败 %s: %s\n", dst, strerror(errno));
+        unlink(tmp);
+        return 0;
     }
-#endif
-
-    printf("CMake缓存清理成功\n");
-    return EXIT_SUCCESS;
+    return 1;
 }
 
-uint8_t build_project(int argc, char* argv[]) {
-    char cmake_build_type[16] = "Debug"; // 使用更安全的长度
-    char make_install_prefix[MAX_PATH_LEN] = ""; // 跨平台前缀初始化
-    char build_dir[MAX_PATH_LEN] = "build";
-    char additional_flags[1024] = "";
-    bool configure_only = false;
-    bool clean_cache = false;
+// 目标路径(或其最近的已存在的上级目录)是否可写
+bool install_path_writable(const char* path) {
+    char dir[MAX_PATH_LEN];
+    snprintf(dir, sizeof(dir), "%s", path);
+    struct stat st;
+    while (parent_directory(dir)) {
+        if (stat(dir, &st) == 0) return access(dir, W_OK | X_OK) == 0;
+    }
+    return access("/", W_OK) == 0;
+}
 
-    // 设置默认安装路径
-#if PLATFORM_WINDOWS
-    strcpy(make_install_prefix, ".\\install"); // Windows默认安装路径
-#else
-    strcpy(make_install_prefix, "/usr/local");
-#endif
+// 增量安装, 在构建目录中调用:
+// 1. cmake --install 以DESTDIR安装到暂存目录(暂存目录保留, CMake对未变化的文件只输出Up-to-date)
+// 2. 暂存文件和目标文件的大小、修改时间都与上次安装的记录一致时跳过,否则比较内容哈希
+// 3. 只复制变化的文件,最后原子地写入install_manifest.txt和状态文件
+uint8_t incremental_install(const char* install_path, const char* config, bool from_stage, int argc, char* argv[]) {
+    char prefix[MAX_PATH_LEN] = "";
+    if (install_path) {
+        snprintf(prefix, sizeof(prefix), "%s", install_path);
+    } 
+    else if (!read_cmake_cache_value("CMakeCache.txt", "CMAKE_INSTALL_PREFIX", prefix, sizeof(prefix)) || prefix[0] == '\0') {
+        fprintf(stderr, "无法从CMakeCache.txt读取安装路径,请先构建项目\n");
+        return EXIT_FAILURE;
+    }
+    char cwd[MAX_PATH_LEN];
+    char stage_dir[MAX_PATH_LEN + 32];
+    char staged_manifest[MAX_PATH_LEN + 64];
+    if (!getcwd(cwd, sizeof(cwd))) {
+        perror("无法获取当前目录");
+        return EXIT_FAILURE;
+    }
+    snprintf(stage_dir, sizeof(stage_dir), "%s/%s", cwd, INSTALL_STAGE_DIR);
+    snprintf(staged_manifest, sizeof(staged_manifest), "%s/install_manifest.txt", stage_dir);
 
-    // 增强的参数解析
-    for (int i = 2; i < argc; i++) {
-        if (!strcmp(argv[i], "-d") || !strcmp(argv[i], "--debug")) {
-            strcpy(cmake_build_type, "Debug");
-        } 
-        else if (!strcmp(argv[i], "-r") || !strcmp(argv[i], "--release")) {
-            strcpy(cmake_build_type, "Release");
-        } 
-        else if (!strcmp(argv[i], "-p") || !strcmp(argv[i], "--prefix")) {
-#if PLATFORM_WINDOWS
-            if (i + 1 >= argc) {
-                fprintf(stderr, "错误：未指定安装目录,使用默认安装目录\n");
-                strcpy(make_install_prefix,".\\install");
-                continue;
-            }
-            if(argv[i+1][0]=='-'){
-                fprintf(stderr, "错误：未指定安装目录,使用默认安装目录\n");
-                strcpy(make_install_prefix,".\\install");
-                continue;
-            }
-#else
-            if (i + 1 >= argc) {
-                fprintf(stderr, "错误：未指定安装目录,使用默认安装目录\n");
-                strcpy(make_install_prefix,"/usr/local");
-                continue;
-            }
-            if(argv[i+1][0]=='-'){
-                fprintf(stderr, "错误：未指定安装目录,使用默认安装目录\n");
-                strcpy(make_install_prefix,"/usr/local");
-                continue;
-            }
-#endif
-            strcpy(make_install_prefix, argv[++i]);
-            make_install_prefix[MAX_PATH_LEN - 1] = '\0';
-        } 
-        else if (!strcmp(argv[i], "--configure-only") || !strcmp(argv[i], "-c")) {
-            configure_only = true;
-        } 
-        else if (!strcmp(argv[i], "-b") || !strcmp(argv[i], "--build-dir")) {
-            if (i + 1 >= argc) {
-                fprintf(stderr, "错误：未指定构建目录\n");
-                return EXIT_FAILURE;
-            }
-            strncpy(build_dir, argv[++i], MAX_PATH_LEN - 1);
-            build_dir[MAX_PATH_LEN - 1] = '\0';
-        }
-        else if(!strcmp(argv[i],"-C") || !strcmp(argv[i],"--clean-cache")){
-            clean_cache = true;
+    if (!from_stage) {
+        // 暂存安装不需要管理员权限; CMake写入的清单移入暂存目录,上一次的清单在部署成功前保持不变
+        char* stage_args[] = { "cmake", "--install", ".", "--prefix", prefix, NULL, NULL, NULL };
+        if (config[0]) {
+            stage_args[5] = "--config";
+            stage_args[6] = (char*)config;
         }
-        else {
-            // 收集额外的CMake参数
-            if (additional_flags[0] != '\0') strcat(additional_flags, " ");
-            strncat(additional_flags, argv[i], sizeof(additional_flags) - strlen(additional_flags) - 1);
+        rename("install_manifest.txt", "install_manifest.txt.cbuild-previous");
+        setenv("DESTDIR", stage_dir, 1);
+        int ok = run_process(stage_args, NULL);
+        unsetenv("DESTDIR");
+        bool staged = ok && rename("install_manifest.txt", staged_manifest) == 0;
+        rename("install_manifest.txt.cbuild-previous", "install_manifest.txt");
+        if (!staged) {
+            fprintf(stderr, "暂存安装失败\n");
+            return EXIT_FAILURE;
         }
     }
 
-    printf("构建模式: %s | 安装路径: %s\n", cmake_build_type, make_install_prefix);
+    FILE* manifest = fopen(staged_manifest, "r");
+    if (!manifest) {
+        fprintf(stderr, "无法打开暂存清单 %s: %s\n", staged_manifest, strerror(errno));
+        return EXIT_FAILURE;
+    }
+    struct string_list files = {0};
+    char line[MAX_PATH_LEN];
+    while (fgets(line, sizeof(line), manifest)) {
+        line[strcspn(line, "\r\n")] = '\0';
+        if (line[0] == '/') string_list_push(&files, line);
+    }
+    fclose(manifest);
 
-    if(clean_cache){
-        printf("清理缓存\n");
-        if(clean_project_cache()!=EXIT_SUCCESS){
-            fprintf(stderr, "清理缓存失败\n");
-            return EXIT_FAILURE;
-        }
+    // 检查目标位置的权限,需要时整个部署只通过sudo重新运行一次
+    bool needs_privilege = false;
+    for (size_t i = 0; i < files.count && !needs_privilege; i++) {
+        needs_privilege = !install_path_writable(files.items[i]);
     }
-    // 处理构建目录
-    struct stat st;
-    memset(&st, 0, sizeof(st));
-    if (stat(build_dir, &st) == -1) {
-        if (!create_directory(build_dir)) {
-            fprintf(stderr, "创建构建目录失败: %s\n", build_dir);
+    if (needs_privilege && geteuid() != 0) {
+        char self[MAX_PATH_LEN];
+        if (!self_executable_path(argv[0], self, sizeof(self))) {
+            fprintf(stderr, "无法确定cbuild的路径,无法使用sudo重新运行\n");
+            string_list_free(&files);
             return EXIT_FAILURE;
         }
-    }
-    // 保存当前目录
-    char cwd[MAX_PATH_LEN];
-    if (!getcwd(cwd, sizeof(cwd))) {
-        perror("无法获取当前目录");
-        return EXIT_FAILURE;
+        printf("安装路径需要管理员权限,使用sudo部署暂存的文件\n");
+        struct string_list sudo_args = {0};
+        string_list_push(&sudo_args, "sudo");
+        string_list_push(&sudo_args, self);
+        for (int i = 1; i < argc; i++) string_list_push(&sudo_args, argv[i]);
+        string_list_push(&sudo_args, "--from-stage");
+        int ok = run_process(sudo_args.items, NULL);
+        string_list_free(&sudo_args);
+        string_list_free(&files);
+        return ok ? EXIT_SUCCESS : EXIT_FAILURE;
     }
 
-    // 进入构建目录
-    if (CHDIR(build_dir) != 0) {
-        perror("无法进入构建目录");
-        fprintf(stderr, "目标目录: %s\n", build_dir);
+    size_t record_count;
+    struct install_record* records = load_install_state(INSTALL_STATE_FILE, &record_count);
+    struct install_record* new_records = calloc(files.count + 1, sizeof(*new_records));
+    if (!new_records) {
+        string_list_free(&files);
         return EXIT_FAILURE;
     }
 
-    char cmake_command[MAX_PATH_LEN * 3] = ""; // 三倍缓冲区确保安全
-    bool need_configure = true;
-    
-    // 检查是否存在CMake缓存文件
-    if (stat("CMakeCache.txt", &st) == 0) {
-        // 尝试获取缓存的构建类型
-        FILE* cache_file = fopen("CMakeCache.txt", "r");
-        if (cache_file) {
-            char line[256];
-            char existing_type[16] = "";
-            
-            while (fgets(line, sizeof(line), cache_file)) {
-                if (strstr(line, "CMAKE_BUILD_TYPE:STRING")) {
-                    char* value = strchr(line, '=');
-                    if (value) {
-                        value++; // 跳过等号
-                        // 提取值并去除换行符
-                        size_t len = strcspn(value, "\r\n");
-                        if (len < sizeof(existing_type)) {
-                            strncpy(existing_type, value, len);
-                            existing_type[len] = '\0';
-                        }
-                    }
-                }
-            }
-            fclose(cache_file);
-            if (strcmp(existing_type, cmake_build_type) == 0) {
-                need_configure = false;
-                printf("检测到现有的CMake缓存(构建类型相同),跳过配置阶段\n");
+    int copied = 0, unchanged = 0, hashed = 0, failed = 0;
+    for (size_t i = 0; i < files.count; i++) {
+        const char* dst = files.items[i];
+        char src[MAX_PATH_LEN * 2];
+        snprintf(src, sizeof(src), "%s%s", stage_dir, dst);
+        struct stat src_st, dst_st;
+        if (lstat(src, &src_st) != 0) {
+            fprintf(stderr, "暂存文件不存在: %s\n", src);
+            failed++;
+            continue;
+        }
+        bool dst_exists = lstat(dst, &dst_st) == 0;
+
+        struct install_record key = { (char*)dst, 0, 0, 0, 0, 0 };
+        struct install_record* previous = records
+            ? bsearch(&key, records, record_count, sizeof(*records), compare_install_records)
+            : NULL;
+        struct install_record* record = &new_records[i];
+        record->path = files.items[i];
+        record->src_size = (long long)src_st.st_size;
+        record->src_mtime = file_mtime_us(src);
+
+        bool same = false;
+        if (S_ISLNK(src_st.st_mode)) {
+            char src_target[MAX_PATH_LEN] = "", dst_target[MAX_PATH_LEN] = "";
+            ssize_t src_len = readlink(src, src_target, sizeof(src_target) - 1);
+            ssize_t dst_len = dst_exists && S_ISLNK(dst_st.st_mode) ? readlink(dst, dst_target, sizeof(dst_target) - 1) : -1;
+            if (src_len >= 0) src_target[src_len] = '\0';
+            if (dst_len >= 0) dst_target[dst_len] = '\0';
+            same = src_len >= 0 && dst_len >= 0 && !strcmp(src_target, dst_target);
+        } 
+        else if (dst_exists && S_ISREG(dst_st.st_mode) && dst_st.st_size == src_st.st_size) {
+            if (previous && previous->src_size == record->src_size && previous->src_mtime == record->src_mtime
+                && previous->dst_size == (long long)dst_st.st_size && previous->dst_mtime == file_mtime_us(dst)) {
+                // 暂存文件和目标文件自上次安装后都没有变化
+                same = true;
+                record->hash = previous->hash;
             } 
             else {
-                printf("构建类型从 %s 变为 %s,需要重新配置\n", existing_type, cmake_build_type);
-                need_configure = true;
+                // 时间戳不可靠(例如重新构建产生了相同内容),比较内容哈希
+                record->hash = hash_file_contents(src);
+                same = record->hash == hash_file_contents(dst);
+                hashed++;
             }
         }
-    } 
-    else {
-        printf("未找到CMake缓存,需要进行配置\n");
-    }
 
-    // 配置阶段
-    if (need_configure) {
-        // 构建配置命令
-#if PLATFORM_WINDOWS
-            // Windows路径需要特殊处理反斜杠
-            char escaped_prefix[MAX_PATH_LEN * 2] = {0};
-            char* pos = make_install_prefix;
-            char* dest = escaped_prefix;
-            while (*pos && (dest - escaped_prefix) < sizeof(escaped_prefix) - 2) {
-                if (*pos == '\\') *dest++ = '\\'; // 对反斜杠进行转义
-                *dest++ = *pos++;
-            }
-            *dest = '\0';
-            
-            snprintf(cmake_command, sizeof(cmake_command), 
-                "cmake .. -G \"MinGW Makefiles\" -DCMAKE_BUILD_TYPE=%s -DCMAKE_INSTALL_PREFIX=\"%s\" -DCMAKE_C_COMPILER=gcc -DCMAKE_CXX_COMPILER=g++ %s",
-                cmake_build_type, escaped_prefix, additional_flags);
-#else
-            snprintf(cmake_command, sizeof(cmake_command), 
-                "cmake .. -DCMAKE_BUILD_TYPE=%s -DCMAKE_INSTALL_PREFIX=\"%s\" -DCMAKE_C_COMPILER=gcc -DCMAKE_CXX_COMPILER=g++ %s",
-                cmake_build_type, make_install_prefix, additional_flags);
-#endif
-        
-        printf("配置CMake: %s\n", cmake_command);
-        if (!execute_command(cmake_command)) {
-            fprintf(stderr, "CMake配置失败\n");
-            CHDIR(cwd); // 恢复原始目录
-            return EXIT_FAILURE;
+        if (same) {
+            unchanged++;
+        } 
+        else if (install_file_atomically(src, dst, &src_st)) {
+            if (S_ISREG(src_st.st_mode) && record->hash == 0) record->hash = hash_file_contents(src);
+            printf("-- Installing: %s\n", dst);
+            copied++;
+        } 
+        else {
+            failed++;
+            record->path = NULL;
+            continue;
+        }
+        struct stat installed_st;
+        if (lstat(dst, &installed_st) == 0) {
+            record->dst_size = (long long)installed_st.st_size;
+            record->dst_mtime = S_ISLNK(installed_st.st_mode) ? 0 : file_mtime_us(dst);
         }
     }
 
-    // 构建阶段
-    if (!configure_only) {
-        char build_tool[128];
-        #if PLATFORM_WINDOWS
-            snprintf(build_tool, sizeof(build_tool), "cmake --build .");
-        #else
-            // 尝试获取核心数
-            int core_count = sysconf(_SC_NPROCESSORS_ONLN);
-            if (core_count > 0) {
-                snprintf(build_tool, sizeof(build_tool), "cmake --build . --parallel %d", core_count);
-            } else {
-                strcpy(build_tool, "cmake --build .");
-            }
-        #endif
-
-        printf("构建中: %s\n", build_tool);
-        if (!execute_command(build_tool)) {
-            fprintf(stderr, "构建失败\n");
-            CHDIR(cwd); // 恢复原始目录
-            return EXIT_FAILURE;
+    // 原子地写入状态文件和安装清单(供uninstall使用)
+    FILE* state = fopen(INSTALL_STATE_FILE ".tmp", "w");
+    FILE* installed = fopen("install_manifest.txt.tmp", "w");
+    if (state && installed) {
+        for (size_t i = 0; i < files.count; i++) {
+            const struct install_record* record = &new_records[i];
+            if (!record->path) continue;
+            fprintf(state, "%016llx %lld %lld %lld %lld %s\n", (unsigned long long)record->hash,
+                    record->src_size, record->src_mtime, record->dst_size, record->dst_mtime, record->path);
+            fprintf(installed, "%s\n", record->path);
         }
     }
-
-    // 返回原始目录
-    if (CHDIR(cwd) != 0) {
-        perror("返回原始目录失败");
-        return EXIT_FAILURE;
+    bool written = state && installed;
+    if (state && fclose(state) != 0) written = false;
+    if (installed && fclose(installed) != 0) written = false;
+    if (!written || rename(INSTALL_STATE_FILE ".tmp", INSTALL_STATE_FILE) != 0
+        || rename("install_manifest.txt.tmp", "install_manifest.txt") != 0) {
+        perror("写入安装清单失败");
+        failed++;
     }
 
-    printf("\n构建%s成功!\n", configure_only ? "配置" : "");
-    return EXIT_SUCCESS;
+    printf("增量安装完成: 复制 %d 个文件, %d 个文件未变化(其中 %d 个通过内容哈希确认), %d 个失败\n",
+           copied, unchanged, hashed, failed);
+
+    for (size_t i = 0; i < record_count; i++) free(records[i].path);
+    free(records);
+    free(new_records);
+    string_list_free(&files);
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
 }
+#endif
 
 uint8_t install_project(int argc, char* argv[]) {
     char install_path[MAX_PATH_LEN] = {0}; // 初始化路径缓冲区
     bool set_path = false;
+    bool incremental = false;
+    bool from_stage = false; // 内部参数: 通过sudo重新运行时直接部署已暂存的文件
+    const char* build_type = NULL;
 
-    // 处理用户输入的安装路径
-    if (argc > 2) {
-        set_path = true;
-        strcpy(install_path, argv[2]);
-        install_path[MAX_PATH_LEN - 1] = '\0'; // 确保终止符
+    // 处理用户输入的安装路径和选项
+    for (int i = 2; i < argc; i++) {
+        if (!strcmp(argv[i], "-i") || !strcmp(argv[i], "--incremental")) {
+            incremental = true;
+        } 
+        else if (!strcmp(argv[i], "-t") || !strcmp(argv[i], "--build-type")) {
+            if (i + 1 >= argc || !is_valid_build_type(argv[i + 1])) {
+                fprintf(stderr, "错误：构建类型必须是 Debug、Release、RelWithDebInfo 或 MinSizeRel\n");
+                return EXIT_FAILURE;
+            }
+            build_type = argv[++i];
+        } 
+        else if (!strcmp(argv[i], "--from-stage")) {
+            from_stage = true;
+        } 
+        else if (!set_path) {
+            set_path = true;
+            strncpy(install_path, argv[i], MAX_PATH_LEN - 1);
+            install_path[MAX_PATH_LEN - 1] = '\0'; // 确保终止符
+        }
     }
 
-    // 尝试进入 build 目录
-    if (CHDIR("build") != 0) {
-        perror("无法进入build目录");
+    // 进入CMake二进制目录(per-type布局下为build/<构建类型>)
+    char binary_dir[MAX_PATH_LEN];
+    char config[16];
+    if (!find_install_binary_dir("build", build_type, binary_dir, sizeof(binary_dir), config, sizeof(config))) {
+        return EXIT_FAILURE;
+    }
+    if (CHDIR(binary_dir) != 0) {
+        fprintf(stderr, "无法进入构建目录 %s: %s\n", binary_dir, strerror(errno));
         return EXIT_FAILURE;
     }
 
+#if !defined(PLATFORM_WINDOWS)
+    if (incremental) {
+        return incremental_install(set_path ? install_path : NULL, config, from_stage, argc, argv);
+    }
+#else
+    if (incremental) {
+        printf("警告: Windows下不支持增量安装,执行完整安装\n");
+    }
+    (void)from_stage;
+#endif
+
     // 构建安装命令
-    char command[MAX_PATH_LEN];
 #if defined(PLATFORM_WINDOWS)
-    if(set_path == true) snprintf(command, MAX_PATH_LEN, "cmake --install . --prefix \"%s\"", install_path);
-    else snprintf(command, MAX_PATH_LEN, "cmake --install .");
+    char* install_args[] = { "cmake", "--install", ".", NULL, NULL, NULL, NULL, NULL };
 #else
-    if(set_path == true) snprintf(command, MAX_PATH_LEN, "sudo cmake --install . --prefix \"%s\"", install_path);
-    else snprintf(command, MAX_PATH_LEN, "sudo cmake --install .");
+    char* install_args[] = { "sudo", "cmake", "--install", ".", NULL, NULL, NULL, NULL, NULL };
 #endif
-    return execute_command(command);
+    size_t n = 0;
+    while (install_args[n]) n++;
+    if (set_path) {
+        install_args[n++] = "--prefix";
+        install_args[n++] = install_path;
+    }
+    // 多配置生成器需要指定安装哪个配置
+    if (config[0]) {
+        install_args[n++] = "--config";
+        install_args[n++] = config;
+    }
+    return run_process(install_args, NULL) ? EXIT_SUCCESS : EXIT_FAILURE;
 }
 
-// 主卸载函数
-bool uninstall() {
-    FILE* install_manifest = fopen("build/install_manifest.txt", "r");
+// cbuild uninstall [构建目录] [--dry-run] [--json]
+// 在进程内逐个unlink清单中的文件; 权限不足时整个卸载只通过sudo重新运行一次
+uint8_t uninstall_project(int argc, char* argv[]) {
+    const char* build_dir = "build";
+    const char* build_type = NULL;
+    bool dry_run = false;
+    bool json = false;
+    for (int i = 2; i < argc; i++) {
+        if (!strcmp(argv[i], "--dry-run") || !strcmp(argv[i], "-n")) {
+            dry_run = true;
+        } 
+        else if (!strcmp(argv[i], "-t") || !strcmp(argv[i], "--build-type")) {
+            if (i + 1 >= argc || !is_valid_build_type(argv[i + 1])) {
+                fprintf(stderr, "错误：构建类型必须是 Debug、Release、RelWithDebInfo 或 MinSizeRel\n");
+                return EXIT_FAILURE;
+            }
+            build_type = argv[++i];
+        } 
+        else if (!strcmp(argv[i], "--json")) {
+            json = true;
+        } 
+        else if (argv[i][0] != '-') {
+            build_dir = argv[i];
+        } 
+        else {
+            fprintf(stderr, "未知的uninstall选项: %s\n", argv[i]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    // 安装清单位于CMake二进制目录中(per-type布局下为<构建目录>/<构建类型>)
+    char binary_dir[MAX_PATH_LEN];
+    char config[16];
+    if (!find_install_binary_dir(build_dir, build_type, binary_dir, sizeof(binary_dir), config, sizeof(config))) {
+        return EXIT_FAILURE;
+    }
+    char manifest_path[MAX_PATH_LEN + 32];
+    char cache_path[MAX_PATH_LEN + 16];
+    char prefix[MAX_PATH_LEN] = "";
+    snprintf(manifest_path, sizeof(manifest_path), "%s%cinstall_manifest.txt", binary_dir, PATH_SEP);
+    snprintf(cache_path, sizeof(cache_path), "%s%cCMakeCache.txt", binary_dir, PATH_SEP);
+    read_cmake_cache_value(cache_path, "CMAKE_INSTALL_PREFIX", prefix, sizeof(prefix));
+
+    FILE* install_manifest = fopen(manifest_path, "r");
     if (!install_manifest) {
-        perror("Failed to open install manifest");
-        return 1;
+        fprintf(stderr, "无法打开安装清单 %s: %s\n", manifest_path, strerror(errno));
+        return EXIT_FAILURE;
     }
 
-    char file_path[1024];
-    int success_count = 0;
-    int fail_count = 0;
+    struct uninstall_entry* entries = NULL;
+    size_t count = 0, capacity = 0;
+    bool needs_privilege = false;
+    char line[MAX_PATH_LEN];
+    while (fgets(line, sizeof(line), install_manifest)) {
+        line[strcspn(line, "\r\n")] = '\0';
+        if (line[0] == '\0') continue;
+#if defined(PLATFORM_WINDOWS)
+        for (char* p = line; *p; ++p) {
+            if (*p == '/') *p = '\\';
+        }
+#endif
+        if (count == capacity) {
+            capacity = capacity ? capacity * 2 : 256;
+            struct uninstall_entry* grown = realloc(entries, capacity * sizeof(*entries));
+            if (!grown) break;
+            entries = grown;
+        }
+        entries[count].path = strdup(line);
+        entries[count].status = NULL;
+        entries[count].error = 0;
+        if (!entries[count].path) break;
+
+#if !defined(PLATFORM_WINDOWS)
+        // 删除文件需要对其所在目录有写权限,预先检查以便在删除任何文件之前决定是否提权
+        char dir[MAX_PATH_LEN];
+        snprintf(dir, sizeof(dir), "%s", line);
+        if (parent_directory(dir) && access(dir, W_OK | X_OK) != 0 && errno == EACCES) {
+            needs_privilege = true;
+        }
+#endif
+        count++;
+    }
+    fclose(install_manifest);
 
-    while (fgets(file_path, sizeof(file_path), install_manifest)) {
-        size_t len = strlen(file_path);
-        if (len > 0 && file_path[len - 1] == '\n') {
-            file_path[len - 1] = '\0';
+#if !defined(PLATFORM_WINDOWS)
+    if (needs_privilege && !dry_run && geteuid() != 0) {
+        char self[MAX_PATH_LEN];
+        for (size_t i = 0; i < count; i++) free(entries[i].path);
+        free(entries);
+        if (!self_executable_path(argv[0], self, sizeof(self))) {
+            fprintf(stderr, "无法确定cbuild的路径,无法使用sudo重新运行\n");
+            return EXIT_FAILURE;
         }
+        if (!json) printf("部分文件需要管理员权限,使用sudo重新运行卸载\n");
+        struct string_list sudo_args = {0};
+        string_list_push(&sudo_args, "sudo");
+        string_list_push(&sudo_args, self);
+        for (int i = 1; i < argc; i++) string_list_push(&sudo_args, argv[i]);
+        // --json时stdout只能有子进程输出的JSON
+        struct run_options sudo_opts = {0};
+        sudo_opts.hide_command = json;
+        int ok = run_process(sudo_args.items, &sudo_opts);
+        string_list_free(&sudo_args);
+        return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+#endif
 
-        int result;
+    int removed = 0, missing = 0, failed = 0;
+    for (size_t i = 0; i < count; i++) {
+        struct uninstall_entry* entry = &entries[i];
+        struct stat st;
 #if defined(PLATFORM_WINDOWS)
-        for (char* p = file_path; *p; ++p) {
-            if (*p == '/') *p = '\\';
+        bool exists = stat(entry->path, &st) == 0;
+#else
+        bool exists = lstat(entry->path, &st) == 0;
+#endif
+        if (!exists) {
+            entry->status = "missing";
+            missing++;
+            continue;
         }
-        
-        SetFileAttributes(file_path, FILE_ATTRIBUTE_NORMAL);
-        result = remove(file_path);
+        if (dry_run) {
+            entry->status = "would-remove";
+            removed++;
+            if (!json) printf("将删除 %s\n", entry->path);
+            continue;
+        }
+#if defined(PLATFORM_WINDOWS)
+        SetFileAttributes(entry->path, FILE_ATTRIBUTE_NORMAL);
+        int result = remove(entry->path);
 #else
-        char command[MAX_PATH_LEN];
-        snprintf(command,MAX_PATH_LEN,"sudo rm %s",file_path);
-        printf("romve %s\n",file_path);
-        result = system(command);
+        int result = unlink(entry->path);
 #endif
-
         if (result == 0) {
-            success_count++;
+            entry->status = "removed";
+            removed++;
         } 
         else {
-            perror(file_path);
-            fail_count++;
+            entry->status = "failed";
+            entry->error = errno;
+            failed++;
+            if (!json) fprintf(stderr, "删除失败 %s: %s\n", entry->path, strerror(errno));
         }
     }
 
-    fclose(install_manifest);
+    // 删除因卸载而变空的目录; 每个文件都向上检查一遍,使兄弟目录删除后父目录也能被删除
+    struct string_list pruned = {0};
+    for (size_t i = 0; !dry_run && prefix[0] != '\0' && i < count; i++) {
+        if (strcmp(entries[i].status, "removed") != 0) continue;
+        char dir[MAX_PATH_LEN];
+        snprintf(dir, sizeof(dir), "%s", entries[i].path);
+        while (parent_directory(dir) && is_prunable_directory(dir, prefix)) {
+            if (RMDIR(dir) == 0) string_list_push(&pruned, dir);
+            else if (errno != ENOENT) break;
+        }
+    }
 
-    printf("卸载完成：已删除 %d 个文件, %d 个文件失败\n", success_count, fail_count);
-    
-    return fail_count ? false : true;
+    if (json) {
+        printf("{\"dry_run\":%s,\"prefix\":", dry_run ? "true" : "false");
+        json_write_string(stdout, prefix);
+        printf(",\"removed\":%d,\"missing\":%d,\"failed\":%d,\"pruned_directories\":%zu,\"files\":[", removed, missing, failed, pruned.count);
+        for (size_t i = 0; i < count; i++) {
+            printf("%s{\"path\":", i > 0 ? "," : "");
+            json_write_string(stdout, entries[i].path);
+            printf(",\"status\":\"%s\"", entries[i].status);
+            if (entries[i].error) {
+                printf(",\"error\":");
+                json_write_string(stdout, strerror(entries[i].error));
+            }
+            printf("}");
+        }
+        printf("],\"directories\":[");
+        for (size_t i = 0; i < pruned.count; i++) {
+            if (i > 0) printf(",");
+            json_write_string(stdout, pruned.items[i]);
+        }
+        printf("]}\n");
+    } 
+    else {
+        for (size_t i = 0; i < pruned.count; i++) printf("删除空目录 %s\n", pruned.items[i]);
+        printf("卸载%s：%s %d 个文件, %d 个文件不存在, %d 个文件失败, 删除 %zu 个空目录\n",
+               dry_run ? "预览" : "完成", dry_run ? "将删除" : "已删除", removed, missing, failed, pruned.count);
+    }
+
+    for (size_t i = 0; i < count; i++) free(entries[i].path);
+    free(entries);
+    string_list_free(&pruned);
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
 }
 
 int main(int argc,char*argv[]){
@@ -1204,7 +8681,14 @@ int main(int argc,char*argv[]){
     SetConsoleCP(CP_UTF8);
 #endif
     
-    print_platform_info();
+    // --json 输出需要保持标准输出只包含JSON
+    bool json_output = false;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--json")) json_output = true;
+    }
+    if (!json_output) {
+        print_platform_info();
+    }
 
     if(argc==1){
         printf("提示: 使用 -h 查看帮助\n");
@@ -1215,18 +8699,60 @@ int main(int argc,char*argv[]){
         // 构建项目
         if(! strcmp("build",argv[1])){
             printf("开始构建...\n");
+#if !defined(PLATFORM_WINDOWS)
+            // 当前目录有运行中的守护进程时由守护进程构建
+            int forwarded = daemon_forward_build(argc, argv);
+            if (forwarded >= 0) return (uint8_t)forwarded;
+#endif
+            struct string_list members = {0};
+            if (load_workspace_members(&members)) {
+                uint8_t result = workspace_command(argc, argv, &members);
+                string_list_free(&members);
+                return result;
+            }
             return build_project(argc,argv);
         }
         
         // 根据解析的CMake.toml初始化项目
         else if(! strcmp("init",argv[1])){
+            struct string_list members = {0};
+            if (load_workspace_members(&members)) {
+                uint8_t result = workspace_command(argc, argv, &members);
+                string_list_free(&members);
+                return result;
+            }
             // 解析并且初始化CMake.toml
             return init_project(argc,argv);
         }
 
+        // 监视修改并自动构建
+        else if(! strcmp("watch",argv[1])){
+            return watch_command(argc,argv);
+        }
+
+        // 常驻的构建守护进程
+        else if(! strcmp("daemon",argv[1])){
+            return daemon_command(argc,argv);
+        }
+
+        // 编译器缓存统计
+        else if(! strcmp("cache",argv[1])){
+            return cache_command(argc,argv);
+        }
+
+        // 解析依赖项
+        else if(! strcmp("deps",argv[1])){
+            return deps_command(argc,argv);
+        }
+
+        // 检查预编译头是否生效
+        else if(! strcmp("pch-check",argv[1])){
+            return pch_check(argc,argv);
+        }
+
         // 清除cmake构建
         else if(! strcmp("clean",argv[1])){
-            return clean_project_cache();
+            return clean_command(argc,argv);
         }
 
         // 创建新的项目
@@ -1236,12 +8762,12 @@ int main(int argc,char*argv[]){
 
         // 安装项目
         else if(! strcmp("install",argv[1])){
-            return install_project(argc,argv) == 1 ? EXIT_SUCCESS : EXIT_FAILURE;
+            return install_project(argc,argv);
         }
 
         // 卸载安装的项目
         else if(! strcmp("uninstall",argv[1])){
-            return uninstall() ? EXIT_SUCCESS : EXIT_FAILURE;
+            return uninstall_project(argc,argv);
         }
 
         // 输出帮助消息